@@ -14,13 +14,51 @@
 */
 
 #include "esp32-i2s-slm/filters.h"
-#include "esp32-i2s-slm/i2s_mic.h"
-#include "approx.h"  // fast log10f and sincosf approximation
+#include "i2s_mic.h"
+#include "approx.h"  // fast math approximations and batch kernels
 #include <cmath>
 
 static constexpr unsigned SAMPLE_RATE_HZ = 48000;  // Hz, fixed to design of IIR filters. Determines maximum frequency that can be analysed by the FFT Fmax=sampleF/2.
 static constexpr unsigned SAMPLE_COUNT = 1024;      // ~10ms sample time, must be power-of-two
-float samples[SAMPLE_COUNT];                       // Raw microphone sample storage
+
+// Run filtering, FFT and normalization with integers only. Useful for ESP32 variants without FPU, e.g. ESP32-S2 / -C3.
+// Loud bins stay within ~0.015 of the floating-point path, see normalization.h. Can not be combined with ENABLE_DECIMATION or ANALYSIS_BAND_BANK
+//#define FIXED_POINT_ANALYSIS
+#ifdef FIXED_POINT_ANALYSIS
+using SampleValue = int32_t;  // Integer microphone values, A-weighted in fixed-point
+#else
+using SampleValue = float;
+#endif
+
+// Analyse two microphones, e.g. two INMP441 sharing the data line with their L/R pins at GND and VDD.
+// Both channels are transformed by one complex FFT. Effects get the levels of each channel in AnalysisFrame::leftLevels / rightLevels,
+// all other results are calculated from the average of both channels. Can not be combined with FIXED_POINT_ANALYSIS or ANALYSIS_BAND_BANK
+//#define STEREO_ANALYSIS
+#ifdef STEREO_ANALYSIS
+static constexpr unsigned CHANNELS = 2;
+#else
+static constexpr unsigned CHANNELS = 1;
+#endif
+SampleValue samples[CHANNELS * SAMPLE_COUNT];  // Raw microphone sample storage. Left channel samples are followed by right channel samples
+
+// Decimate samples before the FFT. We only analyse up to MAX_ANALYSIS_FREQUENCY_HZ, so most of the FFT bins are wasted otherwise.
+// With a factor of 4 a 256-point FFT gives the same bin size as a 1024-point FFT at 48kHz for ~1/4 of the cost.
+// Alternatively raise SAMPLE_COUNT to 4096 to get 4x finer bins for the CPU time of the 1024-point FFT.
+// For a factor of 6 SAMPLE_COUNT must be divisible by 6, e.g. 1536
+//#define ENABLE_DECIMATION
+#ifdef ENABLE_DECIMATION
+#include "decimator.h"
+static constexpr unsigned DECIMATION_FACTOR = 4;
+auto decimator = Decimator<SAMPLE_COUNT, DECIMATION_FACTOR>();
+#ifdef STEREO_ANALYSIS
+auto decimatorRight = Decimator<SAMPLE_COUNT, DECIMATION_FACTOR>();
+#endif
+#else
+static constexpr unsigned DECIMATION_FACTOR = 1;
+#endif
+static constexpr unsigned FFT_SAMPLE_COUNT = SAMPLE_COUNT / DECIMATION_FACTOR;      // Number of samples going into the FFT, must be power-of-two
+static constexpr unsigned FFT_SAMPLE_RATE_HZ = SAMPLE_RATE_HZ / DECIMATION_FACTOR;  // Sample rate of FFT input
+static constexpr float FFT_AMPLITUDE_SCALE = float(SAMPLE_COUNT) / FFT_SAMPLE_COUNT;  // FFT amplitudes scale with FFT size. Correct this so the dB values stay the same
 
 // NOTE: Some microphones require at least a DC-Blocker filter
 #define MIC_EQUALIZER INMP441                    // See below for defined IIR filters or set to 'None' to disable
@@ -34,27 +72,132 @@ static constexpr unsigned MIC_BITS = 24;        // valid number of bits in I2S d
 
 constexpr float MIC_REF_AMPL = powf(10.0f, float(MIC_SENSITIVITY) / 20.0f) * ((1 << (MIC_BITS - 1)) - 1);  // Microphone reference amplitude value
 
-// Convert microphone amplitude to dB values
-float MicAmplitudeToDb(float v) {
-  return MIC_OFFSET_DB + MIC_REF_DB + 20.0f * log10f_fast(v / MIC_REF_AMPL);
-}
+// dB value of a FFT amplitude of 1. Amplitudes are converted to dB values by the normalizer
+static constexpr float MIC_AMPLITUDE_ONE_DB = MIC_OFFSET_DB + MIC_REF_DB + 20.0f * log10f(FFT_AMPLITUDE_SCALE / MIC_REF_AMPL);
 
-auto mic = Microphone_I2S<SAMPLE_COUNT, 33, 32, 34, I2S_NUM_0, MIC_BITS, false, SAMPLE_RATE_HZ>(MIC_EQUALIZER);
+auto mic = Microphone_I2S<SAMPLE_COUNT, 33, 32, 34, I2S_NUM_0, MIC_BITS, false, SAMPLE_RATE_HZ, SampleValue, CHANNELS>(MIC_EQUALIZER);
 
 // ------------------------------------------------------------------------------------------
 
 #include "fft.h"
 #include "normalization.h"
 #include "spectrum.h"
+#include "chroma.h"
 #include "beat_detection.h"
 
 static constexpr unsigned NR_OF_BANDS = 32;
 static constexpr unsigned MAX_ANALYSIS_FREQUENCY_HZ = 4000;
 
-auto fft = FFT<SAMPLE_COUNT, SAMPLE_RATE_HZ>(&samples);
-auto normalization = Normalization<SAMPLE_COUNT, MIC_NOISE_DB, MIC_OVERLOAD_DB, MAX_ANALYSIS_FREQUENCY_HZ, SAMPLE_RATE_HZ>(MicAmplitudeToDb);
-auto spectrum = Spectrum<SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, SAMPLE_RATE_HZ>();
-auto beats = BeatDetection<SAMPLE_COUNT, MAX_ANALYSIS_FREQUENCY_HZ, SAMPLE_RATE_HZ, 50>();
+// FFT implementation to use. FFTBackendEspDsp is fastest on ESP32. See fft.h
+#ifdef FIXED_POINT_ANALYSIS
+#if defined(ENABLE_DECIMATION) || defined(ANALYSIS_BAND_BANK)
+#error "FIXED_POINT_ANALYSIS can not be used with ENABLE_DECIMATION or ANALYSIS_BAND_BANK"
+#endif
+template <unsigned N, unsigned RATE> using FFTBackend = FFTBackendQ15<N, RATE>;
+#elif __has_include("esp_dsp.h")
+template <unsigned N, unsigned RATE> using FFTBackend = FFTBackendEspDsp<N, RATE>;
+#elif defined(STEREO_ANALYSIS)
+// ArduinoFFT can not transform both channels at once
+template <unsigned N, unsigned RATE> using FFTBackend = FFTBackendReference<N, RATE>;
+#else
+template <unsigned N, unsigned RATE> using FFTBackend = FFTBackendArduino<N, RATE>;
+#endif
+auto fft = FFT<FFT_SAMPLE_COUNT, FFT_SAMPLE_RATE_HZ, FFTBackend>(reinterpret_cast<SampleValue(*)[FFT_SAMPLE_COUNT]>(&samples));
+
+// Check accuracy and speed of all FFT backends at startup and print results
+//#define CHECK_FFT_BACKENDS
+#ifdef CHECK_FFT_BACKENDS
+#include "fft_check.h"
+#endif
+
+// Check error and speed of the approximations in the analysis chain (dB conversion, FFT backends, Approx kernels) at startup and print results
+//#define CHECK_ANALYSIS_APPROXIMATIONS
+#ifdef CHECK_ANALYSIS_APPROXIMATIONS
+#include "analysis_check.h"
+#endif
+
+// Measure particle effect update and render time at startup and print results. Not measured on the device yet, see particles_check.h
+//#define CHECK_PARTICLE_BENCHMARK
+#ifdef CHECK_PARTICLE_BENCHMARK
+#include "particles_check.h"
+#endif
+#ifdef FIXED_POINT_ANALYSIS
+// A-weighting filter with Q28 coefficients, so the normalizer can work on log2 amplitudes
+auto A_weightingQ31 = SOSFilterQ31(A_weighting);
+auto normalization = Normalization<FFT_SAMPLE_COUNT, MIC_NOISE_DB, MIC_OVERLOAD_DB, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ, SampleValue>(MIC_AMPLITUDE_ONE_DB);
+#else
+auto normalization = Normalization<FFT_SAMPLE_COUNT, MIC_NOISE_DB, MIC_OVERLOAD_DB, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ>(MIC_AMPLITUDE_ONE_DB);
+#endif
+auto spectrum = Spectrum<FFT_SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ>();
+auto beats = BeatDetection<FFT_SAMPLE_COUNT, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ, 50>();
+// Pitch class and note levels from the FFT magnitudes. Not available with ANALYSIS_BAND_BANK
+using ChromaAnalysis = Chroma<FFT_SAMPLE_COUNT, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ>;
+auto chroma = ChromaAnalysis();
+
+// Use a bank of sliding DFT resonators updated in the microphone reader task instead of FFT + Spectrum band accumulation.
+// Band amplitudes are updated every few samples and can be read without waiting for a full FFT block
+//#define ANALYSIS_BAND_BANK
+#ifdef ANALYSIS_BAND_BANK
+#ifdef ENABLE_DECIMATION
+#error "The band bank runs at the full sample rate and can not be used with ENABLE_DECIMATION"
+#endif
+#include "band_bank.h"
+auto bandBank = BandBank<SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, SAMPLE_RATE_HZ>();
+float bandAmplitudes[NR_OF_BANDS];
+#endif
+
+#ifdef STEREO_ANALYSIS
+#if defined(FIXED_POINT_ANALYSIS) || defined(ANALYSIS_BAND_BANK)
+#error "STEREO_ANALYSIS can not be used with FIXED_POINT_ANALYSIS or ANALYSIS_BAND_BANK"
+#endif
+// A-weighting filter with the same coefficients, but separate state for the right channel
+SOS_IIR_Filter A_weightingRight(A_weighting.num_sos, A_weighting.gain, A_weighting.sos);
+// Band levels of each channel. The AGC follows the average of both channels and its gain is applied to each channel unchanged, so their balance is kept
+auto spectrumLeft = Spectrum<FFT_SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ>();
+auto spectrumRight = Spectrum<FFT_SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ>();
+float midAmplitudes[FFT_SAMPLE_COUNT / 2];  // Average amplitudes of both channels
+#endif
+
+// Calibrated sound levels (LAF, LAS, LAeq, LAFmax, LApeak) of the A-weighted samples. A-weighting and level accumulation run in
+// the microphone reader task, fused with the filter gain pass. Not available with FIXED_POINT_ANALYSIS, where the main loop A-weights
+#ifndef FIXED_POINT_ANALYSIS
+#include "sound_level_meter.h"
+auto soundLevelMeter = SoundLevelMeter<CHANNELS, SAMPLE_RATE_HZ>(MIC_REF_AMPL, MIC_OFFSET_DB + MIC_REF_DB);
+#endif
+
+// Print sound levels once per second, e.g. to log the noise level of a venue
+//#define PRINT_SOUND_LEVELS
+#ifdef PRINT_SOUND_LEVELS
+#ifdef FIXED_POINT_ANALYSIS
+#error "PRINT_SOUND_LEVELS can not be used with FIXED_POINT_ANALYSIS"
+#endif
+uint32_t soundLevelSamples = 0;  // Audio samples analysed since last print
+
+void printSoundLevels(const SoundLevels &levels, uint32_t samplesAnalysed) {
+  soundLevelSamples += samplesAnalysed;
+  if (soundLevelSamples >= SAMPLE_RATE_HZ) {
+    Log::info("LAF %.1f dB, LAS %.1f dB, LAeq %.1f dB (last %.1f dB), LAFmax %.1f dB, LApeak %.1f dB\n", levels.lafDb, levels.lasDb, levels.laeqDb, levels.lastLaeqDb, levels.lafMaxDb, levels.lapeakDb);
+    soundLevelSamples = 0;
+  }
+}
+#endif
+
+// Print CPU cycles spent on analysis per second of audio to compare the FFT and band bank paths
+//#define PRINT_ANALYSIS_CYCLES
+#ifdef PRINT_ANALYSIS_CYCLES
+#include <atomic>
+std::atomic<uint32_t> analysisCycles(0);  // Analysis cycles spent since last print, from all tasks
+uint32_t analysisSamples = 0;             // Audio samples analysed since last print
+
+void printAnalysisCycles(uint32_t samplesAnalysed) {
+  analysisSamples += samplesAnalysed;
+  if (analysisSamples >= SAMPLE_RATE_HZ) {
+    auto cyclesPerSecond = (static_cast<uint64_t>(analysisCycles.exchange(0)) * SAMPLE_RATE_HZ) / analysisSamples;
+    Log::info("%l analysis cycles / s of audio\n", static_cast<long>(cyclesPerSecond));
+    analysisSamples = 0;
+  }
+}
+#endif
 
 // ------------------------------------------------------------------------------------------
 
@@ -77,6 +220,39 @@ auto beats = BeatDetection<SAMPLE_COUNT, MAX_ANALYSIS_FREQUENCY_HZ, SAMPLE_RATE_
 BluetoothSerial SerialBT;
 #endif
 
+// Accept commands on the USB serial port, e.g. to tune parameters. Runs in the network task, even without WiFi or Bluetooth
+//#define ENABLE_SERIAL_COMMANDS
+
+// Share analysis results over UDP multicast, so several matrices react to a single microphone. Needs WiFi
+//#define ANALYSIS_BROADCAST_SEND     // Analyse audio and send analysis frames to the local network
+//#define ANALYSIS_BROADCAST_RECEIVE  // Render analysis frames received from the network. Does not use the microphone and FFT
+#if defined(ANALYSIS_BROADCAST_SEND) && defined(ANALYSIS_BROADCAST_RECEIVE)
+#error A node can either send or receive analysis frames
+#endif
+
+// Show pixel frames streamed over DDP, e.g. from a lighting desk, xLights or LedFx. Needs WiFi
+//#define PIXEL_STREAM_INPUT  // Show received frames instead of local effects. Does not use the microphone
+//#define PIXEL_STREAM_LAYER  // Add presets compositing local effects on top of received frames
+#if defined(PIXEL_STREAM_INPUT) && (defined(PIXEL_STREAM_LAYER) || defined(ANALYSIS_BROADCAST_SEND) || defined(ANALYSIS_BROADCAST_RECEIVE))
+#error PIXEL_STREAM_INPUT replaces local effects and audio analysis
+#endif
+
+// Analyse audio from the microphone, unless analysis frames or pixels come from the network
+#if !defined(ANALYSIS_BROADCAST_RECEIVE) && !defined(PIXEL_STREAM_INPUT)
+#define LOCAL_ANALYSIS
+#endif
+
+#if defined(ENABLE_OTA) || defined(ANALYSIS_BROADCAST_SEND) || defined(ANALYSIS_BROADCAST_RECEIVE) || defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+#define ENABLE_WIFI
+#endif
+
+// All connectivity runs in a low-priority network task and talks to the render task through lock-free queues only
+#if defined(ENABLE_WIFI) || defined(ENABLE_BLUETOOTH) || defined(ENABLE_SERIAL_COMMANDS)
+#define ENABLE_NETWORK
+#include "cpu_budget.h"
+#include "spsc_queue.h"
+#endif
+
 // Configure your WiFi and Bluetooth settings here:
 #include "network_config.h"
 
@@ -106,130 +282,649 @@ SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(backgroundLayer, kMatrixWidth, kMatrixHeig
 // ------------------------------------------------------------------------------------------
 
 #include "effectpipeline.h"
+#include "tiledeffectpipeline.h"
 #include "effects_draw.h"
 #include "effects_spectrum.h"
 #include "effects_feedback.h"
+#include "effects_particles.h"
+#include "effects_meter.h"
+#include "effects_chroma.h"
+#include "presets.h"
+#include "parameters.h"
 #include "screen.h"
+#include "serial_printf.h"
+#include "logging.h"
+#include "analysis_frame.h"
+#include "analysis_interpolator.h"
+#include "render_scheduler.h"
+#if defined(ANALYSIS_BROADCAST_SEND) || defined(ANALYSIS_BROADCAST_RECEIVE)
+#include "analysis_broadcast.h"
+#endif
+#if defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+#include "pixel_stream.h"
+#include "effects_stream.h"
+#endif
+
+//#define TILED_RENDERING                                      // Render in strips with history frames in PSRAM to save internal RAM. Disables crossfades
+static constexpr bool PRESET_CROSSFADE = true;                 // Crossfade between presets. Needs 3 more frame buffers
+static constexpr unsigned TILE_STRIP_ROWS = 8;                 // Rows rendered at once with TILED_RENDERING
+#define PARALLEL_RENDERING                                     // Render the bottom half of row-parallel effects on core 0. Not used with TILED_RENDERING
+static constexpr unsigned RENDER_WORKER_PRIO = 3;              // FreeRTOS priority of render worker on core 0. Must be below the microphone reader (4), so audio is never delayed
+static constexpr unsigned RENDER_RATE_HZ = 60;                 // Frames rendered per second, independent of audio block rate. E.g. 60, 100, 120
+static constexpr unsigned DISPLAY_REFRESH_RATE_HZ = 2 * RENDER_RATE_HZ;  // Matrix refresh rate. Higher than RENDER_RATE_HZ, so swapping buffers does not block for long
+static constexpr unsigned PRESET_CROSSFADE_FRAMES = RENDER_RATE_HZ;  // Crossfade duration in frames, 1s at any render rate
+static constexpr unsigned long PRESET_SWITCH_INTERVAL_MS = 30000;  // Minimum time between random preset switches
+static constexpr unsigned PARTICLE_POOL_SIZE = 2048;           // Particles per particle effect, 11 bytes each. Drops none with all bands at 30% and beats at 120 BPM
+#ifdef PIXEL_STREAM_LAYER
+static constexpr size_t PRESET_ARENA_SIZE = 66 * 1024;         // Memory for the effects of all presets. The stream presets add a second particle pool
+#else
+static constexpr size_t PRESET_ARENA_SIZE = 42 * 1024;         // Memory for the effects of all presets. The high-water mark is logged at boot
+#endif
 
 auto screen = SMLayerScreen<kMatrixWidth, kMatrixHeight, kBackgroundLayerOptions>(backgroundLayer);
-auto effects = std::vector<Effect::SPtr>({ std::make_shared<Effects::FillColor<kMatrixWidth, kMatrixHeight, Effect::Type::ToDestination>>(), std::make_shared<Effects::DrawSpectrum<kMatrixWidth, kMatrixHeight, NR_OF_BANDS>>() });
-//auto effects = std::vector<Effect::SPtr>({ std::make_shared<Effects::MoveFromCenter<kMatrixWidth, kMatrixHeight>>(), std::make_shared<Effects::ChangeBrightness<kMatrixWidth, kMatrixHeight>>(), std::make_shared<Effects::DrawSpectrum<kMatrixWidth, kMatrixHeight, NR_OF_BANDS>>() });
-auto pipeline = EffectPipeline<kMatrixWidth, kMatrixHeight>(effects);
+auto presets = PresetLibrary<20, PRESET_ARENA_SIZE>();
+#ifdef TILED_RENDERING
+auto pipeline = TiledEffectPipeline<kMatrixWidth, kMatrixHeight, TILE_STRIP_ROWS>();
+#else
+auto pipeline = EffectPipeline<kMatrixWidth, kMatrixHeight, PRESET_CROSSFADE>();
+#endif
+unsigned long lastPresetSwitchMs = 0;
+auto analysisFrames = AnalysisFrameExchange();         // Hands analysis results from loop() to the render task
+auto analysisInterpolator = AnalysisInterpolator();    // Smooths analysis results in the render task
+auto renderScheduler = RenderScheduler<RENDER_RATE_HZ>();
+auto listening = Effects::Listening<kMatrixWidth, kMatrixHeight>();
+EffectChain listeningChain = { "Listening", { &listening }, 1 };  // Shown from the first frame until audio arrives
+uint32_t firstFrameUs = 0;       // Time to first frame in microseconds since boot
+uint32_t firstAudioFrameUs = 0;  // Time to first analysis frame in the render task in microseconds since boot
+
+#ifdef ENABLE_NETWORK
+// Command from the network task to the render task
+struct NetworkCommand {
+  enum class Type : uint8_t {
+    SelectPreset,  // Switch to preset #value
+    NextPreset     // Switch to the next preset
+  };
+  Type type = Type::NextPreset;
+  int value = 0;
+};
+auto networkCommands = SpscQueue<NetworkCommand, 8>();      // Network task -> render task
+auto presetSwitches = SpscQueue<const EffectChain *, 8>();  // Render task -> network task, to report preset switches
+TaskHandle_t networkHandle = nullptr;
+#endif
 
-// TODO: Functions to randomize effect pipeline and configure effects
+#ifdef ANALYSIS_BROADCAST_SEND
+// Encoded analysis frame from loop() to the network task
+struct BroadcastPacket {
+  uint8_t data[AnalysisPacket::MAX_SIZE];
+  unsigned size = 0;
+};
+auto broadcastPackets = SpscQueue<BroadcastPacket, 4>();  // loop() -> network task
+auto analysisSender = AnalysisSender();
+#endif
+#ifdef ANALYSIS_BROADCAST_RECEIVE
+auto analysisReceiver = AnalysisReceiver();  // Writes received frames into analysisFrames from the network task
+#endif
+#if defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+static constexpr unsigned PIXEL_STREAM_TASK_PRIO = 2;           // FreeRTOS priority of pixel stream task on core 0. Above the network task, below the render worker
+static constexpr unsigned PIXEL_STREAM_TASK_STACK = 4096;       // FreeRTOS stack size (in 32-bit words)
+static constexpr unsigned long PIXEL_STREAM_WAIT_MS = 1000;     // Maximum time to wait for packets
+auto pixelReceiver = PixelStreamReceiver<kMatrixWidth, kMatrixHeight>();
+#endif
+#ifdef PIXEL_STREAM_LAYER
+auto pixelFrames = FrameExchange<Effects::PixelFrame<kMatrixWidth, kMatrixHeight>>();  // Pixel stream task -> render task
+#endif
+
+// Construct all effect chains into the preset arena
+void buildPresets() {
+  using FillBlack = Effects::FillColor<kMatrixWidth, kMatrixHeight, Effect::Type::ToDestination>;
+  using Spectrum = Effects::DrawSpectrum<kMatrixWidth, kMatrixHeight, NR_OF_BANDS>;
+  using MoveFromCenter = Effects::MoveFromCenter<kMatrixWidth, kMatrixHeight>;
+  using ChangeBrightness = Effects::ChangeBrightness<kMatrixWidth, kMatrixHeight>;
+  using Spectrogram = Effects::Spectrogram<kMatrixWidth, kMatrixHeight, NR_OF_BANDS, 2 * kMatrixHeight>;
+  using Waterfall = Effects::Spectrogram<kMatrixWidth, kMatrixHeight, NR_OF_BANDS, 2 * kMatrixWidth>;
+  using Particles = Effects::Particles<kMatrixWidth, kMatrixHeight, NR_OF_BANDS, PARTICLE_POOL_SIZE>;
+  using StereoSpectrum = Effects::StereoSpectrum<kMatrixWidth, kMatrixHeight, NR_OF_BANDS>;
+  using LevelMeter = Effects::LevelMeter<kMatrixWidth, kMatrixHeight>;
+  using Chromagram = Effects::Chromagram<kMatrixWidth, kMatrixHeight>;
+  presets.add("Spectrum", { presets.create<FillBlack>(), presets.create<Spectrum>() });
+  presets.add("Spectrum from center", { presets.create<MoveFromCenter>(), presets.create<Spectrum>() });
+  presets.add("Bright spectrum from center", { presets.create<MoveFromCenter>(), presets.create<ChangeBrightness>(), presets.create<Spectrum>() });
+  presets.add("Rays", { presets.create<FillBlack>(), presets.create<Spectrum>(Spectrum::Mode::RaysCentered) });
+  presets.add("Rays from center", { presets.create<MoveFromCenter>(), presets.create<Spectrum>(Spectrum::Mode::RaysCentered) });
+  presets.add("Fire spectrum from center", { presets.create<MoveFromCenter>(), presets.create<Spectrum>(Spectrum::Mode::BandsCentered, Palettes::fire()) });
+  presets.add("Rotating rainbow rays", { presets.create<FillBlack>(), presets.create<Spectrum>(Spectrum::Mode::RaysCentered, Palettes::rainbow(), 50) });
+  presets.add("Spectrogram", { presets.create<Spectrogram>() });
+  presets.add("Ice waterfall", { presets.create<Waterfall>(Waterfall::Scroll::Right, Palettes::ice()) });
+  presets.add("Spectrum sparks", { presets.create<FillBlack>(), presets.create<Spectrum>(), presets.create<Particles>() });
+  presets.add("Stereo spectrum", { presets.create<FillBlack>(), presets.create<StereoSpectrum>() });
+  presets.add("Stereo balance", { presets.create<MoveFromCenter>(), presets.create<StereoSpectrum>(StereoSpectrum::Mode::Balance) });
+  presets.add("Sound level", { presets.create<FillBlack>(), presets.create<LevelMeter>() });
+  // chroma notes range from G#4 (~415Hz) to MAX_ANALYSIS_FREQUENCY_HZ, see Chroma. Not available with ANALYSIS_BAND_BANK
+  presets.add("Chromagram", { presets.create<FillBlack>(), presets.create<Chromagram>() });
+  presets.add("Chroma notes", { presets.create<FillBlack>(), presets.create<Chromagram>(Chromagram::Mode::Notes) });
+#ifdef PIXEL_STREAM_LAYER
+  using PixelStream = Effects::PixelStream<kMatrixWidth, kMatrixHeight>;
+  presets.add("Stream", { presets.create<PixelStream>(pixelFrames) });
+  presets.add("Stream with spectrum", { presets.create<PixelStream>(pixelFrames), presets.create<Spectrum>() });
+  presets.add("Stream with sparks", { presets.create<PixelStream>(pixelFrames), presets.create<Particles>() });
+#endif
+  if (presets.arena().hasFailed()) {
+    Log::error("Preset arena too small!\n");
+  }
+  Log::info("%d presets, arena high-water mark %d of %d bytes\n", static_cast<int>(presets.size()), static_cast<int>(presets.arena().highWaterMark()), static_cast<int>(presets.arena().capacity()));
+}
+
+// Crossfade to preset #index. Call from the render task
+void switchPreset(unsigned index) {
+  if (index >= presets.size()) {
+    return;
+  }
+  lastPresetSwitchMs = millis();
+  pipeline.setChain(presets[index], PRESET_CROSSFADE_FRAMES);
+  Log::info("Switching to preset %s\n", presets[index]->name);
+#ifdef ENABLE_NETWORK
+  presetSwitches.push(presets[index]);
+#endif
+}
+
+// Switch to a random different preset on a beat after PRESET_SWITCH_INTERVAL_MS
+void switchPresetRandomly(bool isBeat) {
+  auto now = millis();
+  if (!isBeat || presets.size() < 2 || now - lastPresetSwitchMs < PRESET_SWITCH_INTERVAL_MS) {
+    return;
+  }
+  auto current = presets.indexOf(pipeline.chain());
+  auto next = static_cast<unsigned>(random(presets.size() - 1));
+  next = next >= current ? next + 1 : next;
+  switchPreset(next);
+}
+
+#ifdef ENABLE_NETWORK
+// Apply commands queued by the network task. Call from the render task at the start of a frame
+void applyNetworkCommands() {
+  NetworkCommand command;
+  while (networkCommands.pop(command)) {
+    switch (command.type) {
+      case NetworkCommand::Type::SelectPreset:
+        switchPreset(static_cast<unsigned>(command.value));
+        break;
+      case NetworkCommand::Type::NextPreset:
+        switchPreset((presets.indexOf(pipeline.chain()) + 1) % presets.size());
+        break;
+    }
+  }
+}
+#endif
+
+//#define PRINT_RENDER_JITTER
+#ifdef PRINT_RENDER_JITTER
+unsigned renderFramesSincePrint = 0;
+#endif
+
+// Render one frame. Called by renderScheduler from the render task at RENDER_RATE_HZ
+void renderFrame(float dt) {
+  if (analysisFrames.update()) {
+    analysisInterpolator.push(analysisFrames.readFrame());
+    if (firstAudioFrameUs == 0) {
+      // audio is running, replace the listening animation
+      firstAudioFrameUs = micros();
+      pipeline.setChain(presets[0], PRESET_CROSSFADE_FRAMES);
+      Log::info("Time to first audio frame %d ms\n", static_cast<int>(firstAudioFrameUs / 1000));
+    }
+  }
+#ifdef ENABLE_NETWORK
+  if (!networkCommands.isEmpty()) {
+    applyNetworkCommands();
+  }
+#endif
+  const auto &frame = analysisInterpolator.interpolate(micros());
+  switchPresetRandomly(frame.isBeat);
+  pipeline.render(dt, frame, screen);
+  screen.swap();
+  if (firstFrameUs == 0) {
+    firstFrameUs = micros();
+    Log::info("Time to first frame %d ms\n", static_cast<int>(firstFrameUs / 1000));
+  }
+#ifdef PRINT_RENDER_JITTER
+  if (++renderFramesSincePrint >= RENDER_RATE_HZ) {
+    renderScheduler.printStatistics();
+    renderFramesSincePrint = 0;
+  }
+#endif
+}
+
+// TODO: Functions to configure effects
 
 // ------------------------------------------------------------------------------------------
 
 #ifdef ENABLE_BLUETOOTH
 void bluetoothCallback(esp_spp_cb_event_t event, esp_spp_cb_param_t *param) {
-  Serial.print("Bluetooth event: ");
-  Serial.println(event);
+  Log::debug("Bluetooth event %d\n", static_cast<int>(event));
   if (event == ESP_SPP_SRV_OPEN_EVT) {
-    Serial.println("Client Connected");
+    Log::info("Bluetooth client connected\n");
   }
   if (event == ESP_SPP_CLOSE_EVT) {
-    Serial.println("Client disconnected");
+    Log::info("Bluetooth client disconnected\n");
   }
 }
 #endif
 
-#ifdef ENABLE_OTA
-void checkOTA() {
-  static auto lastCheckTime = millis();
-  auto now = millis();
-  if (now - lastCheckTime >= 2000) {
-    lastCheckTime = now;
-    ArduinoOTA.handle();
+#ifdef ENABLE_NETWORK
+static constexpr unsigned NETWORK_TASK_PRIO = 1;               // FreeRTOS priority of network task on core 0. Lowest, so it never delays audio or rendering
+static constexpr unsigned NETWORK_TASK_STACK = 8192;           // FreeRTOS stack size (in 32-bit words)
+static constexpr unsigned long WIFI_RETRY_INTERVAL_MS = 5000;  // Time between WiFi connection attempts
+static constexpr unsigned long NETWORK_POLL_INTERVAL_MS = 50;  // Time between polls for OTA updates and commands
+static constexpr uint32_t NETWORK_CPU_BUDGET_US = 20000;       // Maximum CPU time of network services per second (2%)
+auto networkBudget = CpuBudget(NETWORK_CPU_BUDGET_US);
+
+// Command line received from a serial port
+struct CommandLine {
+  char text[64];
+  unsigned size = 0;
+};
+#ifdef ENABLE_SERIAL_COMMANDS
+CommandLine serialLine;
+#endif
+#ifdef ENABLE_BLUETOOTH
+CommandLine bluetoothLine;
+#endif
+
+// Print all parameters with their values and ranges
+void printParameters(Stream &stream) {
+  for (auto parameter = ParameterRegistry::instance().first(); parameter != nullptr; parameter = parameter->next()) {
+    stream.print(parameter->name());
+    stream.print(" = ");
+    stream.print(parameter->get(), 3);
+    stream.print(" [");
+    stream.print(parameter->minimum(), 3);
+    stream.print(", ");
+    stream.print(parameter->maximum(), 3);
+    stream.println("]");
+  }
+}
+
+// Handle a command line. Preset switches are queued for the render task, parameters are published through their atomic slots:
+// "next" - switch to next preset, "preset <n>" - switch to preset #n, "set <name> <value>" - set parameter,
+// "params" - list parameters, "status" - print network CPU usage
+void handleCommand(Stream &stream, char *line) {
+  int value = 0;
+  if (strcmp(line, "next") == 0) {
+    NetworkCommand command;
+    command.type = NetworkCommand::Type::NextPreset;
+    networkCommands.push(command);
+  } else if (sscanf(line, "preset %d", &value) == 1) {
+    NetworkCommand command;
+    command.type = NetworkCommand::Type::SelectPreset;
+    command.value = value;
+    networkCommands.push(command);
+  } else if (strncmp(line, "set ", 4) == 0 && strchr(line + 4, ' ') != nullptr) {
+    auto valueText = strchr(line + 4, ' ');
+    *valueText++ = '\0';
+    if (ParameterRegistry::instance().set(line + 4, strtof(valueText, nullptr)) == 0) {
+      stream.println("Unknown parameter");
+    }
+  } else if (strcmp(line, "params") == 0) {
+    printParameters(stream);
+  } else if (strcmp(line, "status") == 0) {
+    stream.print("Network CPU time ");
+    stream.print(networkBudget.lastUsedUs());
+    stream.println(" us / s");
+#if defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+    stream.print("Pixel frames ");
+    stream.print(pixelReceiver.frames());
+    stream.print(", incomplete ");
+    stream.print(pixelReceiver.incompleteFrames());
+    stream.print(", packets lost ");
+    stream.print(pixelReceiver.lostPackets());
+    stream.print(", invalid ");
+    stream.println(pixelReceiver.invalidPackets());
+#endif
+#ifdef ANALYSIS_BROADCAST_RECEIVE
+    stream.print("Analysis frames lost ");
+    stream.print(analysisReceiver.lostPackets());
+    stream.print(", late ");
+    stream.print(analysisReceiver.latePackets());
+    stream.print(", invalid ");
+    stream.print(analysisReceiver.invalidPackets());
+    stream.print(", resyncs ");
+    stream.print(analysisReceiver.resyncs());
+    stream.print(", clock offset ");
+    stream.print(static_cast<int32_t>(analysisReceiver.clockOffsetUs()));
+    stream.println(" us");
+#endif
+  } else {
+    stream.println("Unknown command");
   }
 }
+
+// Read available characters without blocking and handle complete lines
+void pollCommands(Stream &stream, CommandLine &line) {
+  while (stream.available() > 0) {
+    const char c = static_cast<char>(stream.read());
+    if (c == '\n' || c == '\r') {
+      if (line.size > 0) {
+        line.text[line.size] = '\0';
+        handleCommand(stream, line.text);
+        line.size = 0;
+      }
+    } else if (line.size < sizeof(line.text) - 1) {
+      line.text[line.size++] = c;
+    }
+  }
+}
+
+// Sleep until the next poll. Wakes up early for analysis frames to send or receive while the CPU budget lasts
+void waitForNetworkWork() {
+  const auto ticks = networkBudget.delayTicks(NETWORK_POLL_INTERVAL_MS);
+  if (networkBudget.isUsedUp()) {
+    vTaskDelay(ticks);
+    return;
+  }
+#if defined(ANALYSIS_BROADCAST_SEND)
+  ulTaskNotifyTake(pdTRUE, ticks);
+#elif defined(ANALYSIS_BROADCAST_RECEIVE)
+  analysisReceiver.wait(ticks * portTICK_PERIOD_MS);
+#else
+  vTaskDelay(ticks);
 #endif
+}
 
-void setup() {
-  Serial.begin(115200);
-  Serial.println("Running setup");
+#if defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+// Receive pixel frames. Packets are written straight into the frame they belong to, which is swapped in when the sender pushes it.
+// Runs in its own task, so streams are not limited by the network CPU budget
+void pixelStreamTask(void *parameter) {
+  if (!pixelReceiver.begin()) {
+    Log::error("Failed to open pixel stream socket\n");
+    vTaskDelete(nullptr);
+    return;
+  }
+  Log::info("Receiving pixel frames on UDP port %d\n", static_cast<int>(Ddp::DEFAULT_PORT));
+  while (true) {
+    pixelReceiver.wait(PIXEL_STREAM_WAIT_MS);
+#ifdef PIXEL_STREAM_INPUT
+    while (pixelReceiver.receive(screen.backBuffer())) {
+      screen.swap();
+    }
+#else
+    while (pixelReceiver.receive(pixelFrames.writeFrame().pixels)) {
+      pixelFrames.publish();
+    }
+#endif
+  }
+}
+#endif
+
+// Bring up WiFi, OTA updates and Bluetooth in the background, so setup() and the first frames never wait for them.
+// Then serves OTA updates and commands within NETWORK_CPU_BUDGET_US
+void networkTask(void *parameter) {
   // Generate host name for WiFi and Bluetooth
   String chipId = String((uint32_t)ESP.getEfuseMac(), HEX);
   chipId.toUpperCase();
   String hostName = String("Matrix-") + chipId;
 
-#ifdef ENABLE_OTA
+#ifdef ENABLE_WIFI
   // Set up WiFi
-  Serial.println("Setting up WiFi");
+  Log::info("Setting up WiFi\n");
   WiFi.hostname(hostName);
   WiFi.mode(WIFI_STA);
   WiFi.begin(wifiSsid, wifiPassword);
   while (WiFi.waitForConnectResult() != WL_CONNECTED) {
-    Serial.println("WiFi connection Failed! Rebooting...");
-    delay(5000);
-    ESP.restart();
+    Log::warning("WiFi connection failed! Retrying...\n");
+    vTaskDelay(pdMS_TO_TICKS(WIFI_RETRY_INTERVAL_MS));
+    WiFi.begin(wifiSsid, wifiPassword);
+  }
+  const IPAddress ip = WiFi.localIP();
+  Log::info("IP address: %d.%d.%d.%d\n", ip[0], ip[1], ip[2], ip[3]);
+#endif
+#ifdef ANALYSIS_BROADCAST_SEND
+  if (!analysisSender.begin()) {
+    Log::error("Failed to open analysis sender socket\n");
   }
+#endif
+#ifdef ANALYSIS_BROADCAST_RECEIVE
+  if (!analysisReceiver.begin()) {
+    Log::error("Failed to open analysis receiver socket or join multicast group\n");
+  }
+#endif
+#if defined(PIXEL_STREAM_INPUT) || defined(PIXEL_STREAM_LAYER)
+  if (xTaskCreatePinnedToCore(pixelStreamTask, "PixelStream", PIXEL_STREAM_TASK_STACK, nullptr, PIXEL_STREAM_TASK_PRIO, nullptr, 0) != pdPASS) {
+    Log::error("Failed to create pixel stream task\n");
+  }
+#endif
+
+#ifdef ENABLE_OTA
   // Set up OTA updates
-  Serial.println("Setting up OTA updates");
+  Log::info("Setting up OTA updates\n");
   ArduinoOTA.onStart([]() {
-              String type;
-              if (ArduinoOTA.getCommand() == U_FLASH)
-                type = "sketch";
-              else  // U_SPIFFS
-                type = "filesystem";
               // NOTE: if updating SPIFFS this would be the place to unmount SPIFFS using SPIFFS.end()
-              Serial.println("Start updating " + type);
+              Log::info("Start updating %s\n", ArduinoOTA.getCommand() == U_FLASH ? "sketch" : "filesystem");
             })
     .onEnd([]() {
-      Serial.println("\nEnd");
+      Log::info("OTA update finished\n");
     })
     .onProgress([](unsigned int progress, unsigned int total) {
-      Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+      // log every 10%, so the log ring is not flooded by one record per chunk
+      static unsigned lastTenth = 0;
+      const unsigned tenth = total > 0 ? (10 * static_cast<uint64_t>(progress)) / total : 0;
+      if (tenth != lastTenth) {
+        lastTenth = tenth;
+        Log::info("OTA progress %d%%\n", static_cast<int>(10 * tenth));
+      }
     })
     .onError([](ota_error_t error) {
-      Serial.printf("Error[%u]: ", error);
+      const char *reason = "Unknown";
       if (error == OTA_AUTH_ERROR)
-        Serial.println("Auth Failed");
+        reason = "Auth Failed";
       else if (error == OTA_BEGIN_ERROR)
-        Serial.println("Begin Failed");
+        reason = "Begin Failed";
       else if (error == OTA_CONNECT_ERROR)
-        Serial.println("Connect Failed");
+        reason = "Connect Failed";
       else if (error == OTA_RECEIVE_ERROR)
-        Serial.println("Receive Failed");
+        reason = "Receive Failed";
       else if (error == OTA_END_ERROR)
-        Serial.println("End Failed");
+        reason = "End Failed";
+      Log::error("OTA error %d: %s\n", static_cast<int>(error), reason);
     });
   ArduinoOTA.begin();
-  Serial.print("Hostname: ");
-  Serial.println(hostName);
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
-#else
-  // Turn Wifi off
-  Serial.println("Turning WiFi off");
-  WiFi.mode(WIFI_OFF);
+  // hostName lives as long as this task, which never returns, so it can be logged as a pointer
+  Log::info("Hostname: %s\n", hostName.c_str());
 #endif
 
 #ifdef ENABLE_BLUETOOTH
   // SerialBT.register_callback(bluetoothCallback);
   if (!SerialBT.begin(hostName)) {
-    Serial.println("An error occurred initializing Bluetooth!");
+    Log::error("An error occurred initializing Bluetooth!\n");
   } else {
-    Serial.print("Bluetooth initialized. Device name is ");
-    Serial.println(hostName);
+    Log::info("Bluetooth initialized. Device name is %s\n", hostName.c_str());
   }
   // Set up Bluetooth classic for legacy pairing
-  if (esp_bt_gap_set_pin(ESP_BT_PIN_TYPE_FIXED, strlen(bluetoothPinCode), reinterpret_cast<uint8_t *>(bluetoothPinCode)) == ESP_OK) {
-    Serial.print("Bluetooth pin code set to ");
-    Serial.println(bluetoothPinCode);
+  if (esp_bt_gap_set_pin(ESP_BT_PIN_TYPE_FIXED, strlen(bluetoothPinCode), reinterpret_cast<uint8_t *>(const_cast<char *>(bluetoothPinCode))) == ESP_OK) {
+    Log::info("Bluetooth pin code set to %s\n", bluetoothPinCode);
   } else {
-    Serial.println("Setting bluetooth pin code failed!");
+    Log::error("Setting bluetooth pin code failed!\n");
+  }
+#endif
+  Log::info("Network up after %d ms\n", static_cast<int>(millis()));
+
+  while (true) {
+    networkBudget.begin();
+#ifdef ENABLE_OTA
+    // Enable over-the-air updates
+    ArduinoOTA.handle();
+#endif
+#ifdef ENABLE_SERIAL_COMMANDS
+    pollCommands(Serial, serialLine);
+#endif
+#ifdef ENABLE_BLUETOOTH
+    pollCommands(SerialBT, bluetoothLine);
+    // report preset switches to the Bluetooth client
+    const EffectChain *preset = nullptr;
+    while (presetSwitches.pop(preset)) {
+      SerialBT.print("Preset ");
+      SerialBT.println(preset->name);
+    }
+#endif
+#ifdef ANALYSIS_BROADCAST_SEND
+    BroadcastPacket packet;
+    while (broadcastPackets.pop(packet)) {
+      analysisSender.send(packet.data, packet.size);
+    }
+#endif
+#ifdef ANALYSIS_BROADCAST_RECEIVE
+    // decode straight into the frame the render task picks up next
+    while (analysisReceiver.receive(analysisFrames.writeFrame(), micros())) {
+      analysisFrames.publish();
+    }
+#endif
+    networkBudget.end();
+    waitForNetworkWork();
   }
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  // print log messages from a background task, so no task blocks on the serial port
+  Log::Logger::instance().begin();
+  Log::info("Running setup\n");
+#ifdef LOCAL_ANALYSIS
+  // initialize microphone first. The reader task discards the microphone startup time while setup() continues
+  mic.begin();
 #endif
 
+  // construct effects and show the listening animation until audio arrives
+  buildPresets();
+#ifdef TILED_RENDERING
+  pipeline.begin();
+#elif defined(PARALLEL_RENDERING)
+  pipeline.beginWorker(0, RENDER_WORKER_PRIO);
+#endif
+  pipeline.setChain(&listeningChain);
   // initialize LED matrix
   matrix.addLayer(&backgroundLayer);
   matrix.setBrightness(128);
-  matrix.setRefreshRate(50);
+  matrix.setRefreshRate(DISPLAY_REFRESH_RATE_HZ);
   matrix.begin();
-  // initialize microphone
-  mic.begin();
-  Serial.println("Starting sampling from mic");
+#ifdef PIXEL_STREAM_INPUT
+  // the pixel stream task swaps received frames in. Local effects are not rendered
+  Log::info("Showing pixel frames from the network\n");
+#else
+  // render frames at a fixed rate on the same core as the analysis loop, but with higher priority
+  renderScheduler.begin(renderFrame, 1, 2);
+#endif
+
+#ifdef ANALYSIS_BROADCAST_RECEIVE
+  Log::info("Receiving analysis frames from the network\n");
+#elif defined(LOCAL_ANALYSIS)
+#ifndef FIXED_POINT_ANALYSIS
+  // A-weighting, sound level accumulation and resonator updates run in the reader task.
+  // The main loop gets A-weighted samples and only reads the band amplitudes when using the band bank
+  mic.setSampleHook([](float *buffer, [[maybe_unused]] unsigned count) {
+#ifdef PRINT_ANALYSIS_CYCLES
+    auto startCycles = ESP.getCycleCount();
+#endif
+    // apply A-Weighting filter for perceptive loudness. See: https://www.noisemeters.com/help/faq/frequency-weighting/
+    A_weighting.applyFilters(buffer, buffer, SAMPLE_COUNT);
+    soundLevelMeter.applyGain(A_weighting.gain, buffer, SAMPLE_COUNT);
+#ifdef STEREO_ANALYSIS
+    A_weightingRight.applyFilters(buffer + SAMPLE_COUNT, buffer + SAMPLE_COUNT, SAMPLE_COUNT);
+    soundLevelMeter.applyGain(A_weightingRight.gain, buffer + SAMPLE_COUNT, SAMPLE_COUNT);
+#endif
+    soundLevelMeter.update();
+#ifdef ANALYSIS_BAND_BANK
+    bandBank.process(buffer, count);
+#endif
+#ifdef PRINT_ANALYSIS_CYCLES
+    analysisCycles += ESP.getCycleCount() - startCycles;
+#endif
+  });
+#endif
+  Log::info("Starting sampling from mic\n");
   mic.startSampling();
+#endif
+
+#ifdef ENABLE_NETWORK
+  // start WiFi, OTA updates and Bluetooth in the background
+  if (xTaskCreatePinnedToCore(networkTask, "Network", NETWORK_TASK_STACK, nullptr, NETWORK_TASK_PRIO, &networkHandle, 0) != pdPASS || networkHandle == nullptr) {
+    Log::error("Failed to create network task\n");
+  }
+#endif
+#ifndef ENABLE_WIFI
+  // Turn Wifi off
+  Log::info("Turning WiFi off\n");
+  WiFi.mode(WIFI_OFF);
+#endif
+
+#ifdef CHECK_FFT_BACKENDS
+  FFTCheck<FFT_SAMPLE_COUNT, FFT_SAMPLE_RATE_HZ>::runAll();
+#endif
+#ifdef CHECK_ANALYSIS_APPROXIMATIONS
+  AnalysisCheck<FFT_SAMPLE_COUNT, NR_OF_BANDS, MAX_ANALYSIS_FREQUENCY_HZ, FFT_SAMPLE_RATE_HZ, MIC_NOISE_DB, MIC_OVERLOAD_DB>::runAll(MIC_OFFSET_DB + MIC_REF_DB, FFT_AMPLITUDE_SCALE / MIC_REF_AMPL);
+#endif
+#ifdef CHECK_PARTICLE_BENCHMARK
+  ParticlesCheck<64, 64, NR_OF_BANDS, RENDER_RATE_HZ>::runAll();
+#endif
+  Log::info("Setup done after %d ms\n", static_cast<int>(millis()));
+}
+
+// ------------------------------------------------------------------------------------------
+
+static_assert(NR_OF_BANDS <= AnalysisFrame::MAX_BANDS, "Too many bands for AnalysisFrame");
+static constexpr unsigned NR_OF_MAGNITUDES = (MAX_ANALYSIS_FREQUENCY_HZ * FFT_SAMPLE_COUNT) / FFT_SAMPLE_RATE_HZ;  // FFT bins up to MAX_ANALYSIS_FREQUENCY_HZ
+static_assert(NR_OF_MAGNITUDES <= AnalysisFrame::MAX_MAGNITUDES, "Too many FFT bins for AnalysisFrame");
+uint32_t analysisSequence = 0;
+
+// Store decimated A-weighted waveform of the current block in the next analysis frame. Stereo channels are averaged
+void captureWaveform(const SampleValue *buffer) {
+  auto &frame = analysisFrames.writeFrame();
+  constexpr unsigned step = SAMPLE_COUNT / AnalysisFrame::WAVEFORM_SIZE;
+  constexpr float scale = 1.0F / (CHANNELS * (1 << (MIC_BITS - 1)));
+  for (unsigned i = 0; i < AnalysisFrame::WAVEFORM_SIZE; i++) {
+    float value = 0.0F;
+    for (unsigned channel = 0; channel < CHANNELS; channel++) {
+      value += static_cast<float>(buffer[channel * SAMPLE_COUNT + i * step]);
+    }
+    frame.waveform[i] = value * scale;
+  }
+}
+
+// Fill and publish the next analysis frame to the render task. Pass nullptr as leftLevels and rightLevels for mono analysis
+void publishAnalysisFrame(const float *levels, const float *peaks, const float *leftLevels, const float *rightLevels, const float *pitchClasses, const float *notes, const float *magnitudes, unsigned nrOfMagnitudes, bool isBeat) {
+  static_assert(ChromaAnalysis::NR_OF_OCTAVES <= AnalysisFrame::MAX_OCTAVES, "Too many chroma octaves for AnalysisFrame");
+  auto &frame = analysisFrames.writeFrame();
+  auto now = micros();
+  frame.sequence = analysisSequence++;
+  frame.timeUs = now;
+  frame.lastBeatTimeUs = now - 1000 * beats.timeSinceLastBeatMs();
+  frame.isBeat = isBeat;
+  frame.nrOfBands = NR_OF_BANDS;
+  memcpy(frame.levels, levels, sizeof(float) * NR_OF_BANDS);
+  memcpy(frame.peaks, peaks, sizeof(float) * NR_OF_BANDS);
+  frame.nrOfChannels = leftLevels != nullptr && rightLevels != nullptr ? 2 : 1;
+  memcpy(frame.leftLevels, frame.nrOfChannels == 2 ? leftLevels : levels, sizeof(float) * NR_OF_BANDS);
+  memcpy(frame.rightLevels, frame.nrOfChannels == 2 ? rightLevels : levels, sizeof(float) * NR_OF_BANDS);
+  frame.nrOfOctaves = pitchClasses != nullptr && notes != nullptr ? ChromaAnalysis::NR_OF_OCTAVES : 0;
+  frame.firstOctave = ChromaAnalysis::FIRST_OCTAVE;
+  if (frame.nrOfOctaves > 0) {
+    memcpy(frame.chroma, pitchClasses, sizeof(frame.chroma));
+    memcpy(frame.octaveChroma, notes, sizeof(float) * AnalysisFrame::NR_OF_PITCH_CLASSES * ChromaAnalysis::NR_OF_OCTAVES);
+  }
+  frame.nrOfMagnitudes = nrOfMagnitudes;
+  if (nrOfMagnitudes > 0) {
+    memcpy(frame.magnitudes, magnitudes, sizeof(float) * nrOfMagnitudes);
+  }
+#ifndef FIXED_POINT_ANALYSIS
+  frame.soundLevels = soundLevelMeter.levels();
+#endif
+#ifdef ANALYSIS_BROADCAST_SEND
+  // queue frame for the network task and wake it up. Frames are dropped while WiFi is down or the network task is busy
+  BroadcastPacket packet;
+  packet.size = AnalysisPacket::encode(frame, packet.data);
+  if (broadcastPackets.push(packet) && networkHandle != nullptr) {
+    xTaskNotifyGive(networkHandle);
+  }
+#endif
+  analysisFrames.publish();
 }
 
 //#define PRINT_LOOP_TIME
@@ -238,34 +933,82 @@ long lastLoopTime = 0;
 #endif
 
 void loop() {
-  Serial.println("Starting loop");
+#ifndef LOCAL_ANALYSIS
+  // analysis frames or pixels arrive from the network. Nothing to analyse here
+  vTaskDelete(nullptr);
+#endif
+  Log::info("Starting loop\n");
   // Get samples from other ESP32 core that receives the I2S audio data
   while (xQueueReceive(mic.sampleQueue(), &samples, portMAX_DELAY)) {
     /*for (int i = 0; i < SAMPLE_COUNT/4; ++i)
     {
       Serial.print(String(samples[i], 2) + String(", "));
     }*/
-    // apply A-Weighting filter for perceptive loudness. See: https://www.noisemeters.com/help/faq/frequency-weighting/
-    A_weighting.applyFilters(samples, samples, SAMPLE_COUNT);
-    A_weighting.applyGain(samples, samples, SAMPLE_COUNT);
+#ifdef PRINT_ANALYSIS_CYCLES
+    auto startCycles = ESP.getCycleCount();
+#endif
+#ifdef ANALYSIS_BAND_BANK
+    // get current band amplitudes from resonators
+    bandBank.read(bandAmplitudes);
+    captureWaveform(samples);
+    auto magnitudes = normalization.applyToBands(bandAmplitudes, NR_OF_BANDS);
+    auto [levels, peaks] = spectrum.updateBands(magnitudes);
+#elif defined(STEREO_ANALYSIS)
+    // both channels have been A-weighted by the reader task
+    auto samplesRight = samples + SAMPLE_COUNT;
+    captureWaveform(samples);
+#ifdef ENABLE_DECIMATION
+    decimator.apply(samples);
+    decimatorRight.apply(samplesRight);
+#endif
+    // transform both channels with one complex FFT. The AGC follows the average and is applied to both channels unchanged
+    auto [amplitudesLeft, amplitudesRight] = fft.calculateStereo(samplesRight);
+    for (unsigned i = 0; i < FFT_SAMPLE_COUNT / 2; i++) {
+      midAmplitudes[i] = 0.5F * (amplitudesLeft[i] + amplitudesRight[i]);
+    }
+    auto magnitudes = normalization.apply(midAmplitudes);
+    auto [levels, peaks] = spectrum.update(magnitudes);
+    auto [pitchClasses, notes] = chroma.update(magnitudes);
+    auto leftLevels = spectrumLeft.update(normalization.applyWithLastGain(amplitudesLeft)).first;
+    auto rightLevels = spectrumRight.update(normalization.applyWithLastGain(amplitudesRight)).first;
+#else
+#ifdef FIXED_POINT_ANALYSIS
+    // apply A-Weighting filter for perceptive loudness. The floating-point path is A-weighted by the reader task
+    A_weightingQ31.applyFilters(samples, samples, SAMPLE_COUNT);
+    A_weightingQ31.applyGain(samples, samples, SAMPLE_COUNT);
+#endif
+    captureWaveform(samples);
+#ifdef ENABLE_DECIMATION
+    // low-pass filter and reduce sample rate. The first FFT_SAMPLE_COUNT samples are valid afterwards
+    decimator.apply(samples);
+#endif
     // apply FFT to samples and return amplitudes
     auto amplitudes = fft.calculate();
     auto magnitudes = normalization.apply(amplitudes);
     auto [levels, peaks] = spectrum.update(magnitudes);
+    auto [pitchClasses, notes] = chroma.update(magnitudes);
+#endif
+#ifdef PRINT_ANALYSIS_CYCLES
+    analysisCycles += ESP.getCycleCount() - startCycles;
+    printAnalysisCycles(SAMPLE_COUNT);
+#endif
     auto probabilities = beats.update(levels);
     bool isBeat = beats.timeSinceLastBeatMs() < 50;
     //  Serial.println(beats.timeSinceLastBeatMs());
-    pipeline.render(levels, peaks, isBeat);
-    screen.blit(pipeline.output());
-    screen.swap();
-    // Enable over-the-air updates
-#ifdef ENABLE_OTA
-    checkOTA();
+    // hand analysis results to render task
+#ifdef ANALYSIS_BAND_BANK
+    publishAnalysisFrame(levels, peaks, nullptr, nullptr, nullptr, nullptr, nullptr, 0, isBeat);
+#elif defined(STEREO_ANALYSIS)
+    publishAnalysisFrame(levels, peaks, leftLevels, rightLevels, pitchClasses, notes, magnitudes, NR_OF_MAGNITUDES, isBeat);
+#else
+    publishAnalysisFrame(levels, peaks, nullptr, nullptr, pitchClasses, notes, magnitudes, NR_OF_MAGNITUDES, isBeat);
+#endif
+#ifdef PRINT_SOUND_LEVELS
+    printSoundLevels(soundLevelMeter.levels(), SAMPLE_COUNT);
 #endif
 #ifdef PRINT_LOOP_TIME
     auto currentLoopTime = millis();
-    Serial.print(currentLoopTime - lastLoopTime);
-    Serial.println(" ms");
+    Log::info("%l ms\n", static_cast<long>(currentLoopTime - lastLoopTime));
     lastLoopTime = currentLoopTime;
 #endif
   }
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "analysis_frame.h"
+#include "analysis_packet.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Estimates the offset between a remote and the local microsecond clock from packet timestamps.
+// The smallest difference (local - remote) belongs to the packet with the least network delay. Minima of two
+// alternating windows are kept, so the estimate follows clock drift and recovers from clock jumps
+class ClockOffsetEstimator
+{
+    static constexpr unsigned WINDOW = 128; // Packets per window, ~2.7s at 47 frames / s
+
+public:
+    /// @brief Add timestamp pair of a received packet
+    void update(uint32_t remoteUs, uint32_t localUs)
+    {
+        const uint32_t difference = localUs - remoteUs;
+        if (m_count == 0 || isEarlier(difference, m_current))
+        {
+            m_current = difference;
+        }
+        if (++m_count >= WINDOW)
+        {
+            m_previous = m_current;
+            m_hasPrevious = true;
+            m_count = 0;
+        }
+    }
+
+    /// @brief Offset to add to remote times to get local times in us
+    uint32_t offsetUs() const
+    {
+        if (!m_hasPrevious || (m_count > 0 && isEarlier(m_current, m_previous)))
+        {
+            return m_current;
+        }
+        return m_previous;
+    }
+
+    /// @brief Convert remote time to local time
+    uint32_t toLocal(uint32_t remoteUs) const
+    {
+        return remoteUs + offsetUs();
+    }
+
+private:
+    // compare wrapping differences
+    static bool isEarlier(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+
+    uint32_t m_current = 0;  // Minimum of the current window
+    uint32_t m_previous = 0; // Minimum of the last full window
+    unsigned m_count = 0;
+    bool m_hasPrevious = false;
+};
+
+// Sends analysis frames as UDP packets, usually to a multicast group. Uses BSD sockets, so it also runs on a Linux host
+class AnalysisSender
+{
+public:
+    ~AnalysisSender()
+    {
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    /// @brief Open socket
+    /// @p address Multicast group or unicast IPv4 address, e.g. "127.0.0.1" for tests
+    /// @p port Destination UDP port
+    /// @return Returns false if the socket could not be opened
+    bool begin(const char *address = AnalysisPacket::DEFAULT_GROUP, uint16_t port = AnalysisPacket::DEFAULT_PORT)
+    {
+        m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        const uint8_t ttl = 1; // stay in the local network
+        setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        memset(&m_destination, 0, sizeof(m_destination));
+        m_destination.sin_family = AF_INET;
+        m_destination.sin_port = htons(port);
+        m_destination.sin_addr.s_addr = inet_addr(address);
+        return true;
+    }
+
+    /// @brief Encode and send frame. Never blocks
+    /// @return Returns false if the packet could not be sent
+    bool send(const AnalysisFrame &frame)
+    {
+        const auto size = AnalysisPacket::encode(frame, m_packet);
+        return send(m_packet, size);
+    }
+
+    /// @brief Send packet encoded with AnalysisPacket::encode(), e.g. in another task. Never blocks
+    /// @return Returns false if the packet could not be sent
+    bool send(const uint8_t *packet, unsigned size)
+    {
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        return sendto(m_socket, packet, size, MSG_DONTWAIT, reinterpret_cast<const sockaddr *>(&m_destination), sizeof(m_destination)) == static_cast<ssize_t>(size);
+    }
+
+private:
+    int m_socket = -1;
+    sockaddr_in m_destination = {};
+    uint8_t m_packet[AnalysisPacket::MAX_SIZE];
+};
+
+// Receives analysis frames sent by an AnalysisSender and converts their times to the local clock.
+// Packets are decoded straight from the socket buffer into the frame, e.g. AnalysisFrameExchange::writeFrame().
+// A sender that restarts begins again at sequence 0 with a new clock. The receiver detects this from a large backward
+// jump of the sequence or a pause in packets and starts over, so it does not skip the new packets as late
+class AnalysisReceiver
+{
+    static constexpr uint32_t RESYNC_FRAMES = 256;         // Backward sequence jump treated as a restart, ~5s at 47 frames / s
+    static constexpr uint32_t RESYNC_TIMEOUT_US = 1000000; // Pause after which the next packet starts over
+
+public:
+    ~AnalysisReceiver()
+    {
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    /// @brief Open socket and join multicast group
+    /// @p address Multicast group to join or nullptr to receive unicast packets only
+    /// @p port UDP port to listen on
+    /// @return Returns false if the socket could not be opened or the group could not be joined. Unicast packets are still received then
+    bool begin(const char *address = AnalysisPacket::DEFAULT_GROUP, uint16_t port = AnalysisPacket::DEFAULT_PORT)
+    {
+        m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        const int reuse = 1;
+        setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(m_socket, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) < 0)
+        {
+            close(m_socket);
+            m_socket = -1;
+            return false;
+        }
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+        if (address != nullptr)
+        {
+            ip_mreq group = {};
+            group.imr_multiaddr.s_addr = inet_addr(address);
+            group.imr_interface.s_addr = htonl(INADDR_ANY);
+            return setsockopt(m_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) == 0;
+        }
+        return true;
+    }
+
+    /// @brief Wait until a packet arrives or the timeout expires
+    /// @return Returns true if a packet can be received
+    bool wait(uint32_t timeoutMs)
+    {
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(m_socket, &sockets);
+        timeval timeout = {static_cast<decltype(timeout.tv_sec)>(timeoutMs / 1000), static_cast<decltype(timeout.tv_usec)>((timeoutMs % 1000) * 1000)};
+        return select(m_socket + 1, &sockets, nullptr, nullptr, &timeout) > 0;
+    }
+
+    /// @brief Receive the next packet into frame without blocking. Late or invalid packets are skipped
+    /// @p frame Frame to decode into. Only changed if true is returned
+    /// @p localUs Local time of reception in us, e.g. from micros()
+    /// @return Returns true if a new frame was received
+    bool receive(AnalysisFrame &frame, uint32_t localUs)
+    {
+        while (m_socket >= 0)
+        {
+            const auto size = recv(m_socket, m_packet, sizeof(m_packet), MSG_DONTWAIT);
+            if (size <= 0)
+            {
+                return false;
+            }
+            if (size < static_cast<ssize_t>(AnalysisPacket::HEADER_SIZE) || m_packet[2] != AnalysisPacket::VERSION)
+            {
+                m_invalidPackets++;
+                continue;
+            }
+            // skip packets older than the last one, e.g. reordered by the network, unless the sender restarted
+            const uint32_t sequence = AnalysisPacket::sequence(m_packet);
+            const auto step = static_cast<int32_t>(sequence - m_lastSequence);
+            const bool isRestart = m_hasReceived && (step < -static_cast<int32_t>(RESYNC_FRAMES) || localUs - m_lastReceiveUs >= RESYNC_TIMEOUT_US);
+            if (m_hasReceived && !isRestart && step <= 0)
+            {
+                m_latePackets++;
+                continue;
+            }
+            if (!AnalysisPacket::decode(m_packet, static_cast<unsigned>(size), frame))
+            {
+                m_invalidPackets++;
+                continue;
+            }
+            if (isRestart)
+            {
+                // sequences and times of the old and the new sender clock can not be compared
+                m_clock = ClockOffsetEstimator();
+                m_resyncs++;
+            }
+            else if (m_hasReceived)
+            {
+                m_lostPackets += step - 1;
+            }
+            m_lastSequence = sequence;
+            m_lastReceiveUs = localUs;
+            m_hasReceived = true;
+            // move times to the local clock
+            m_clock.update(frame.timeUs, localUs);
+            const uint32_t beatAgeUs = frame.timeUs - frame.lastBeatTimeUs;
+            frame.timeUs = m_clock.toLocal(frame.timeUs);
+            frame.lastBeatTimeUs = frame.timeUs - beatAgeUs;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Estimated offset of the sender clock in us
+    uint32_t clockOffsetUs() const
+    {
+        return m_clock.offsetUs();
+    }
+
+    /// @brief Number of packets lost, i.e. sequence gaps. Gaps across a resync are not counted
+    uint32_t lostPackets() const
+    {
+        return m_lostPackets;
+    }
+
+    /// @brief Number of packets skipped because they arrived out of order
+    uint32_t latePackets() const
+    {
+        return m_latePackets;
+    }
+
+    /// @brief Number of packets skipped because they were invalid or had a different protocol version
+    uint32_t invalidPackets() const
+    {
+        return m_invalidPackets;
+    }
+
+    /// @brief Number of times the receiver started over, e.g. because the sender restarted
+    uint32_t resyncs() const
+    {
+        return m_resyncs;
+    }
+
+private:
+    int m_socket = -1;
+    uint8_t m_packet[AnalysisPacket::MAX_SIZE];
+    ClockOffsetEstimator m_clock;
+    uint32_t m_lastSequence = 0;
+    uint32_t m_lastReceiveUs = 0;
+    bool m_hasReceived = false;
+    uint32_t m_lostPackets = 0;
+    uint32_t m_latePackets = 0;
+    uint32_t m_invalidPackets = 0;
+    uint32_t m_resyncs = 0;
+};
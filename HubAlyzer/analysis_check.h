@@ -0,0 +1,377 @@
+#pragma once
+
+#include "approx.h"
+#include "cycle_counter.h"
+#include "fft.h"
+#include "fft_check.h"
+#include "normalization.h"
+#include "serial_printf.h"
+#include "spectrum.h"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Accuracy versus speed of the approximations in the analysis chain. Call from setup() to print results to the serial port.
+// Golden test signals (tones at bin centres and bin edges, quiet tones, noise, a sweep) are run through FFT, dB conversion,
+// normalization and band accumulation with each option. Band levels are compared to the same chain fed with double precision
+// DFT magnitudes and exact logarithms. Reports max. and RMS error per band in dB and the cycles of the stage the option replaces.
+// ArduinoFFT approximations are compile-time options, see FFT_ARDUINO_PRECISE in fft_backend_arduino.h.
+// The Approx kernels of approx.h are compared to <cmath> for every precision tier and checked against their documented error bounds.
+// Also runs on the host without ArduinoFFT, see test/analysis_check_test.cpp, where it measures nanoseconds instead of cycles
+// SAMPLE_COUNT = Number of samples going into the FFT. Must be a power-of-two
+// NR_OF_BANDS = Number of spectrum bands to compare
+// MAX_HZ = Maximum / end of frequency spectrum
+// SAMPLE_RATE_HZ = Sample rate of FFT input in Hz
+// AUDIO_NOISE_DB = Audio noise floor in dB, like Normalization
+// AUDIO_MAX_DB = Max. audio signal in dB, like Normalization
+template <unsigned SAMPLE_COUNT, unsigned NR_OF_BANDS, unsigned MAX_HZ, unsigned SAMPLE_RATE_HZ, unsigned AUDIO_NOISE_DB, unsigned AUDIO_MAX_DB>
+class AnalysisCheck
+{
+    static constexpr unsigned NR_OF_SIGNALS = 8;      // See generate()
+    static constexpr unsigned NR_OF_SETTLE_RUNS = 64; // Spectrum updates until smoothing has settled
+    static constexpr unsigned NR_OF_KERNEL_VALUES = 1024;
+    static constexpr float LevelToDb = static_cast<float>(AUDIO_MAX_DB - AUDIO_NOISE_DB); // Band level 1 in dB
+    static constexpr float MaxBandErrorDb = 0.5F;     // Maximum allowed band level error against double precision
+
+    using Normalizer = Normalization<SAMPLE_COUNT, AUDIO_NOISE_DB, AUDIO_MAX_DB, MAX_HZ, SAMPLE_RATE_HZ>;
+    using Bands = Spectrum<SAMPLE_COUNT, NR_OF_BANDS, MAX_HZ, SAMPLE_RATE_HZ>;
+
+    // Conversion of FFT amplitudes to dB values
+    enum class DbConversion
+    {
+        Log10f,     // std::log10 per amplitude
+        Log10fFast, // log10f_fast per amplitude
+        Kernel      // Approx::amplitudeToDb over all amplitudes, like the sketch
+    };
+
+    // Band levels of all signals
+    struct Levels
+    {
+        float values[NR_OF_SIGNALS][NR_OF_BANDS];
+    };
+
+    // Documented max. errors of the Approx kernels of one precision tier, see approx.h
+    struct KernelBounds
+    {
+        float log2;
+        float exp2;
+        float sqrt;
+        float rsqrt;
+        float sincos;
+        float atan2;
+    };
+
+public:
+    /// @brief Run all options available on this platform
+    /// @p offsetDb, amplitudeScale Convert FFT amplitude v to dB like the sketch: offsetDb + 20 * log10(v * amplitudeScale)
+    /// @return Returns true if all options stayed within MaxBandErrorDb and all kernels within their documented error bounds
+    static bool runAll(float offsetDb, float amplitudeScale)
+    {
+        AnalysisCheck check(offsetDb, amplitudeScale);
+        Serial_printf("Analysis check, %d samples, %d bands. Errors in dB of band levels against double precision\n", SAMPLE_COUNT, NR_OF_BANDS);
+        bool passed = check.run<FFTBackendReference>("Reference FFT", DbConversion::Log10f);
+        passed = check.run<FFTBackendReference>("Reference FFT", DbConversion::Log10fFast) && passed;
+        passed = check.run<FFTBackendReference>("Reference FFT", DbConversion::Kernel) && passed;
+#ifdef ARDUINO
+#ifdef FFT_ARDUINO_PRECISE
+        passed = check.run<FFTBackendArduino>("ArduinoFFT (precise)", DbConversion::Log10f) && passed;
+        passed = check.run<FFTBackendArduino>("ArduinoFFT (precise)", DbConversion::Kernel) && passed;
+#else
+        passed = check.run<FFTBackendArduino>("ArduinoFFT (FFT_SPEED_OVER_PRECISION, FFT_SQRT_APPROXIMATION)", DbConversion::Log10f) && passed;
+        passed = check.run<FFTBackendArduino>("ArduinoFFT (FFT_SPEED_OVER_PRECISION, FFT_SQRT_APPROXIMATION)", DbConversion::Kernel) && passed;
+#endif
+#endif
+#if __has_include("esp_dsp.h")
+        passed = check.run<FFTBackendEspDsp>("esp-dsp", DbConversion::Log10f) && passed;
+        passed = check.run<FFTBackendEspDsp>("esp-dsp", DbConversion::Kernel) && passed;
+#endif
+        Serial_printf("Approx kernels, %d values. Errors against <cmath>\n", NR_OF_KERNEL_VALUES);
+        passed = checkKernels<ApproxPrecision::Low>("Low", {1.6e-3F, 1.1e-4F, 1.8e-3F, 1.8e-3F, 3.1e-4F, 1.3e-3F}) && passed;
+        passed = checkKernels<ApproxPrecision::Medium>("Medium", {3.5e-5F, 3.7e-6F, 4.8e-6F, 4.8e-6F, 1.2e-6F, 2.3e-5F}) && passed;
+        passed = checkKernels<ApproxPrecision::High>("High", {4.5e-6F, 1.2e-7F, 2e-7F, 2e-7F, 1e-7F, 4e-7F}) && passed;
+        return passed;
+    }
+
+private:
+    AnalysisCheck(float offsetDb, float amplitudeScale)
+        : m_offsetDb(offsetDb), m_amplitudeScale(amplitudeScale)
+    {
+        // golden band levels from double precision magnitudes and exact logarithms
+        std::vector<double> magnitudes(SAMPLE_COUNT / 2);
+        std::vector<float> samples(SAMPLE_COUNT);
+        for (unsigned signal = 0; signal < NR_OF_SIGNALS; signal++)
+        {
+            generate(signal, samples.data());
+            FFTCheck<SAMPLE_COUNT, SAMPLE_RATE_HZ>::referenceMagnitudes(samples.data(), magnitudes.data());
+            for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+            {
+                samples[i] = static_cast<float>(magnitudes[i]);
+            }
+            bandLevels(samples.data(), DbConversion::Log10f, m_golden->values[signal]);
+        }
+    }
+
+    // Run all signals through FFT backend and dB conversion, compare with golden levels and print results.
+    // Returns true if the max. error is within MaxBandErrorDb
+    template <template <unsigned, unsigned> class BACKEND>
+    bool run(const char *name, DbConversion conversion)
+    {
+        std::vector<float> samples(SAMPLE_COUNT);
+        auto backend = std::unique_ptr<BACKEND<SAMPLE_COUNT, SAMPLE_RATE_HZ>>(new BACKEND<SAMPLE_COUNT, SAMPLE_RATE_HZ>(samples.data()));
+        auto levels = std::unique_ptr<Levels>(new Levels());
+        uint32_t fftCycles = 0;
+        uint32_t dbCycles = 0;
+        for (unsigned signal = 0; signal < NR_OF_SIGNALS; signal++)
+        {
+            generate(signal, samples.data());
+            const auto start = CycleCounter::now();
+            backend->calculate();
+            fftCycles += CycleCounter::now() - start;
+            dbCycles += bandLevels(samples.data(), conversion, levels->values[signal]);
+        }
+        const char *conversionName = conversion == DbConversion::Log10f ? "log10f" : (conversion == DbConversion::Log10fFast ? "log10f_fast" : "Approx::amplitudeToDb");
+        Serial_printf("%s, %s: %l FFT %s, %l dB %s / block\n", name, conversionName, static_cast<long>(fftCycles / NR_OF_SIGNALS), CycleCounter::Unit,
+                      static_cast<long>(dbCycles / NR_OF_SIGNALS), CycleCounter::Unit);
+        const bool passed = printErrors(*levels) <= MaxBandErrorDb;
+        Serial_printf("  -> %s\n", passed ? "passed" : "FAILED");
+        return passed;
+    }
+
+    // Normalize amplitudes and accumulate them to bands. Returns the time spent on dB conversion and normalization
+    uint32_t bandLevels(float *amplitudes, DbConversion conversion, float *levels) const
+    {
+        const float offsetDb = m_offsetDb;
+        const float scale = m_amplitudeScale;
+        std::unique_ptr<Normalizer> normalizer;
+        if (conversion == DbConversion::Log10f)
+        {
+            normalizer.reset(new Normalizer([offsetDb, scale](float v)
+                                            { return offsetDb + 20.0F * std::log10(v * scale); }));
+        }
+        else if (conversion == DbConversion::Log10fFast)
+        {
+            normalizer.reset(new Normalizer([offsetDb, scale](float v)
+                                            { return offsetDb + 20.0F * log10f_fast(v * scale); }));
+        }
+        else
+        {
+            normalizer.reset(new Normalizer(offsetDb + 20.0F * std::log10(scale)));
+        }
+        const auto start = CycleCounter::now();
+        const auto magnitudes = normalizer->apply(amplitudes, false);
+        const uint32_t cycles = CycleCounter::now() - start;
+        // feed the same magnitudes until the smoothing of the spectrum has settled
+        auto bands = std::unique_ptr<Bands>(new Bands());
+        const float *bandLevels = nullptr;
+        for (unsigned i = 0; i < NR_OF_SETTLE_RUNS; i++)
+        {
+            bandLevels = bands->update(magnitudes).first;
+        }
+        memcpy(levels, bandLevels, sizeof(float) * NR_OF_BANDS);
+        return cycles;
+    }
+
+    // Print max. and RMS error over all signals per band. Returns the max. error over all bands in dB
+    float printErrors(const Levels &levels) const
+    {
+        float maxErrors[NR_OF_BANDS] = {0};
+        float rmsErrors[NR_OF_BANDS] = {0};
+        float maxError = 0.0F;
+        float sumSquares = 0.0F;
+        for (unsigned band = 0; band < NR_OF_BANDS; band++)
+        {
+            for (unsigned signal = 0; signal < NR_OF_SIGNALS; signal++)
+            {
+                const float error = std::fabs(levels.values[signal][band] - m_golden->values[signal][band]) * LevelToDb;
+                maxErrors[band] = error > maxErrors[band] ? error : maxErrors[band];
+                rmsErrors[band] += error * error;
+            }
+            sumSquares += rmsErrors[band];
+            rmsErrors[band] = std::sqrt(rmsErrors[band] / NR_OF_SIGNALS);
+            maxError = maxErrors[band] > maxError ? maxErrors[band] : maxError;
+        }
+        Serial_printf("  Max. error %3f dB, RMS error %3f dB\n  Max. per band:", maxError, std::sqrt(sumSquares / (NR_OF_BANDS * NR_OF_SIGNALS)));
+        for (unsigned band = 0; band < NR_OF_BANDS; band++)
+        {
+            Serial_printf(" %3f", maxErrors[band]);
+        }
+        Serial_printf("\n  RMS per band:");
+        for (unsigned band = 0; band < NR_OF_BANDS; band++)
+        {
+            Serial_printf(" %3f", rmsErrors[band]);
+        }
+        Serial_printf("\n");
+        return maxError;
+    }
+
+    // Compare the Approx kernels of precision tier P to the <cmath> functions over typical input ranges.
+    // Prints max. errors (absolute for log2, sincos, atan2, relative otherwise) and time per value.
+    // Returns true if all kernels are within bounds
+    template <ApproxPrecision P>
+    static bool checkKernels(const char *tier, const KernelBounds &bounds)
+    {
+        constexpr float Pi = 3.1415926535F;
+        std::vector<float> x(NR_OF_KERNEL_VALUES);
+        std::vector<float> y(NR_OF_KERNEL_VALUES);
+        std::vector<float> results(NR_OF_KERNEL_VALUES);
+        std::vector<float> results2(NR_OF_KERNEL_VALUES);
+        std::vector<float> expected(NR_OF_KERNEL_VALUES);
+        std::vector<float> expected2(NR_OF_KERNEL_VALUES);
+        const auto n = NR_OF_KERNEL_VALUES;
+        // log2 over [1e-6, 1e6]
+        for (unsigned i = 0; i < n; i++)
+        {
+            x[i] = std::pow(10.0F, 12.0F * i / n - 6.0F);
+        }
+        auto start = CycleCounter::now();
+        Approx::log2<P>(x.data(), results.data(), n);
+        auto kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = std::log2(x[i]);
+        }
+        bool passed = printKernel("log2", tier, results.data(), expected.data(), false, bounds.log2, kernelCycles, CycleCounter::now() - start);
+        // exp2 over [-20, 20]
+        for (unsigned i = 0; i < n; i++)
+        {
+            x[i] = 40.0F * i / n - 20.0F;
+        }
+        start = CycleCounter::now();
+        Approx::exp2<P>(x.data(), results.data(), n);
+        kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = std::exp2(x[i]);
+        }
+        passed = printKernel("exp2", tier, results.data(), expected.data(), true, bounds.exp2, kernelCycles, CycleCounter::now() - start) && passed;
+        // sqrt and rsqrt over [1e-6, 1e6]
+        for (unsigned i = 0; i < n; i++)
+        {
+            x[i] = std::pow(10.0F, 12.0F * i / n - 6.0F);
+        }
+        start = CycleCounter::now();
+        Approx::sqrt<P>(x.data(), results.data(), n);
+        kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = std::sqrt(x[i]);
+        }
+        passed = printKernel("sqrt", tier, results.data(), expected.data(), true, bounds.sqrt, kernelCycles, CycleCounter::now() - start) && passed;
+        start = CycleCounter::now();
+        Approx::rsqrt<P>(x.data(), results.data(), n);
+        kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = 1.0F / std::sqrt(x[i]);
+        }
+        passed = printKernel("rsqrt", tier, results.data(), expected.data(), true, bounds.rsqrt, kernelCycles, CycleCounter::now() - start) && passed;
+        // sincos over several periods. Errors of sine and cosine are checked separately
+        for (unsigned i = 0; i < n; i++)
+        {
+            x[i] = (8.0F * Pi * i) / n - 4.0F * Pi;
+        }
+        start = CycleCounter::now();
+        Approx::sincos<P>(x.data(), results.data(), results2.data(), n);
+        kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = std::sin(x[i]);
+            expected2[i] = std::cos(x[i]);
+        }
+        const auto exactCycles = CycleCounter::now() - start;
+        passed = printKernel("sincos (sin)", tier, results.data(), expected.data(), false, bounds.sincos, kernelCycles, exactCycles) && passed;
+        passed = printKernel("sincos (cos)", tier, results2.data(), expected2.data(), false, bounds.sincos, kernelCycles, exactCycles) && passed;
+        // atan2 around the circle with varying radius
+        for (unsigned i = 0; i < n; i++)
+        {
+            const float angle = (2.0F * Pi * i) / n - Pi;
+            const float radius = 0.01F + (i % 100);
+            y[i] = radius * std::sin(angle);
+            x[i] = radius * std::cos(angle);
+        }
+        start = CycleCounter::now();
+        Approx::atan2<P>(y.data(), x.data(), results.data(), n);
+        kernelCycles = CycleCounter::now() - start;
+        start = CycleCounter::now();
+        for (unsigned i = 0; i < n; i++)
+        {
+            expected[i] = std::atan2(y[i], x[i]);
+        }
+        passed = printKernel("atan2", tier, results.data(), expected.data(), false, bounds.atan2, kernelCycles, CycleCounter::now() - start) && passed;
+        return passed;
+    }
+
+    // Print max. error of kernel results against expected values and time per value of the kernel and the <cmath> loop.
+    // Returns true if the max. error is within bound
+    static bool printKernel(const char *name, const char *tier, const float *results, const float *expected, bool relative, float bound, uint32_t kernelCycles, uint32_t exactCycles)
+    {
+        float maxError = 0.0F;
+        for (unsigned i = 0; i < NR_OF_KERNEL_VALUES; i++)
+        {
+            float error = std::fabs(results[i] - expected[i]);
+            error = relative ? error / std::fabs(expected[i]) : error;
+            maxError = error > maxError ? error : maxError;
+        }
+        const bool passed = maxError <= bound;
+        Serial_printf("  %s, %s: max. %s error %3f x 1e-6, %l %s / value, <cmath> %l %s / value -> %s\n", name, tier, relative ? "relative" : "absolute", maxError * 1e6F,
+                      static_cast<long>(kernelCycles / NR_OF_KERNEL_VALUES), CycleCounter::Unit, static_cast<long>(exactCycles / NR_OF_KERNEL_VALUES), CycleCounter::Unit,
+                      passed ? "passed" : "FAILED");
+        return passed;
+    }
+
+    // Fill samples with test signal #index. Amplitudes are similar to microphone values at ~50 to ~90 dB
+    static void generate(unsigned index, float *samples)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        constexpr double Loud = 200000.0;
+        constexpr double Quiet = 2000.0;
+        constexpr double BinHz = static_cast<double>(SAMPLE_RATE_HZ) / SAMPLE_COUNT;
+        constexpr double LowBin = 200.0 / BinHz;  // Bin of a low tone
+        constexpr double HighBin = 0.75 * MAX_HZ / BinHz; // Bin of a high tone
+        uint32_t random = 12345;
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double t = 2.0 * Pi * i / SAMPLE_COUNT;
+            switch (index)
+            {
+            case 0: // low tone at bin centre
+                samples[i] = static_cast<float>(Loud * std::sin(t * std::floor(LowBin)));
+                break;
+            case 1: // low tone at bin edge
+                samples[i] = static_cast<float>(Loud * std::sin(t * (std::floor(LowBin) + 0.5)));
+                break;
+            case 2: // high tone at bin centre
+                samples[i] = static_cast<float>(Loud * std::sin(t * std::floor(HighBin)));
+                break;
+            case 3: // high tone at bin edge
+                samples[i] = static_cast<float>(Loud * std::sin(t * (std::floor(HighBin) + 0.5)));
+                break;
+            case 4: // quiet tones near the noise floor, where the logarithm error matters most
+                samples[i] = static_cast<float>(Quiet * (std::sin(t * std::floor(LowBin)) + std::sin(t * (std::floor(HighBin) + 0.25))));
+                break;
+            case 5: // quiet noise
+            case 6: // loud noise
+                random = random * 1664525 + 1013904223;
+                samples[i] = static_cast<float>((index == 5 ? Quiet : Loud) * (static_cast<double>(random) / 4294967296.0 - 0.5));
+                break;
+            default: // linear sweep from bin 1 to MAX_HZ over the block
+            {
+                const double endBin = static_cast<double>(MAX_HZ) / BinHz;
+                const double position = static_cast<double>(i) / SAMPLE_COUNT;
+                samples[i] = static_cast<float>(Loud * std::sin(t * (1.0 + 0.5 * (endBin - 1.0) * position)));
+            }
+            }
+        }
+    }
+
+    const float m_offsetDb;
+    const float m_amplitudeScale;
+    std::unique_ptr<Levels> m_golden{new Levels()};
+};
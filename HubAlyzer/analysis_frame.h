@@ -0,0 +1,54 @@
+#pragma once
+
+#include "frame_exchange.h"
+
+#include <cstdint>
+
+// Calibrated A-weighted sound levels in dB SPL, see SoundLevelMeter. LAeq, LAFmax and LApeak cover the current
+// LAeq window so far, so they restart when a window completes. 0 if not measured, e.g. with analysis frames from the network
+struct SoundLevels
+{
+    float lafDb = 0;      // Fast (125ms) time-weighted level
+    float lasDb = 0;      // Slow (1s) time-weighted level
+    float laeqDb = 0;     // Equivalent continuous level of the current window
+    float lastLaeqDb = 0; // Equivalent continuous level of the last completed window
+    float lafMaxDb = 0;   // Maximum fast time-weighted level of the current window
+    float lapeakDb = 0;   // Peak level of the current window
+};
+
+// Analysis results of one audio block. Produced once per block by the analysis task and passed to every effect by
+// const reference, so new data can be added here without changing effect signatures or adding per-call arguments.
+// Arrays have fixed capacities, so frames can be copied and exchanged between tasks without allocations.
+// Aligned to the 32 byte cache line of the ESP32 flash / PSRAM cache.
+struct alignas(32) AnalysisFrame
+{
+    static constexpr uint32_t VERSION = 4;        // Increase when changing the layout
+    static constexpr unsigned MAX_BANDS = 64;     // Capacity of levels and peaks
+    static constexpr unsigned NR_OF_PITCH_CLASSES = 12; // Number of chroma values, C to B
+    static constexpr unsigned MAX_OCTAVES = 8;    // Capacity of octaveChroma
+    static constexpr unsigned MAX_MAGNITUDES = 128; // Capacity of FFT bin magnitudes
+    static constexpr unsigned WAVEFORM_SIZE = 64; // Number of decimated waveform samples
+
+    uint32_t version = VERSION;
+    uint32_t sequence = 0;       // Incremented for every analysed block
+    uint32_t timeUs = 0;         // Time the block was analysed in microseconds from micros()
+    uint32_t lastBeatTimeUs = 0; // Time of last detected beat in microseconds from micros()
+    bool isBeat = false;         // True if a beat was detected recently
+    unsigned nrOfBands = 0;      // Number of valid levels and peaks
+    unsigned nrOfChannels = 1;   // 2 if leftLevels and rightLevels come from separate channels, 1 if they are copies of levels
+    unsigned nrOfMagnitudes = 0; // Number of valid magnitudes. 0 if not available, e.g. with the band bank
+    unsigned nrOfOctaves = 0;    // Number of valid octaves in octaveChroma. 0 if not available, e.g. with the band bank
+    int firstOctave = 0;         // Octave of octaveChroma[0]. Middle C starts octave 4
+    float levels[MAX_BANDS] = {0};           // Band levels in [0,1]
+    float peaks[MAX_BANDS] = {0};            // Band peak levels in [0,1]
+    float chroma[NR_OF_PITCH_CLASSES] = {0}; // Pitch class levels in [0,1], starting at C. 0 if not available, see Chroma
+    float octaveChroma[MAX_OCTAVES][NR_OF_PITCH_CLASSES] = {{0}}; // Note levels in [0,1] per octave, starting at C of firstOctave
+    float leftLevels[MAX_BANDS] = {0};       // Band levels of the left channel in [0,1]
+    float rightLevels[MAX_BANDS] = {0};      // Band levels of the right channel in [0,1]
+    float magnitudes[MAX_MAGNITUDES] = {0};  // Normalized FFT bin magnitudes in [0,1], starting at bin 0
+    float waveform[WAVEFORM_SIZE] = {0};     // A-weighted waveform in [-1,1], decimated from the whole block
+    SoundLevels soundLevels;                 // Calibrated sound levels
+};
+
+// Hands the latest AnalysisFrame from one writer task to one reader task without locks
+using AnalysisFrameExchange = FrameExchange<AnalysisFrame>;
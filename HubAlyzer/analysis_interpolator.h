@@ -0,0 +1,66 @@
+#pragma once
+
+#include "analysis_frame.h"
+
+#include <cstdint>
+
+// Smooths analysis frames for a render task running at a different rate than the analysis.
+// Levels, channel levels, peaks and chroma are linearly interpolated between the two most recent analysis frames, so the render task sees
+// smooth values at any frame rate. Values lag one analysis interval behind. If the next analysis frame is late,
+// values are extrapolated for up to MAX_EXTRAPOLATION intervals and then held. Extrapolation overshoots the latest frame,
+// so interpolated values are clamped to [0,1], the range effects expect. All other data is taken from the latest frame.
+// Only use from the render task. Frames are handed over from the analysis task with an AnalysisFrameExchange
+class AnalysisInterpolator
+{
+    static constexpr float MAX_EXTRAPOLATION = 1.5F; // Maximum position between frames in analysis intervals
+
+public:
+    /// @brief Add new analysis frame
+    void push(const AnalysisFrame &frame)
+    {
+        m_previous = m_latest;
+        m_latest = frame;
+        m_current = frame;
+    }
+
+    /// @brief Get frame with levels and peaks at time
+    /// @p timeUs Current time in microseconds, e.g. from micros()
+    const AnalysisFrame &interpolate(uint32_t timeUs)
+    {
+        const uint32_t intervalUs = m_latest.timeUs - m_previous.timeUs;
+        float t = intervalUs > 0 ? static_cast<float>(static_cast<int32_t>(timeUs - m_latest.timeUs)) / intervalUs : 1.0F;
+        t = t < 0.0F ? 0.0F : (t > MAX_EXTRAPOLATION ? MAX_EXTRAPOLATION : t);
+        const unsigned nrOfBands = m_latest.nrOfBands == m_previous.nrOfBands ? m_latest.nrOfBands : 0;
+        for (unsigned int band = 0; band < nrOfBands; band++)
+        {
+            m_current.levels[band] = clamp01(m_previous.levels[band] + t * (m_latest.levels[band] - m_previous.levels[band]));
+            m_current.peaks[band] = clamp01(m_previous.peaks[band] + t * (m_latest.peaks[band] - m_previous.peaks[band]));
+            m_current.leftLevels[band] = clamp01(m_previous.leftLevels[band] + t * (m_latest.leftLevels[band] - m_previous.leftLevels[band]));
+            m_current.rightLevels[band] = clamp01(m_previous.rightLevels[band] + t * (m_latest.rightLevels[band] - m_previous.rightLevels[band]));
+        }
+        for (unsigned int i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+        {
+            m_current.chroma[i] = clamp01(m_previous.chroma[i] + t * (m_latest.chroma[i] - m_previous.chroma[i]));
+        }
+        const unsigned nrOfOctaves = m_latest.nrOfOctaves == m_previous.nrOfOctaves ? m_latest.nrOfOctaves : 0;
+        for (unsigned int octave = 0; octave < nrOfOctaves; octave++)
+        {
+            for (unsigned int i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+            {
+                const float previous = m_previous.octaveChroma[octave][i];
+                m_current.octaveChroma[octave][i] = clamp01(previous + t * (m_latest.octaveChroma[octave][i] - previous));
+            }
+        }
+        return m_current;
+    }
+
+private:
+    static float clamp01(float value)
+    {
+        return value < 0.0F ? 0.0F : (value > 1.0F ? 1.0F : value);
+    }
+
+    AnalysisFrame m_previous;
+    AnalysisFrame m_latest;
+    AnalysisFrame m_current;
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "analysis_frame.h"
+
+#include <cstdint>
+
+// Compact UDP encoding of an AnalysisFrame, so one node with a microphone can drive many panels.
+// Levels, peaks and chroma are quantized to 8 bits. Magnitudes, note levels and the waveform are not sent. Multi-byte values are little-endian:
+// [0,1] magic "HA", [2] protocol version, [3] flags (bit 0: isBeat, bit 1: stereo, bit 2: chroma), [4] # of bands, [5,7] reserved,
+// [8,11] sequence, [12,15] sender time in us, [16,19] time since last beat in us,
+// [20,31] sound levels LAF, LAS, LAeq, last LAeq, LAFmax, LApeak in 1/100 dB, then levels[# of bands], peaks[# of bands].
+// Stereo packets append leftLevels[# of bands], rightLevels[# of bands]. Packets with chroma end with chroma[12]
+class AnalysisPacket
+{
+public:
+    static constexpr uint8_t VERSION = 3;      // Increase when changing the packet layout
+    static constexpr unsigned HEADER_SIZE = 32;
+    static constexpr unsigned MAX_SIZE = HEADER_SIZE + 4 * AnalysisFrame::MAX_BANDS + AnalysisFrame::NR_OF_PITCH_CLASSES;
+    static constexpr uint16_t DEFAULT_PORT = 42042;
+    static constexpr const char *DEFAULT_GROUP = "239.255.42.42"; // Site-local multicast group
+
+    /// @brief Encode frame into packet
+    /// @p packet Buffer of at least MAX_SIZE bytes
+    /// @return Returns the packet size in bytes
+    static unsigned encode(const AnalysisFrame &frame, uint8_t *packet)
+    {
+        const unsigned nrOfBands = frame.nrOfBands < AnalysisFrame::MAX_BANDS ? frame.nrOfBands : AnalysisFrame::MAX_BANDS;
+        packet[0] = 'H';
+        packet[1] = 'A';
+        packet[2] = VERSION;
+        const bool isStereo = frame.nrOfChannels == 2;
+        const bool hasChroma = frame.nrOfOctaves > 0;
+        packet[3] = (frame.isBeat ? 1 : 0) | (isStereo ? 2 : 0) | (hasChroma ? 4 : 0);
+        packet[4] = static_cast<uint8_t>(nrOfBands);
+        packet[5] = packet[6] = packet[7] = 0;
+        store32(packet + 8, frame.sequence);
+        store32(packet + 12, frame.timeUs);
+        store32(packet + 16, frame.timeUs - frame.lastBeatTimeUs);
+        const auto &soundLevels = frame.soundLevels;
+        store16(packet + 20, toCentiDb(soundLevels.lafDb));
+        store16(packet + 22, toCentiDb(soundLevels.lasDb));
+        store16(packet + 24, toCentiDb(soundLevels.laeqDb));
+        store16(packet + 26, toCentiDb(soundLevels.lastLaeqDb));
+        store16(packet + 28, toCentiDb(soundLevels.lafMaxDb));
+        store16(packet + 30, toCentiDb(soundLevels.lapeakDb));
+        auto levels = packet + HEADER_SIZE;
+        auto peaks = levels + nrOfBands;
+        for (unsigned band = 0; band < nrOfBands; band++)
+        {
+            levels[band] = quantize(frame.levels[band]);
+            peaks[band] = quantize(frame.peaks[band]);
+        }
+        auto end = peaks + nrOfBands;
+        if (isStereo)
+        {
+            auto leftLevels = end;
+            auto rightLevels = leftLevels + nrOfBands;
+            for (unsigned band = 0; band < nrOfBands; band++)
+            {
+                leftLevels[band] = quantize(frame.leftLevels[band]);
+                rightLevels[band] = quantize(frame.rightLevels[band]);
+            }
+            end = rightLevels + nrOfBands;
+        }
+        if (hasChroma)
+        {
+            for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+            {
+                end[i] = quantize(frame.chroma[i]);
+            }
+            end += AnalysisFrame::NR_OF_PITCH_CLASSES;
+        }
+        return static_cast<unsigned>(end - packet);
+    }
+
+    /// @brief Sequence number of a packet of at least HEADER_SIZE bytes, e.g. to check the order before decoding it
+    static uint32_t sequence(const uint8_t *packet)
+    {
+        return load32(packet + 8);
+    }
+
+    /// @brief Decode packet into frame. Times stay in the sender clock. Fields that are not sent are left unchanged
+    /// @return Returns false if the packet is invalid or has a different protocol version
+    static bool decode(const uint8_t *packet, unsigned size, AnalysisFrame &frame)
+    {
+        if (size < HEADER_SIZE || packet[0] != 'H' || packet[1] != 'A' || packet[2] != VERSION || packet[4] > AnalysisFrame::MAX_BANDS || size < HEADER_SIZE + 2U * packet[4])
+        {
+            return false;
+        }
+        const unsigned nrOfBands = packet[4];
+        const bool isStereo = (packet[3] & 2) != 0 && size >= HEADER_SIZE + 4U * nrOfBands;
+        const unsigned chromaOffset = HEADER_SIZE + (isStereo ? 4U : 2U) * nrOfBands;
+        const bool hasChroma = (packet[3] & 4) != 0 && size >= chromaOffset + AnalysisFrame::NR_OF_PITCH_CLASSES;
+        frame.isBeat = (packet[3] & 1) != 0;
+        frame.nrOfChannels = isStereo ? 2 : 1;
+        frame.nrOfBands = nrOfBands;
+        frame.nrOfMagnitudes = 0;
+        frame.nrOfOctaves = 0;
+        frame.sequence = load32(packet + 8);
+        frame.timeUs = load32(packet + 12);
+        frame.lastBeatTimeUs = frame.timeUs - load32(packet + 16);
+        constexpr float DbScale = 0.01F;
+        frame.soundLevels.lafDb = load16(packet + 20) * DbScale;
+        frame.soundLevels.lasDb = load16(packet + 22) * DbScale;
+        frame.soundLevels.laeqDb = load16(packet + 24) * DbScale;
+        frame.soundLevels.lastLaeqDb = load16(packet + 26) * DbScale;
+        frame.soundLevels.lafMaxDb = load16(packet + 28) * DbScale;
+        frame.soundLevels.lapeakDb = load16(packet + 30) * DbScale;
+        const auto levels = packet + HEADER_SIZE;
+        const auto peaks = levels + nrOfBands;
+        constexpr float Scale = 1.0F / 255.0F;
+        for (unsigned band = 0; band < nrOfBands; band++)
+        {
+            frame.levels[band] = levels[band] * Scale;
+            frame.peaks[band] = peaks[band] * Scale;
+        }
+        const auto leftLevels = isStereo ? peaks + nrOfBands : levels;
+        const auto rightLevels = isStereo ? leftLevels + nrOfBands : levels;
+        for (unsigned band = 0; band < nrOfBands; band++)
+        {
+            frame.leftLevels[band] = leftLevels[band] * Scale;
+            frame.rightLevels[band] = rightLevels[band] * Scale;
+        }
+        for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+        {
+            frame.chroma[i] = hasChroma ? packet[chromaOffset + i] * Scale : 0.0F;
+        }
+        return true;
+    }
+
+private:
+    static uint8_t quantize(float value)
+    {
+        return static_cast<uint8_t>(value <= 0.0F ? 0 : (value >= 1.0F ? 255 : value * 255.0F + 0.5F));
+    }
+
+    static uint16_t toCentiDb(float db)
+    {
+        return static_cast<uint16_t>(db <= 0.0F ? 0 : (db >= 655.0F ? 65500 : db * 100.0F + 0.5F));
+    }
+
+    static void store16(uint8_t *data, uint16_t value)
+    {
+        data[0] = value;
+        data[1] = value >> 8;
+    }
+
+    static uint16_t load16(const uint8_t *data)
+    {
+        return data[0] | (data[1] << 8);
+    }
+
+    static void store32(uint8_t *data, uint32_t value)
+    {
+        data[0] = value;
+        data[1] = value >> 8;
+        data[2] = value >> 16;
+        data[3] = value >> 24;
+    }
+
+    static uint32_t load32(const uint8_t *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+};
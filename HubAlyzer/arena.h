@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// Fixed-size bump allocator for objects that are created once at boot and live forever, e.g. effects.
+// Allocation never touches the heap and objects are never destroyed or freed individually.
+// SIZE = Size of arena in bytes
+template <size_t SIZE>
+class Arena
+{
+public:
+    /// @brief Construct a new object of type T in the arena
+    /// @return Returns a pointer to the new object or nullptr if the arena is full
+    template <typename T, typename... ARGS>
+    auto create(ARGS &&...args) -> T *
+    {
+        auto memory = allocate(sizeof(T), alignof(T));
+        return memory != nullptr ? new (memory) T(std::forward<ARGS>(args)...) : nullptr;
+    }
+
+    /// @brief Allocate aligned raw memory from the arena
+    /// @return Returns a pointer to the memory or nullptr if the arena is full
+    auto allocate(size_t size, size_t alignment) -> void *
+    {
+        const auto start = (m_used + alignment - 1) & ~(alignment - 1);
+        if (start + size > SIZE)
+        {
+            m_failed = true;
+            return nullptr;
+        }
+        m_used = start + size;
+        return m_memory + start;
+    }
+
+    /// @brief Number of bytes allocated so far. Objects are never freed, so this is the high-water mark
+    auto highWaterMark() const -> size_t
+    {
+        return m_used;
+    }
+
+    /// @brief Size of the arena in bytes
+    static constexpr auto capacity() -> size_t
+    {
+        return SIZE;
+    }
+
+    /// @brief Returns true if an allocation did not fit into the arena
+    auto hasFailed() const -> bool
+    {
+        return m_failed;
+    }
+
+private:
+    alignas(std::max_align_t) uint8_t m_memory[SIZE];
+    size_t m_used = 0;
+    bool m_failed = false;
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "approx.h"
+
+#include <atomic>
+#include <cmath>
+
+// Bank of damped sliding DFT resonators as an alternative to FFT + Spectrum.
+// Updated sample-by-sample, so band amplitudes can be read at any time without waiting for a full FFT block.
+// Uses the same band layout as Spectrum: NR_OF_BANDS bands of equal width from the first FFT bin to MAX_HZ.
+// SAMPLE_COUNT = Number of samples of the FFT this replaces. Determines band layout and amplitude scale
+// NR_OF_BANDS = Number of spectrum bands to generate
+// MAX_HZ = Maximum / end of frequency spectrum
+// SAMPLE_RATE = Audio sample rate in Hz
+// PUBLISH_INTERVAL = Number of samples after which new band amplitudes are made available to readers
+template <unsigned SAMPLE_COUNT, unsigned int NR_OF_BANDS = 32, unsigned int MAX_HZ = 4000, unsigned SAMPLE_RATE_HZ = 48000, unsigned PUBLISH_INTERVAL = 64>
+class BandBank
+{
+    static constexpr float MIN_HZ = 1.0f / SAMPLE_COUNT * SAMPLE_RATE_HZ;      // Minimum frequency ~94Hz for 512 samples, 48kHz sample rate
+    static constexpr float BIN_START = 1;                                      // Bin #0 is crap / DC offset, so we don't use it
+    static constexpr float BIN_SIZE_HZ = float(SAMPLE_RATE_HZ) / SAMPLE_COUNT; // Size of each FFT bin in Hz, ~46Hz at 48kHz and 512 samples
+    static constexpr float NR_OF_BINS = (MAX_HZ - MIN_HZ) / BIN_SIZE_HZ;       // # of bins needed to get to MAX_HZ, ~83 bins to 4KHz, at 48kHz and 512 samples
+    static constexpr float BINS_PER_BAND = NR_OF_BINS / NR_OF_BANDS;           // # of bins needed for one band ~2.6 bins, for 32 bands up to 4kHz
+
+    // Resonator window length. The main lobe of a rectangular window of this length is one band wide
+    static constexpr unsigned WINDOW_LENGTH = static_cast<unsigned>(SAMPLE_COUNT / BINS_PER_BAND + 0.5f);
+    // Pole radius < 1 keeps the recursion stable when rounding errors accumulate in the resonator state
+    static constexpr float Damping = 0.9999f;
+    // Scale the rectangular window output to the magnitude of a Blackman-Harris windowed FFT bin of SAMPLE_COUNT samples
+    static constexpr float AmplitudeScale = (0.35875f * SAMPLE_COUNT) / WINDOW_LENGTH;
+
+public:
+    /// @brief Construct a new resonator bank with resonators at the band centre frequencies
+    BandBank()
+    {
+        constexpr float Pi = 3.1415926535f;
+        const float dampingN = std::pow(Damping, static_cast<float>(WINDOW_LENGTH));
+        for (unsigned int band = 0; band < NR_OF_BANDS; band++)
+        {
+            const float centreHz = (BIN_START + (band + 0.5f) * BINS_PER_BAND) * BIN_SIZE_HZ;
+            const float omega = 2.0f * Pi * centreHz / SAMPLE_RATE_HZ;
+            // The window length is no multiple of the resonator period, so the comb term needs its own rotation
+            m_rotRe[band] = Damping * std::cos(omega);
+            m_rotIm[band] = Damping * std::sin(omega);
+            m_combRe[band] = dampingN * std::cos(omega * WINDOW_LENGTH);
+            m_combIm[band] = dampingN * std::sin(omega * WINDOW_LENGTH);
+        }
+    }
+
+    /// @brief Feed new samples into the resonators. Call this from a single producer task only
+    /// @p samples Audio samples
+    /// @p count Number of audio samples
+    void process(const float *samples, unsigned count)
+    {
+        while (count > 0)
+        {
+            const unsigned chunk = count < PUBLISH_INTERVAL - m_sinceLastPublish ? count : PUBLISH_INTERVAL - m_sinceLastPublish;
+            for (unsigned i = 0; i < chunk; i++)
+            {
+                // S[n] = r * e^(jw) * S[n-1] + x[n] - r^N * e^(jwN) * x[n-N]
+                const float x = samples[i];
+                const float xN = m_delay[m_delayIndex];
+                m_delay[m_delayIndex] = x;
+                m_delayIndex = m_delayIndex + 1 < WINDOW_LENGTH ? m_delayIndex + 1 : 0;
+                for (unsigned int band = 0; band < NR_OF_BANDS; band++)
+                {
+                    const float re = m_re[band];
+                    const float im = m_im[band];
+                    m_re[band] = m_rotRe[band] * re - m_rotIm[band] * im + x - m_combRe[band] * xN;
+                    m_im[band] = m_rotIm[band] * re + m_rotRe[band] * im - m_combIm[band] * xN;
+                }
+            }
+            samples += chunk;
+            count -= chunk;
+            m_sinceLastPublish += chunk;
+            if (m_sinceLastPublish >= PUBLISH_INTERVAL)
+            {
+                publish();
+                m_sinceLastPublish = 0;
+            }
+        }
+    }
+
+    /// @brief Read the most recently published band amplitudes. Lock-free and safe to call from any task
+    /// @p amplitudes Receives NR_OF_BANDS band amplitudes, scaled like FFT amplitudes
+    void read(float *amplitudes) const
+    {
+        uint32_t before = 0;
+        uint32_t after = 0;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (unsigned int band = 0; band < NR_OF_BANDS; band++)
+            {
+                amplitudes[band] = m_published[band];
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) != 0 || before != after);
+    }
+
+private:
+    // Make current magnitudes available to readers. The odd sequence number marks an update in progress
+    void publish()
+    {
+        // calculate magnitudes before marking the update, so readers retry less often
+        float magnitudes[NR_OF_BANDS];
+        for (unsigned int band = 0; band < NR_OF_BANDS; band++)
+        {
+            magnitudes[band] = m_re[band] * m_re[band] + m_im[band] * m_im[band];
+        }
+        Approx::sqrt<ApproxPrecision::Medium>(magnitudes, magnitudes, NR_OF_BANDS);
+        const auto sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (unsigned int band = 0; band < NR_OF_BANDS; band++)
+        {
+            m_published[band] = AmplitudeScale * magnitudes[band];
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    float m_rotRe[NR_OF_BANDS] = {0};
+    float m_rotIm[NR_OF_BANDS] = {0};
+    float m_combRe[NR_OF_BANDS] = {0};
+    float m_combIm[NR_OF_BANDS] = {0};
+    float m_re[NR_OF_BANDS] = {0};
+    float m_im[NR_OF_BANDS] = {0};
+    float m_delay[WINDOW_LENGTH] = {0};
+    unsigned m_delayIndex = 0;
+    unsigned m_sinceLastPublish = 0;
+    float m_published[NR_OF_BANDS] = {0};
+    std::atomic<uint32_t> m_sequence{0};
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "parameters.h"
 #include "serial_printf.h"
 
 #include <cmath>
@@ -17,7 +18,6 @@ class BeatDetection
     static constexpr float BIN_SIZE_HZ = float(SAMPLE_RATE_HZ) / SAMPLE_COUNT; // Size of each FFT bin in Hz, ~46Hz at 48kHz and 512 samples
     static constexpr float NR_OF_BINS = (MAX_HZ - MIN_HZ) / BIN_SIZE_HZ;       // # of bins needed to get to MAX_HZ, ~83 bins to 4KHz, at 48kHz and 512 samples
 
-    static constexpr float BEAT_PROBABILITY_THRESHOLD = 0.2f;
     static constexpr float MIN_BEAT_INTERVAL_MS = 1000.0F / (180.0F / UPDATE_RATE_HZ);
 
     static constexpr unsigned int NR_OF_IIR_COEFFICIENTS = 4;
@@ -62,9 +62,10 @@ public:
             m_probabilities[bandIndex] = beatFilter(band, tempLevel);
         }
         // calculate beat probability
+        m_threshold.update();
         auto beatProbability = m_probabilities[0] + m_probabilities[1];
         // Serial_printf("%f\n", beatProbability);
-        if (beatProbability >= BEAT_PROBABILITY_THRESHOLD && (millis() - m_lastBeatTimestamp) > MIN_BEAT_INTERVAL_MS)
+        if (beatProbability >= m_threshold.value() && (millis() - m_lastBeatTimestamp) > MIN_BEAT_INTERVAL_MS)
         {
             m_lastBeatTimestamp = millis();
         }
@@ -110,6 +111,7 @@ private:
         return band.y[0];
     }
 
+    Parameter<float> m_threshold{"BeatDetection.threshold", 0.2f, 0.0f, 2.0f}; // Beat probability needed for a beat
     BandInfo m_bands[NR_OF_BANDS];
     float m_probabilities[NR_OF_BANDS] = {0};
     long m_lastBeatTimestamp = 0;
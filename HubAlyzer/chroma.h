@@ -0,0 +1,182 @@
+#pragma once
+
+#include "lookup_tables.h"
+#include "parameters.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Sparse map of FFT bins to notes, computed by the compiler. Notes are semitones relative to FIRST_NOTE, a C.
+// Bin k covers the frequencies [k - 0.5, k + 0.5] * BIN_SIZE_HZ. Each note within it gets the part [start, end] of the bin
+// that lies within the note's range [note - 0.5, note + 0.5], as offsets from the bin center in [-0.5, 0.5].
+// Pitch is taken to be linear within a bin, which is off by less than 0.03 semitones for bins up to 2 semitones wide.
+// Entries are sorted by bin. Bins wider than MAX_BIN_SEMITONES are not mapped
+// SAMPLE_COUNT = Number of samples going into the FFT
+// NR_OF_BINS = Number of bins to map, starting at bin 0
+// SAMPLE_RATE_HZ = Sample rate of FFT input in Hz
+// MAX_BIN_SEMITONES = Widest bin mapped in semitones
+template <unsigned SAMPLE_COUNT, unsigned NR_OF_BINS, unsigned SAMPLE_RATE_HZ, unsigned MAX_BIN_SEMITONES>
+struct ChromaMap
+{
+    static constexpr double BIN_SIZE_HZ = static_cast<double>(SAMPLE_RATE_HZ) / SAMPLE_COUNT;
+
+    struct Entry
+    {
+        uint16_t bin = 0;
+        uint8_t note = 0;
+        float start = 0.0F;
+        float end = 0.0F;
+    };
+
+    // MIDI pitch of frequency. A4 (440Hz) is 69, middle C is 60
+    static constexpr double pitch(double hz)
+    {
+        return 69.0 + 12.0 * LookupTables::logarithm2(hz / 440.0);
+    }
+
+    // Nearest note of pitch
+    static constexpr int nearestNote(double pitch)
+    {
+        const double rounded = pitch + 0.5;
+        const auto truncated = static_cast<int>(rounded);
+        return rounded < truncated ? truncated - 1 : truncated;
+    }
+
+    // First bin not wider than MAX_BIN_SEMITONES. Bin 0 is DC and never used
+    static constexpr unsigned firstBin()
+    {
+        unsigned bin = 1;
+        while (bin < NR_OF_BINS && pitch((bin + 0.5) * BIN_SIZE_HZ) - pitch((bin - 0.5) * BIN_SIZE_HZ) > MAX_BIN_SEMITONES)
+        {
+            bin++;
+        }
+        return bin;
+    }
+
+    static constexpr unsigned FIRST_BIN = firstBin();
+    static_assert(FIRST_BIN < NR_OF_BINS, "No bin is narrow enough. Increase SAMPLE_COUNT, MAX_HZ or MAX_BIN_SEMITONES");
+    static constexpr int LOWEST_NOTE = nearestNote(pitch((FIRST_BIN - 0.5) * BIN_SIZE_HZ));
+    static constexpr int HIGHEST_NOTE = nearestNote(pitch((NR_OF_BINS - 0.5) * BIN_SIZE_HZ));
+    static_assert(LOWEST_NOTE >= 0, "Notes below C-1 are not supported");
+    static constexpr int FIRST_NOTE = LOWEST_NOTE - LOWEST_NOTE % 12;
+    static constexpr unsigned NR_OF_OCTAVES = (HIGHEST_NOTE - FIRST_NOTE) / 12 + 1;
+    static constexpr unsigned NR_OF_NOTES = 12 * NR_OF_OCTAVES;
+
+    // Visit all (bin, note, start, end) entries in bin order
+    template <typename VISITOR>
+    static constexpr void forEachEntry(VISITOR &&visitor)
+    {
+        for (unsigned bin = FIRST_BIN; bin < NR_OF_BINS; bin++)
+        {
+            const double low = pitch((bin - 0.5) * BIN_SIZE_HZ);
+            const double high = pitch((bin + 0.5) * BIN_SIZE_HZ);
+            for (int note = nearestNote(low); note <= nearestNote(high); note++)
+            {
+                const double start = low > note - 0.5 ? low : note - 0.5;
+                const double end = high < note + 0.5 ? high : note + 0.5;
+                if (end > start)
+                {
+                    visitor(bin, static_cast<unsigned>(note - FIRST_NOTE), (start - low) / (high - low) - 0.5, (end - low) / (high - low) - 0.5);
+                }
+            }
+        }
+    }
+
+    static constexpr unsigned countEntries()
+    {
+        unsigned count = 0;
+        forEachEntry([&count](unsigned, unsigned, double, double)
+                     { count++; });
+        return count;
+    }
+
+    static constexpr unsigned NR_OF_ENTRIES = countEntries();
+
+    static constexpr auto entries() -> std::array<Entry, NR_OF_ENTRIES>
+    {
+        std::array<Entry, NR_OF_ENTRIES> result = {};
+        unsigned index = 0;
+        forEachEntry([&result, &index](unsigned bin, unsigned note, double start, double end)
+                     { result[index++] = {static_cast<uint16_t>(bin), static_cast<uint8_t>(note), static_cast<float>(start), static_cast<float>(end)}; });
+        return result;
+    }
+
+    static constexpr std::array<Entry, NR_OF_ENTRIES> Entries = entries();
+};
+
+// Chromagram: Levels of the 12 pitch classes C, C#, ..., B and of the individual notes from normalized FFT magnitudes.
+// The Blackman-Harris window spreads a tone over ~8 bins, which is several semitones wide, so only bins that are local maxima
+// (spectral peaks) count. The tone's position within the peak bin is estimated from a parabola through the peak and its
+// neighbours, which is what a zero-padded FFT would resolve, and its note gets the peak magnitude. This tells notes apart
+// in bins wider than a semitone. A note level is the loudest peak magnitude mapped to the note.
+// A pitch class level is the maximum of its notes over all octaves. Bins wider than MAX_BIN_SEMITONES are skipped, so with
+// 1024 samples at 48kHz and the default of 2 semitones notes are resolved from G#4 (~415Hz) to MAX_HZ. Tones closer than
+// ~3 bins (~140Hz) merge into one peak, so thirds below C5 light up the notes in between instead.
+// Harmonics of lower notes still count towards their pitch classes. More FFT samples reach lower.
+// An update makes one pass over the bin map, which has one to three entries per used bin, and one pass over the notes
+template <unsigned SAMPLE_COUNT, unsigned int MAX_HZ = 4000, unsigned SAMPLE_RATE_HZ = 48000, unsigned MAX_BIN_SEMITONES = 2>
+class Chroma
+{
+    static constexpr float MIN_HZ = 1.0f / SAMPLE_COUNT * SAMPLE_RATE_HZ;                                            // Minimum frequency ~94Hz for 512 samples, 48kHz sample rate
+    static constexpr float BIN_START = 1;                                                                            // Bin #0 is crap / DC offset, so we don't use it
+    static constexpr float BIN_SIZE_HZ = float(SAMPLE_RATE_HZ) / SAMPLE_COUNT;                                       // Size of each FFT bin in Hz, ~46Hz at 48kHz and 512 samples
+    static constexpr unsigned int BINS_FOR_MAX_HZ = std::ceil((MAX_HZ - MIN_HZ) / BIN_SIZE_HZ) + BIN_START;          // # of bins needed to get to MAX_HZ, ~83 bins to 4KHz, at 48kHz and 512 samples
+    static constexpr unsigned int NR_OF_BINS_USED = SAMPLE_COUNT < BINS_FOR_MAX_HZ ? SAMPLE_COUNT : BINS_FOR_MAX_HZ; // Maximum used bins from magnitudes array, like Normalization
+
+    // the last used bin is not mapped, so every mapped bin has two neighbours to compare with
+    using Map = ChromaMap<SAMPLE_COUNT, NR_OF_BINS_USED - 1, SAMPLE_RATE_HZ, MAX_BIN_SEMITONES>;
+
+public:
+    static constexpr unsigned NR_OF_PITCH_CLASSES = 12;
+    static constexpr unsigned NR_OF_OCTAVES = Map::NR_OF_OCTAVES;  // Number of octaves of note levels
+    static constexpr int FIRST_OCTAVE = Map::FIRST_NOTE / 12 - 1; // Octave of the first note level. Middle C starts octave 4
+
+    /// @brief Call to update chroma data
+    /// @p magnitudes Magnitude values for individual frequency bins from the FFT, e.g. from Normalization. Must be in the range [0,1]!
+    /// @return Returns (pitch class levels, note levels). Read NR_OF_PITCH_CLASSES values starting at C and
+    /// NR_OF_OCTAVES * NR_OF_PITCH_CLASSES values starting at C of FIRST_OCTAVE from this
+    std::pair<const float *, const float *> update(const float *magnitudes)
+    {
+        // find loudest peak of each note. Entries of a bin follow each other, so each bin is checked once
+        float notes[Map::NR_OF_NOTES] = {0};
+        unsigned bin = 0;
+        bool isPeak = false;
+        float offset = 0.0F;
+        for (const auto &entry : Map::Entries)
+        {
+            const float magnitude = magnitudes[entry.bin];
+            if (entry.bin != bin)
+            {
+                bin = entry.bin;
+                const float left = magnitudes[bin - 1];
+                const float right = magnitudes[bin + 1];
+                isPeak = magnitude > left && magnitude >= right;
+                // vertex of the parabola through the peak and its neighbours. In [-0.5, 0.5] for a peak
+                offset = isPeak ? 0.5F * (left - right) / (left - 2.0F * magnitude + right) : 0.0F;
+            }
+            const float value = isPeak && offset >= entry.start && offset <= entry.end ? magnitude : 0.0F;
+            notes[entry.note] = value > notes[entry.note] ? value : notes[entry.note];
+        }
+        // smooth notes, then find the loudest note of each pitch class
+        m_smoothing.update();
+        const float smoothing = m_smoothing.value();
+        for (unsigned i = 0; i < NR_OF_PITCH_CLASSES; i++)
+        {
+            m_pitchClasses[i] = 0.0F;
+        }
+        for (unsigned note = 0; note < Map::NR_OF_NOTES; note++)
+        {
+            m_notes[note] = smoothing * m_notes[note] + (1.0F - smoothing) * notes[note];
+            const unsigned pitchClass = note % NR_OF_PITCH_CLASSES;
+            m_pitchClasses[pitchClass] = m_notes[note] > m_pitchClasses[pitchClass] ? m_notes[note] : m_pitchClasses[pitchClass];
+        }
+        return {m_pitchClasses, m_notes};
+    }
+
+private:
+    Parameter<float> m_smoothing{"Chroma.smoothing", 0.6f, 0.0f, 0.95f}; // Amount of the previous note levels kept per update
+    float m_pitchClasses[NR_OF_PITCH_CLASSES] = {0};
+    float m_notes[Map::NR_OF_NOTES] = {0};
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 
 struct RGBf;
 struct HSVf;
@@ -32,6 +33,14 @@ struct RGBf
     static RGBf fromHSV(const HSVf &hsv);
 };
 
+// 8-bit color as stored in screen back buffers. Same layout as SmartMatrix rgb24
+struct RGB8
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
 struct HSVf
 {
     float h; // Hue in range [0,1]
@@ -121,3 +130,17 @@ RGBf lerp(const RGBf & a, const RGBf & b, float t)
     result.b = a.b + t * (b.b - a.b);
     return result;
 }
+
+// Store color to float frame buffer pixel
+inline void storePixel(RGBf &dest, const RGBf &color)
+{
+    dest = color;
+}
+
+// Store color to 8-bit screen pixel. Converts the same way as blitting a float frame buffer
+inline void storePixel(RGB8 &dest, const RGBf &color)
+{
+    dest.r = static_cast<uint8_t>(255.0F * color.r);
+    dest.g = static_cast<uint8_t>(255.0F * color.g);
+    dest.b = static_cast<uint8_t>(255.0F * color.b);
+}
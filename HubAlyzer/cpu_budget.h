@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <atomic>
+#include <cstdint>
+
+// Tracks the CPU time a task spends on work per second and caps it.
+// Wrap every chunk of work in begin() / end() and get the time to sleep afterwards from delayTicks().
+// Once the budget of the current second is used up, the task sleeps until the next second starts.
+// Work time is measured as wall time, so time the task was preempted counts too and the cap errs on the safe side
+class CpuBudget
+{
+    static constexpr uint32_t WINDOW_US = 1000000; // Budget period
+
+public:
+    /// @brief Create budget
+    /// @p budgetUs Maximum CPU time per second in microseconds, e.g. 20000 for 2%
+    CpuBudget(uint32_t budgetUs)
+        : m_budgetUs(budgetUs)
+    {
+    }
+
+    /// @brief Start chunk of work
+    void begin()
+    {
+        const uint32_t now = micros();
+        if (now - m_windowStartUs >= WINDOW_US)
+        {
+            m_lastUsedUs.store(m_usedUs, std::memory_order_relaxed);
+            m_usedUs = 0;
+            m_windowStartUs = now;
+        }
+        m_workStartUs = now;
+    }
+
+    /// @brief End chunk of work started with begin()
+    void end()
+    {
+        m_usedUs += micros() - m_workStartUs;
+    }
+
+    /// @brief Returns true if the budget of the current second is used up. Do not wake up early for new work then
+    bool isUsedUp() const
+    {
+        // the window only rolls over in begin(), so a budget used up in a past second does not count
+        return m_usedUs >= m_budgetUs && micros() - m_windowStartUs < WINDOW_US;
+    }
+
+    /// @brief Get ticks to sleep after a chunk of work
+    /// @p intervalMs Normal time between chunks of work
+    /// @return Returns the interval or the time until the next budget period if the budget is used up
+    TickType_t delayTicks(uint32_t intervalMs) const
+    {
+        const uint32_t elapsedUs = micros() - m_windowStartUs;
+        if (m_usedUs < m_budgetUs || elapsedUs >= WINDOW_US)
+        {
+            return pdMS_TO_TICKS(intervalMs);
+        }
+        const uint32_t remainingUs = WINDOW_US - elapsedUs;
+        const TickType_t ticks = pdMS_TO_TICKS(remainingUs / 1000 + 1);
+        return ticks > pdMS_TO_TICKS(intervalMs) ? ticks : pdMS_TO_TICKS(intervalMs);
+    }
+
+    /// @brief CPU time used during the last full second in microseconds. Can be read from any task
+    uint32_t lastUsedUs() const
+    {
+        return m_lastUsedUs.load(std::memory_order_relaxed);
+    }
+
+private:
+    uint32_t m_budgetUs = 0;
+    uint32_t m_windowStartUs = 0;
+    uint32_t m_workStartUs = 0;
+    uint32_t m_usedUs = 0;
+    std::atomic<uint32_t> m_lastUsedUs{0};
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+#include <cstdint>
+
+// Time source for benchmarks in checks that run on the device and on the host.
+// The device counts CPU cycles. Hosts have no portable cycle counter and count nanoseconds instead, see Unit
+namespace CycleCounter
+{
+#ifdef ARDUINO
+    constexpr const char *Unit = "cycles";
+
+    /// @brief Current CPU cycle count. Wraps around, so only use differences
+    inline uint32_t now()
+    {
+        return ESP.getCycleCount();
+    }
+
+    /// @brief CPU cycles per second, e.g. to compare against a frame budget
+    inline uint32_t perSecond()
+    {
+        return static_cast<uint32_t>(getCpuFrequencyMhz()) * 1000000;
+    }
+#else
+    constexpr const char *Unit = "ns";
+
+    /// @brief Current time in nanoseconds. Wraps around, so only use differences
+    inline uint32_t now()
+    {
+        using namespace std::chrono;
+        return static_cast<uint32_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    /// @brief Nanoseconds per second, e.g. to compare against a frame budget
+    inline uint32_t perSecond()
+    {
+        return 1000000000;
+    }
+#endif
+}
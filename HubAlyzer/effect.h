@@ -1,9 +1,11 @@
 #pragma once
 
+#include "analysis_frame.h"
 #include "color.h"
 #include "vec.h"
 
 #include <memory>
+#include <utility>
 
 template <typename T>
 auto inline clamp(T value, T minimum, T maximum) -> T
@@ -11,6 +13,47 @@ auto inline clamp(T value, T minimum, T maximum) -> T
     return value < minimum ? minimum : (value > maximum ? maximum : value);
 }
 
+// Horizontal strip of frame rows an effect renders. Rendering a whole frame is a single strip over all rows.
+// Rows are addressed with frame coordinates, e.g. destRow(firstRow) is the first row of the strip
+struct Strip
+{
+    RGBf *dest = nullptr; // Destination row firstRow
+    RGBf *src = nullptr;  // Source row srcFirstRow. nullptr if the effect has no source
+    int width = 0;        // Width of rows in pixels
+    int height = 0;       // Height of full frame in rows
+    int firstRow = 0;     // First destination row
+    int endRow = 0;       // One past the last destination row
+    int srcFirstRow = 0;  // First source row available
+    int srcEndRow = 0;    // One past the last source row available
+
+    auto destRow(int y) const -> RGBf *
+    {
+        return dest + (y - firstRow) * width;
+    }
+
+    /// @brief Source row y. y must be in [srcFirstRow, srcEndRow)
+    auto srcRow(int y) const -> RGBf *
+    {
+        return src + (y - srcFirstRow) * width;
+    }
+};
+
+// Strip of 8-bit screen back buffer rows for effects rendering straight to the screen.
+// Rows are addressed with frame coordinates like in Strip
+struct ScreenStrip
+{
+    RGB8 *dest = nullptr; // Destination row firstRow
+    int width = 0;        // Width of rows in pixels
+    int height = 0;       // Height of full frame in rows
+    int firstRow = 0;     // First destination row
+    int endRow = 0;       // One past the last destination row
+
+    auto destRow(int y) const -> RGB8 *
+    {
+        return dest + (y - firstRow) * width;
+    }
+};
+
 // Interface for all effects rendering to or manipulating frame buffers
 class Effect
 {
@@ -26,6 +69,9 @@ public:
     // Shared effect object
     using SPtr = std::shared_ptr<Effect>;
 
+    // Frame rate effects with per-frame parameters were tuned for
+    static constexpr float NominalFrameRate = 50.0F;
+
     // Reimplement this in derived effect classes
     // Per default effects are applied to destination only
     virtual auto type() const -> Type
@@ -33,15 +79,60 @@ public:
       return Type::ToDestination;
     }
 
+    // Reimplement this in derived effect classes that read source rows different from the rows they render
+    // Returns the source rows [first, end) needed to render destination rows [firstRow, endRow) of a frame with height rows
+    virtual auto sourceRows(int firstRow, int endRow, [[maybe_unused]] int height) const -> std::pair<int, int>
+    {
+        return {firstRow, endRow};
+    }
+
+    // Reimplement this in derived effect classes that can render different strips of a frame at the same time, e.g. on both cores.
+    // render() must then only write rows of its strip and must not change effect state
+    virtual auto isRowParallel() const -> bool
+    {
+        return false;
+    }
+
+    // Reimplement this in derived effect classes to update state once per frame, e.g. animations
+    // Called before the first strip of a frame is rendered. dt is the time since the last frame in seconds,
+    // so animations run at the same speed regardless of frame rate
+    virtual auto prepare([[maybe_unused]] float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void
+    {
+    }
+
     // Reimplement this in derived effect classes
-    virtual auto render(RGBf *dest, const RGBf *src, const float *levels, const float *peaks, bool isBeat) -> void = 0;
+    // Renders the rows of strip. Can be called multiple times per frame for different strips
+    virtual auto render(const Strip &strip, const AnalysisFrame &frame) -> void = 0;
+
+    // Reimplement this in derived effect classes that only store destination pixels and never read them back
+    // Returns true if renderToScreen() can be called instead of render()
+    virtual auto canRenderToScreen() const -> bool
+    {
+        return false;
+    }
+
+    // Reimplement this in derived effect classes that can render to the screen
+    // Renders the rows of strip straight to the screen back buffer, converting pixels when storing them
+    virtual auto renderToScreen([[maybe_unused]] const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void
+    {
+    }
+};
+
+// Fixed list of effects that are rendered in order. The effects are owned elsewhere, e.g. by a PresetLibrary
+struct EffectChain
+{
+    static constexpr unsigned MAX_EFFECTS = 8; // Maximum # of effects in a chain
+
+    const char *name = "";
+    Effect *effects[MAX_EFFECTS] = {nullptr};
+    unsigned count = 0;
 };
 
 class NopEffect : public Effect
 {
 public:
     // The goggles, they do nothing...
-    virtual auto render([[maybe_unused]] RGBf *dest, [[maybe_unused]] const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+    virtual auto render([[maybe_unused]] const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
     {
     }
 };
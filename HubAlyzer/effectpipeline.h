@@ -2,54 +2,349 @@
 
 #include "color.h"
 #include "effect.h"
+#include "frame_exchange.h"
+#include "screen.h"
+#include "row_worker.h"
 
-template <unsigned WIDTH, unsigned HEIGHT>
+#include <cstring>
+
+// Renders an effect chain to a frame buffer. The chain can be switched at runtime, optionally with a crossfade.
+// Chains whose effects only store pixels, e.g. FillColor + DrawSpectrum, are rendered straight to the screen back buffer
+// without a float frame buffer and blit pass. Their float buffers are only rendered again when switching chains.
+// If a worker is started, row-parallel effects are split into a top and a bottom half rendered on both CPU cores
+// CROSSFADE = If true the outgoing chain keeps running while the incoming chain fades in. Needs 3 additional frame buffers
+template <unsigned WIDTH, unsigned HEIGHT, bool CROSSFADE = false>
 class EffectPipeline
 {
+    static constexpr unsigned NR_OF_BUFFERS = CROSSFADE ? 5 : 2; // in + out buffer per chain, plus crossfade output
+    static constexpr unsigned SPLIT_ROW = HEIGHT / 2;              // First row rendered by the worker
+
+    // Effect chain with its own buffers, so feedback effects see their own previous output
+    struct Lane
+    {
+        const EffectChain *chain = nullptr;
+        RGBf *inBuffer = nullptr;
+        RGBf *outBuffer = nullptr;
+        bool onScreen = false; // True if the last frame was rendered to the screen and the buffers are stale
+    };
+
+    // Chain switch requested by setChain(). Published as a whole, so the chain is never paired with another request's fade length
+    struct ChainRequest
+    {
+        const EffectChain *chain = nullptr;
+        unsigned fadeFrames = 0;
+    };
+
 public:
-    EffectPipeline(std::vector<Effect::SPtr> &effects)
-        : m_effects(effects)
+    EffectPipeline(const EffectChain *chain = nullptr)
     {
+        m_lanes[0] = {chain, m_buffers[1], m_buffers[0]};
+        if constexpr (CROSSFADE)
+        {
+            m_lanes[1] = {nullptr, m_buffers[3], m_buffers[2]};
+        }
+        m_output = m_lanes[0].outBuffer;
     }
 
-    auto render(const float *levels, const float *peaks, bool isBeat) -> void
+    /// @brief Start worker task rendering the bottom half of row-parallel effects. Without it everything is rendered by the calling task
+    /// @p core CPU core to run the worker on. Should be the other core than the render task
+    /// @p priority FreeRTOS priority of the worker. Must be below real-time tasks on that core, e.g. the microphone reader
+    /// @return Returns false if the worker could not be started
+    auto beginWorker(RowWorker::Core core = 0, RowWorker::Priority priority = 3) -> bool
     {
-        // swap buffers so output of previous frame is input for this frame
-        std::swap(m_outBuffer, m_inBuffer);
-        // loop through all effects
-        for (auto &effect : m_effects)
-        {
-          switch(effect->type()) {
-              case Effect::Type::ToDestination:
-                  effect->render(m_outBuffer, nullptr, levels, peaks, isBeat);
-                  break;
-              case Effect::Type::ToSource:
-                  effect->render(m_inBuffer, nullptr, levels, peaks, isBeat);
-                  break;
-              case Effect::Type::DestinationToSource:
-                  effect->render(m_inBuffer, m_outBuffer, levels, peaks, isBeat);
-                  break;
-            default:
-                  effect->render(m_outBuffer, m_inBuffer, levels, peaks, isBeat);
-          }
+        return m_worker.begin(core, priority);
+    }
+
+    /// @brief Switch to a new effect chain at the start of the next frame. Only call from one task at a time, e.g. the render task.
+    /// If called several times before the next frame, the last request wins
+    /// @p chain New effect chain. Must stay valid while in use
+    /// @p fadeFrames Number of frames to crossfade from the current chain. Ignored if CROSSFADE is false
+    auto setChain(const EffectChain *chain, unsigned fadeFrames = 0) -> void
+    {
+        m_chainRequests.writeFrame() = {chain, fadeFrames};
+        m_chainRequests.publish();
+    }
+
+    /// @brief Currently active effect chain. The outgoing chain during a crossfade is not returned
+    auto chain() const -> const EffectChain *
+    {
+        return m_lanes[m_active].chain;
+    }
+
+    /// @brief Render frame and blit it to screen back buffer
+    /// @p dt Time since last frame in seconds
+    auto render(float dt, const AnalysisFrame &frame, Screen &screen) -> void
+    {
+        switchToPendingChain(frame);
+        if (m_fadeFramesLeft == 0 && canRenderToScreen(m_lanes[m_active].chain))
+        {
+            renderLaneToScreen(m_lanes[m_active], screen.backBuffer(), dt, frame);
+            return;
         }
+        renderFrame(dt, frame);
+        screen.blit(m_output);
     }
 
-    auto add(Effect::SPtr effect) -> void
+    /// @brief Render frame to float frame buffer only. Use output() to get the frame
+    /// @p dt Time since last frame in seconds
+    auto render(float dt, const AnalysisFrame &frame) -> void
     {
-        m_effects.push_back(effect);
+        switchToPendingChain(frame);
+        renderFrame(dt, frame);
     }
 
+    /// @brief Last frame rendered to float frame buffer. Stale while the chain is rendered to the screen
     auto output() const -> const RGBf *
     {
-        return m_outBuffer;
+        return m_output;
     }
 
 private:
-    std::vector<Effect::SPtr> m_effects;
+    auto switchToPendingChain(const AnalysisFrame &frame) -> void
+    {
+        // switch chains only between frames. A switch requested during a crossfade waits until it has finished
+        if (m_fadeFramesLeft == 0 && m_chainRequests.update())
+        {
+            const auto &request = m_chainRequests.readFrame();
+            switchChain(request.chain, request.fadeFrames, frame);
+        }
+    }
+
+    auto renderFrame(float dt, const AnalysisFrame &frame) -> void
+    {
+        renderLane(m_lanes[m_active], dt, frame);
+        m_output = m_lanes[m_active].outBuffer;
+        if constexpr (CROSSFADE)
+        {
+            if (m_fadeFramesLeft > 0)
+            {
+                auto &outgoing = m_lanes[m_active ^ 1];
+                renderLane(outgoing, dt, frame);
+                const float t = 1.0F - static_cast<float>(m_fadeFramesLeft) / m_fadeFrames;
+                mix(m_buffers[4], outgoing.outBuffer, m_output, t);
+                m_output = m_buffers[4];
+                m_fadeFramesLeft--;
+            }
+        }
+    }
+
+    auto switchChain(const EffectChain *chain, unsigned fadeFrames, const AnalysisFrame &frame) -> void
+    {
+        // the float buffers are history of the next chain, so bring them up to date with what is on the screen
+        auto &current = m_lanes[m_active];
+        if (current.onScreen)
+        {
+            renderEffects(current, current.outBuffer, frame);
+            current.onScreen = false;
+            m_output = current.outBuffer;
+        }
+        if constexpr (CROSSFADE)
+        {
+            if (fadeFrames > 0 && chain != m_lanes[m_active].chain)
+            {
+                // start incoming chain from the current image, so feedback effects continue seamlessly
+                auto &incoming = m_lanes[m_active ^ 1];
+                incoming.chain = chain;
+                memcpy(incoming.inBuffer, m_output, sizeof(RGBf) * WIDTH * HEIGHT);
+                memcpy(incoming.outBuffer, m_output, sizeof(RGBf) * WIDTH * HEIGHT);
+                m_active ^= 1;
+                m_fadeFrames = fadeFrames;
+                m_fadeFramesLeft = fadeFrames;
+                return;
+            }
+        }
+        m_lanes[m_active].chain = chain;
+    }
+
+    auto renderLane(Lane &lane, float dt, const AnalysisFrame &frame) -> void
+    {
+        // swap buffers so output of previous frame is input for this frame
+        std::swap(lane.outBuffer, lane.inBuffer);
+        lane.onScreen = false;
+        if (lane.chain == nullptr)
+        {
+            return;
+        }
+        for (unsigned i = 0; i < lane.chain->count; i++)
+        {
+            lane.chain->effects[i]->prepare(dt, frame);
+        }
+        renderEffects(lane, lane.outBuffer, frame);
+    }
+
+    // Returns true if all effects of chain can render to the screen
+    static auto canRenderToScreen(const EffectChain *chain) -> bool
+    {
+        if (chain == nullptr || chain->count == 0)
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < chain->count; i++)
+        {
+            if (chain->effects[i]->type() != Effect::Type::ToDestination || !chain->effects[i]->canRenderToScreen())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Render pure writer chain straight to screen back buffer. The float buffers of the lane are left untouched
+    static auto renderLaneToScreen(Lane &lane, RGB8 *dest, float dt, const AnalysisFrame &frame) -> void
+    {
+        const ScreenStrip strip = {dest, WIDTH, HEIGHT, 0, HEIGHT};
+        for (unsigned i = 0; i < lane.chain->count; i++)
+        {
+            auto effect = lane.chain->effects[i];
+            effect->prepare(dt, frame);
+            effect->renderToScreen(strip, frame);
+        }
+        lane.onScreen = true;
+    }
+
+    // Render effects of lane to float buffers without preparing them.
+    // Runs of row-parallel effects are split between this task and the worker with a barrier after each run
+    auto renderEffects(const Lane &lane, RGBf *out, const AnalysisFrame &frame) -> void
+    {
+        if (lane.chain == nullptr)
+        {
+            return;
+        }
+        if (!m_worker.isRunning())
+        {
+            renderEffectRange(lane, out, 0, lane.chain->count, 0, HEIGHT, frame);
+            return;
+        }
+        unsigned first = 0;
+        while (first < lane.chain->count)
+        {
+            if (!lane.chain->effects[first]->isRowParallel())
+            {
+                renderEffectRange(lane, out, first, first + 1, 0, HEIGHT, frame);
+                first++;
+                continue;
+            }
+            const unsigned end = parallelRunEnd(*lane.chain, first);
+            m_job = {&lane, out, first, end, &frame};
+            m_worker.start(renderJob, this);
+            renderEffectRange(lane, out, first, end, 0, SPLIT_ROW, frame);
+            m_worker.wait();
+            first = end;
+        }
+    }
+
+    // Buffers an effect reads and writes
+    enum Access : unsigned
+    {
+        None = 0,
+        In = 1,
+        Out = 2
+    };
+
+    static auto writes(Effect::Type type) -> unsigned
+    {
+        return type == Effect::Type::ToSource || type == Effect::Type::DestinationToSource ? In : Out;
+    }
+
+    static auto readsSource(Effect::Type type) -> unsigned
+    {
+        return type == Effect::Type::SourceToDestination ? In : (type == Effect::Type::DestinationToSource ? Out : None);
+    }
+
+    // Returns true if effect reads source rows outside of the half it renders
+    static auto readsAcrossSplit(const Effect &effect) -> bool
+    {
+        const auto top = effect.sourceRows(0, SPLIT_ROW, HEIGHT);
+        const auto bottom = effect.sourceRows(SPLIT_ROW, HEIGHT, HEIGHT);
+        return top.second > static_cast<int>(SPLIT_ROW) || bottom.first < static_cast<int>(SPLIT_ROW);
+    }
+
+    // Returns one past the last effect of the row-parallel run starting at first.
+    // A run ends before an effect that reads rows of the other half written in the run, or writes rows the other half read in the run
+    static auto parallelRunEnd(const EffectChain &chain, unsigned first) -> unsigned
+    {
+        unsigned written = None;
+        unsigned readAcross = None;
+        unsigned end = first;
+        for (; end < chain.count && chain.effects[end]->isRowParallel(); end++)
+        {
+            const auto &effect = *chain.effects[end];
+            const auto source = readsSource(effect.type());
+            const bool across = source != None && readsAcrossSplit(effect);
+            if (end > first && ((across && (written & source) != 0) || (readAcross & writes(effect.type())) != 0))
+            {
+                break;
+            }
+            written |= writes(effect.type());
+            readAcross |= across ? source : None;
+        }
+        return end;
+    }
+
+    // Render bottom half of current job. Called from the worker task
+    static void renderJob(void *context)
+    {
+        auto object = reinterpret_cast<EffectPipeline *>(context);
+        const auto &job = object->m_job;
+        renderEffectRange(*job.lane, job.out, job.first, job.end, SPLIT_ROW, HEIGHT, *job.frame);
+    }
+
+    // Render effects [first, end) of lane to rows [firstRow, endRow). ToDestination and SourceToDestination effects write to out
+    static auto renderEffectRange(const Lane &lane, RGBf *out, unsigned first, unsigned end, int firstRow, int endRow, const AnalysisFrame &frame) -> void
+    {
+        for (unsigned i = first; i < end; i++)
+        {
+            auto effect = lane.chain->effects[i];
+            Strip strip = {nullptr, nullptr, WIDTH, HEIGHT, firstRow, endRow, 0, HEIGHT};
+            switch (effect->type())
+            {
+            case Effect::Type::ToDestination:
+                strip.dest = out + firstRow * WIDTH;
+                break;
+            case Effect::Type::ToSource:
+                strip.dest = lane.inBuffer + firstRow * WIDTH;
+                break;
+            case Effect::Type::DestinationToSource:
+                strip.dest = lane.inBuffer + firstRow * WIDTH;
+                strip.src = out;
+                break;
+            default:
+                strip.dest = out + firstRow * WIDTH;
+                strip.src = lane.inBuffer;
+            }
+            effect->render(strip, frame);
+        }
+    }
+
+    // Linear blend from a to b. t must be in [0,1]
+    static auto mix(RGBf *dest, const RGBf *a, const RGBf *b, float t) -> void
+    {
+        const float s = 1.0F - t;
+        for (unsigned i = 0; i < WIDTH * HEIGHT; i++)
+        {
+            dest[i].r = s * a[i].r + t * b[i].r;
+            dest[i].g = s * a[i].g + t * b[i].g;
+            dest[i].b = s * a[i].b + t * b[i].b;
+        }
+    }
+
+    // Effects rendered by the worker
+    struct Job
+    {
+        const Lane *lane = nullptr;
+        RGBf *out = nullptr;
+        unsigned first = 0;
+        unsigned end = 0;
+        const AnalysisFrame *frame = nullptr;
+    };
 
-    RGBf m_bufferA[WIDTH * HEIGHT];
-    RGBf m_bufferB[WIDTH * HEIGHT];
-    RGBf *m_inBuffer = m_bufferB;
-    RGBf *m_outBuffer = m_bufferA;
+    RGBf m_buffers[NR_OF_BUFFERS][WIDTH * HEIGHT];
+    Lane m_lanes[2];
+    unsigned m_active = 0;
+    RGBf *m_output = nullptr;
+    FrameExchange<ChainRequest> m_chainRequests;
+    unsigned m_fadeFrames = 0;
+    unsigned m_fadeFramesLeft = 0;
+    RowWorker m_worker;
+    Job m_job;
 };
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "color.h"
+#include "effect.h"
+#include "palette.h"
+
+namespace Effects
+{
+
+  // Chromagram display. Shows the 12 pitch classes C to B as columns from left to right, so effects follow key and harmony
+  // rather than loudness per frequency. Needs chroma in the analysis frame, see Chroma. With the FFT of the sketch (1024 samples
+  // at 48kHz) notes are resolved from G#4 (~415Hz) to the maximum analysis frequency, lower notes only show through their harmonics
+  template <int WIDTH, int HEIGHT>
+  class Chromagram : public Effect
+  {
+    static constexpr int NrOfPitchClasses = static_cast<int>(AnalysisFrame::NR_OF_PITCH_CLASSES);
+
+  public:
+    enum class Mode
+    {
+      PitchClasses, // One bar per pitch class growing from the bottom
+      Notes         // One row of cells per octave, lowest octave at the bottom. Brightness follows the note level
+    };
+
+    /// @brief Create chromagram effect
+    /// @p mode Display mode
+    /// @p palette Pitch class colors. Pitch classes are spread over the whole palette
+    Chromagram(Mode mode = Mode::PitchClasses, const Palette &palette = Palettes::rainbow())
+        : m_mode(mode), m_palette(&palette)
+    {
+      // map panel columns to pitch classes once
+      for (int x = 0; x < WIDTH; x++)
+      {
+        const int pitchClass = (x * NrOfPitchClasses) / WIDTH;
+        m_pitchClasses[x] = static_cast<uint8_t>(pitchClass);
+        m_colorIndices[x] = static_cast<uint8_t>((pitchClass * Palette::SIZE) / NrOfPitchClasses);
+      }
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip, frame);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip, frame);
+    }
+
+  private:
+    template <typename STRIP>
+    void renderRows(const STRIP &strip, const AnalysisFrame &frame) const
+    {
+      const int nrOfOctaves = static_cast<int>(frame.nrOfOctaves);
+      if (m_mode == Mode::Notes && nrOfOctaves == 0)
+      {
+        return;
+      }
+      for (int y = strip.firstRow; y < strip.endRow; y++)
+      {
+        auto dest = strip.destRow(y);
+        // height of this row above the bottom edge
+        const int rowFromBottom = HEIGHT - 1 - y;
+        const int octave = (rowFromBottom * nrOfOctaves) / HEIGHT;
+        for (int x = 0; x < WIDTH; x++)
+        {
+          const unsigned pitchClass = m_pitchClasses[x];
+          if (m_mode == Mode::PitchClasses)
+          {
+            // fraction of this row covered by the bar. The top pixel is drawn partially
+            const float covered = frame.chroma[pitchClass] * HEIGHT - rowFromBottom;
+            if (covered > 0.0F)
+            {
+              storePixel(dest[x], covered >= 1.0F ? (*m_palette)[m_colorIndices[x]] : m_palette->at(m_colorIndices[x], covered));
+            }
+          }
+          else
+          {
+            const float level = frame.octaveChroma[octave][pitchClass];
+            storePixel(dest[x], m_palette->at(m_colorIndices[x], level > 1.0F ? 1.0F : level));
+          }
+        }
+      }
+    }
+
+    Mode m_mode = Mode::PitchClasses;
+    const Palette *m_palette = nullptr;
+    uint8_t m_pitchClasses[WIDTH] = {0};
+    uint8_t m_colorIndices[WIDTH] = {0};
+  };
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "approx.h"
 #include "color.h"
 #include "effect.h"
 
@@ -21,15 +22,33 @@ namespace Effects
       return TYPE;
     }
 
-    virtual auto render(RGBf *dest, const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+    virtual auto isRowParallel() const -> bool override
     {
-      fill(dest, m_color);
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      fill(strip.destRow(strip.firstRow), (strip.endRow - strip.firstRow) * WIDTH, m_color);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return TYPE == Effect::Type::ToDestination;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      RGB8 color;
+      storePixel(color, m_color);
+      fill(strip.destRow(strip.firstRow), (strip.endRow - strip.firstRow) * WIDTH, color);
     }
 
   private:
-    void fill(RGBf *dest, RGBf color)
+    template <typename PIXEL>
+    void fill(PIXEL *dest, unsigned count, PIXEL color)
     {
-      for (unsigned i = 0; i < WIDTH * HEIGHT; i++)
+      for (unsigned i = 0; i < count; i++)
       {
           dest[i] = color;
       }
@@ -38,4 +57,72 @@ namespace Effects
     RGBf m_color = {0, 0, 0};
   };
 
+  // Boot animation shown until the first audio arrives. A ring grows from the center and fades out once per second
+  template <int WIDTH, int HEIGHT>
+  class Listening : public Effect
+  {
+    static constexpr float PulseHz = 1.0F;
+    static constexpr float MaxRadius = 0.5F * (WIDTH < HEIGHT ? WIDTH : HEIGHT);
+
+  public:
+    Listening(const RGBf &color = {0, 0.5F, 1})
+      : m_color(color)
+    {}
+
+    virtual auto prepare(float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      m_phase += dt * PulseHz;
+      m_phase -= std::floor(m_phase);
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+  private:
+    template <typename STRIP>
+    void renderRows(const STRIP &strip) const
+    {
+      const float radius = MaxRadius * m_phase;
+      const float brightness = 1.0F - m_phase;
+      for (int y = strip.firstRow; y < strip.endRow; y++)
+      {
+        auto row = strip.destRow(y);
+        const float dy = y + 0.5F - 0.5F * HEIGHT;
+        // distances of the row's pixels from the center
+        float distances[WIDTH];
+        for (int x = 0; x < WIDTH; x++)
+        {
+          const float dx = x + 0.5F - 0.5F * WIDTH;
+          distances[x] = dx * dx + dy * dy;
+        }
+        Approx::sqrt<ApproxPrecision::Medium>(distances, distances, WIDTH);
+        for (int x = 0; x < WIDTH; x++)
+        {
+          const float value = brightness * clamp(1.0F - std::fabs(distances[x] - radius), 0.0F, 1.0F);
+          storePixel(row[x], RGBf(m_color.r * value, m_color.g * value, m_color.b * value));
+        }
+      }
+    }
+
+    RGBf m_color = {0, 0, 0};
+    float m_phase = 0.0F;
+  };
+
 }
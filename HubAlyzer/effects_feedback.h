@@ -3,8 +3,10 @@
 #include "color.h"
 #include "vec.h"
 #include "effect.h"
+#include "parameters.h"
 
 #include <cmath>
+#include <cstring>
 
 namespace Effects
 {
@@ -19,61 +21,79 @@ namespace Effects
           return Effect::Type::SourceToDestination;
         }
 
-        virtual auto render(RGBf *dest, const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+        virtual auto prepare([[maybe_unused]] float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
         {
-            moveFromCenterVertical<WIDTH, HEIGHT>(dest, src, m_dist);
+            m_dist.update();
+        }
+
+        virtual auto sourceRows(int firstRow, int endRow, [[maybe_unused]] int height) const -> std::pair<int, int> override
+        {
+            // source rows wrap around at the bottom, even at a distance of exactly 1, so check every row of the strip
+            int first = sourceRow(firstRow);
+            int end = first + 1;
+            for (int y = firstRow + 1; y < endRow; y++)
+            {
+                const int row = sourceRow(y);
+                first = row < first ? row : first;
+                end = row + 1 > end ? row + 1 : end;
+            }
+            return {first, end};
+        }
+
+        virtual auto isRowParallel() const -> bool override
+        {
+            return true;
+        }
+
+        virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            moveFromCenterVertical(strip);
         }
 
     private:
-        template <unsigned SRC_WIDTH, unsigned SRC_HEIGHT>
-        auto moveFromCenterHorizontal(RGBf *dest, const RGBf *src, float dist) -> void
+        auto moveFromCenterHorizontal(const Strip &strip) -> void
         {
-            for (int32_t y = 0; y < HEIGHT; y++)
+            for (int y = strip.firstRow; y < strip.endRow; y++)
             {
-                const auto ty = y * SRC_WIDTH;
+                auto dest = strip.destRow(y);
+                const auto src = strip.srcRow(y);
                 float u = 0;
                 for (int32_t x = 0; x < WIDTH / 2; x++)
                 {
-                  float tx = std::fmod(u, SRC_WIDTH - 1);
-                  *dest++ = src[static_cast<int>(ty + tx)];
-                  u += m_dist;
+                  float tx = std::fmod(u, WIDTH - 1);
+                  *dest++ = src[static_cast<int>(tx)];
+                  u += m_dist.value();
                 }
                 u = WIDTH / 2;
                 for (int32_t x = WIDTH / 2; x < WIDTH; x++)
                 {
-                  float tx = std::fmod(u, SRC_WIDTH - 1);
-                  *dest++ = src[static_cast<int>(ty + tx)];
-                  u += m_dist;
+                  float tx = std::fmod(u, WIDTH - 1);
+                  *dest++ = src[static_cast<int>(tx)];
+                  u += m_dist.value();
                 }
             }
         }
 
-        template <unsigned SRC_WIDTH, unsigned SRC_HEIGHT>
-        auto moveFromCenterVertical(RGBf *dest, const RGBf *src, float dist) -> void
+        // Source row of destination row y. Rows move away from the center by m_dist rows per row
+        auto sourceRow(int y) const -> int
         {
-            for (int32_t x = 0; x < WIDTH; x++)
+            const float dist = m_dist.value();
+            const float v = y < static_cast<int>(HEIGHT / 2) ? (HEIGHT / 2 - 1) - (HEIGHT / 2 - 1 - y) * dist : HEIGHT / 2 + (y - static_cast<int>(HEIGHT / 2)) * dist;
+            // rows above the center move below row 0 for distances above 1, so wrap them into the matrix
+            float ty = std::fmod(v, HEIGHT - 1);
+            ty = ty < 0 ? ty + (HEIGHT - 1) : ty;
+            return static_cast<int>(ty);
+        }
+
+        auto moveFromCenterVertical(const Strip &strip) -> void
+        {
+            for (int y = strip.firstRow; y < strip.endRow; y++)
             {
-                auto dst = dest + x;
-                float v = HEIGHT / 2 - 1;
-                for (int32_t y = HEIGHT / 2 - 1; y > 0; y--)
-                {
-                  float ty = std::fmod(v, SRC_HEIGHT - 1);
-                  *dst = src[static_cast<int>(ty * SRC_WIDTH)];
-                  dst += SRC_WIDTH;
-                  v -= m_dist;
-                }
-                v = HEIGHT / 2;
-                for (int32_t y = HEIGHT / 2; y < HEIGHT; y++)
-                {
-                  float ty = std::fmod(v, SRC_HEIGHT - 1);
-                  *dst = src[static_cast<int>(ty * SRC_WIDTH)];
-                  dst += SRC_WIDTH;
-                  v += m_dist;
-                }
+                memcpy(strip.destRow(y), strip.srcRow(sourceRow(y)), sizeof(RGBf) * WIDTH);
             }
         }
 
-        float m_dist = 0.5F;
+        Parameter<float> m_dist{"MoveFromCenter.distance", 0.5F, 0.0F, 4.0F}; // Source rows per destination row
     };
 
     // Rotate + zoom + blit buffer
@@ -86,9 +106,26 @@ namespace Effects
           return Effect::Type::SourceToDestination;
         }
 
-        virtual auto render(RGBf *dest, const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+        virtual auto sourceRows([[maybe_unused]] int firstRow, [[maybe_unused]] int endRow, int height) const -> std::pair<int, int> override
         {
-            rotoBlit<WIDTH, HEIGHT, true>(dest, src, m_position, m_angle, m_scale);
+            // rotation can read from anywhere
+            return {0, height};
+        }
+
+        virtual auto prepare([[maybe_unused]] float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            m_angle.update();
+            m_scale.update();
+        }
+
+        virtual auto isRowParallel() const -> bool override
+        {
+            return true;
+        }
+
+        virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            rotoBlit<true>(strip, m_position, m_angle.value(), m_scale.value());
         }
 
     private:
@@ -96,8 +133,8 @@ namespace Effects
         // @param shift Shift in x and y. Must be in (0,1)
         // @param angle Rotation angle in radians. Must be in (0,2*PI)
         // @param zoom Zoom factor. Must be > 0
-        template <unsigned SRC_WIDTH, unsigned SRC_HEIGHT, bool ADDITIVE = false>
-        auto rotoBlit(RGBf *dest, const RGBf *src, const vec2f_t &position, float angle, float scale) -> void
+        template <bool ADDITIVE = false>
+        auto rotoBlit(const Strip &strip, const vec2f_t &position, float angle, float scale) -> void
         {
             float sa = std::sin(angle);
             float ca = std::cos(angle);
@@ -110,20 +147,22 @@ namespace Effects
             float pb0 = pb * (position.y - HEIGHT / 2);
             float pc0 = pc * (position.x - WIDTH / 2);
             float pd0 = pd * (position.y - HEIGHT / 2);
-            const float uY = pb - pa * WIDTH;
-            const float vY = pd - pc * WIDTH;
-            float u = pb0 + pa0;
-            float v = pd0 + pc0;
-            for (int32_t y = 0; y < HEIGHT; y++)
+            for (int y = strip.firstRow; y < strip.endRow; y++)
             {
+                auto dest = strip.destRow(y);
+                // texture coordinates at start of row
+                float u = pb0 + pa0 + y * pb;
+                float v = pd0 + pc0 + y * pd;
                 for (int32_t x = 0; x < WIDTH; x++)
                 {
-                    float tx = std::fmod(u, SRC_WIDTH - 1);
-                    float ty = std::fmod(v, SRC_HEIGHT - 1);
+                    float tx = std::fmod(u, WIDTH - 1);
+                    float ty = std::fmod(v, HEIGHT - 1);
+                    tx = tx < 0 ? tx + (WIDTH - 1) : tx;
+                    ty = ty < 0 ? ty + (HEIGHT - 1) : ty;
+                    const auto &in = strip.srcRow(static_cast<int>(ty))[static_cast<int>(tx)];
                     if constexpr (ADDITIVE)
                     {
                         auto out = *dest;
-                        const auto & in = src[static_cast<int>(ty * SRC_WIDTH + tx)];
                         out.r = clamp(in.r + out.r, 0.0F, 1.0f);
                         out.g = clamp(in.g + out.g, 0.0F, 1.0f);
                         out.b = clamp(in.b + out.b, 0.0F, 1.0f);
@@ -131,35 +170,45 @@ namespace Effects
                     }
                     else
                     {
-                        *dest++ = src[static_cast<int>(ty * SRC_WIDTH + tx)];
+                        *dest++ = in;
                     }
                     u += pa;
                     v += pc;
                 }
-                u += uY;
-                v += vY;
             }
         }
 
         vec2f_t m_position = {WIDTH / 2, HEIGHT / 2};
-        float m_angle = 0;
-        float m_scale = 1.0F;
+        Parameter<float> m_angle{"RotoBlit.angle", 0.0F, 0.0F, 6.2831853F}; // Rotation angle in radians
+        Parameter<float> m_scale{"RotoBlit.scale", 1.0F, 0.1F, 10.0F};      // Zoom factor
     };
 
-    // Fade screen to black or white. t must be in [-1,1]
+    // Fade screen to black or white. t must be in [-1,1] and is applied NominalFrameRate times per second
     template <unsigned WIDTH, unsigned HEIGHT>
     class ChangeBrightness : public Effect
     {
     public:
-        virtual auto render(RGBf *dest, const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+        virtual auto prepare(float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            // scale by (1 + t) per nominal frame
+            m_t.update();
+            m_frameT = std::pow(1.0F + m_t.value(), dt * NominalFrameRate) - 1.0F;
+        }
+
+        virtual auto isRowParallel() const -> bool override
         {
-            changeBrightness(dest, src, m_t);
+            return true;
+        }
+
+        virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            changeBrightness(strip.destRow(strip.firstRow), (strip.endRow - strip.firstRow) * WIDTH, m_frameT);
         }
 
     private:
-        auto changeBrightness(RGBf *dest, [[maybe_unused]] const RGBf *src, float t) -> void
+        auto changeBrightness(RGBf *dest, unsigned count, float t) -> void
         {
-            for (unsigned i = 0; i < WIDTH * HEIGHT; i++)
+            for (unsigned i = 0; i < count; i++)
             {
                 // note that these input colors are not linear RGB. we should probably gamma-correct them
                 auto color = dest[i];
@@ -173,23 +222,36 @@ namespace Effects
             }
         }
 
-        float m_t = 1.0F;
+        Parameter<float> m_t{"ChangeBrightness.t", 1.0F, -1.0F, 1.0F};
+        float m_frameT = 1.0F;
     };
 
-    // Decrease/increase screen saturation. t must be in [-1,1]
+    // Decrease/increase screen saturation. t must be in [-1,1] and is applied NominalFrameRate times per second
     template <unsigned WIDTH, unsigned HEIGHT>
     class ChangeSaturation : public Effect
     {
     public:
-        virtual auto render(RGBf *dest, const RGBf *src, [[maybe_unused]] const float *levels, [[maybe_unused]] const float *peaks, [[maybe_unused]] bool isBeat) -> void override
+        virtual auto prepare(float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+        {
+            // scale distance to gray by (1 + t) per nominal frame
+            m_t.update();
+            m_frameT = std::pow(1.0F + m_t.value(), dt * NominalFrameRate) - 1.0F;
+        }
+
+        virtual auto isRowParallel() const -> bool override
+        {
+            return true;
+        }
+
+        virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
         {
-            changeSaturation(dest, src, m_t);
+            changeSaturation(strip.destRow(strip.firstRow), (strip.endRow - strip.firstRow) * WIDTH, m_frameT);
         }
 
     private:
-        auto changeSaturation(RGBf *dest, [[maybe_unused]] const RGBf *src, float t) -> void
+        auto changeSaturation(RGBf *dest, unsigned count, float t) -> void
         {
-            for (unsigned i = 0; i < WIDTH * HEIGHT; i++)
+            for (unsigned i = 0; i < count; i++)
             {
                 // note that these input colors are not linear RGB. we should probably gamma-correct them
                 auto color = dest[i];
@@ -204,7 +266,8 @@ namespace Effects
             }
         }
 
-        float m_t = 1.0F;
+        Parameter<float> m_t{"ChangeSaturation.t", 1.0F, -1.0F, 1.0F};
+        float m_frameT = 1.0F;
     };
 
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "color.h"
+#include "effect.h"
+#include "parameters.h"
+
+namespace Effects
+{
+
+  // Sound level display, e.g. for noise limits of a venue. The upper half shows the fast level LAF, the lower half the LAeq of
+  // the current window. Levels are drawn as bars from left to right over [MIN_DB, MAX_DB]. Bars turn from green to red above the
+  // limit. White marks show LAFmax and the limit. Needs sound levels in the analysis frame, see SoundLevelMeter
+  template <int WIDTH, int HEIGHT, int MIN_DB = 40, int MAX_DB = 110>
+  class LevelMeter : public Effect
+  {
+    static_assert(MAX_DB > MIN_DB, "Level range must not be empty");
+
+  public:
+    virtual auto prepare([[maybe_unused]] float dt, const AnalysisFrame &frame) -> void override
+    {
+      m_limitDb.update();
+      m_fastX = toX(frame.soundLevels.lafDb);
+      m_eqX = toX(frame.soundLevels.laeqDb);
+      m_fastMaxX = toX(frame.soundLevels.lafMaxDb);
+      m_limitX = toX(static_cast<float>(m_limitDb.value()));
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+  private:
+    // Pixel column of level. Columns left of it are part of the bar
+    static auto toX(float db) -> int
+    {
+      const float x = (db - MIN_DB) * WIDTH / (MAX_DB - MIN_DB);
+      return x <= 0.0F ? 0 : (x >= WIDTH ? WIDTH : static_cast<int>(x + 0.5F));
+    }
+
+    template <typename STRIP>
+    void renderRows(const STRIP &strip) const
+    {
+      const RGBf Below = {0.0F, 0.8F, 0.0F};
+      const RGBf Above = {1.0F, 0.0F, 0.0F};
+      const RGBf Mark = {1.0F, 1.0F, 1.0F};
+      for (int y = strip.firstRow; y < strip.endRow; y++)
+      {
+        auto dest = strip.destRow(y);
+        const int barX = y < HEIGHT / 2 ? m_fastX : m_eqX;
+        for (int x = 0; x < barX; x++)
+        {
+          storePixel(dest[x], x < m_limitX ? Below : Above);
+        }
+        if (m_limitX < WIDTH)
+        {
+          storePixel(dest[m_limitX], Mark);
+        }
+        if (y < HEIGHT / 2 && m_fastMaxX > 0)
+        {
+          storePixel(dest[m_fastMaxX - 1], Mark);
+        }
+      }
+    }
+
+    int m_fastX = 0;
+    int m_eqX = 0;
+    int m_fastMaxX = 0;
+    int m_limitX = WIDTH;
+    Parameter<int32_t> m_limitDb{"LevelMeter.limitDb", 100, MIN_DB, MAX_DB}; // Level above which bars turn red
+  };
+
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "color.h"
+#include "effect.h"
+#include "palette.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace Effects
+{
+
+  // Beat-reactive particle system. Sparks fly from spectrum bands that are at their peak, a fountain sprays from the
+  // bottom with bass energy and every beat explodes a burst from the center. Particles are additively blended.
+  // Particles live in a fixed-capacity structure-of-arrays pool with 16-bit fixed-point coordinates (1/64 pixel).
+  // Dead particles are swap-removed, so the pool is always dense and never allocates.
+  // CAPACITY = Maximum number of live particles. Uses 11 bytes per particle
+  template <unsigned WIDTH, unsigned HEIGHT, unsigned NR_OF_BANDS, unsigned CAPACITY = 1024>
+  class Particles : public Effect
+  {
+    static_assert(NR_OF_BANDS <= AnalysisFrame::MAX_BANDS, "Too many bands for AnalysisFrame");
+    static_assert(WIDTH < 256 && HEIGHT < 256, "Coordinates must fit into 16-bit fixed-point");
+
+    static constexpr int FractionBits = 6;                                   // Fixed-point coordinates and velocities in 1/64 pixel
+    static constexpr int32_t One = 1 << FractionBits;
+    static constexpr int32_t Gravity = 2 * static_cast<int32_t>(HEIGHT) * One; // Falls panel height in 1s, in 1/64 pixel / s^2
+    static constexpr float MaxDt = 0.1F;                                     // Larger frame times are clamped, e.g. after a stall
+    static constexpr float SparkRate = 150.0F;                               // Sparks / s per band at full level
+    static constexpr float SparkThreshold = 0.3F;                            // Minimum band level to spawn sparks
+    static constexpr float FountainRate = 2000.0F;                           // Fountain particles / s at full bass level
+    static constexpr unsigned BeatBurst = 300;                               // Particles per beat
+    static constexpr unsigned FadeMs = 400;                                  // Particles fade out during their last FadeMs
+    static constexpr unsigned NrOfBassBands = NR_OF_BANDS / 8 > 0 ? NR_OF_BANDS / 8 : 1;
+
+  public:
+    /// @brief Create particle effect
+    /// @p palette Particle colors. Bands are spread over the whole palette
+    Particles(const Palette &palette = Palettes::rainbow())
+        : m_palette(&palette)
+    {
+    }
+
+    /// @brief Number of live particles
+    auto size() const -> unsigned
+    {
+      return m_count;
+    }
+
+    /// @brief Number of particles not spawned so far because the pool was full
+    auto dropped() const -> uint32_t
+    {
+      return m_dropped;
+    }
+
+    virtual auto prepare(float dt, const AnalysisFrame &frame) -> void override
+    {
+      dt = dt > MaxDt ? MaxDt : dt;
+      move(dt);
+      spawnSparks(dt, frame);
+      spawnFountain(dt, frame);
+      if (frame.isBeat && !m_wasBeat)
+      {
+        spawnBurst();
+      }
+      m_wasBeat = frame.isBeat;
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      constexpr float FadeScale = 1.0F / FadeMs;
+      for (unsigned i = 0; i < m_count; i++)
+      {
+        const int y = m_y[i] >> FractionBits;
+        if (y < strip.firstRow || y >= strip.endRow)
+        {
+          continue;
+        }
+        const float brightness = m_life[i] >= FadeMs ? 1.0F : m_life[i] * FadeScale;
+        const auto color = m_palette->at(m_color[i], brightness);
+        auto &dest = strip.destRow(y)[m_x[i] >> FractionBits];
+        dest.r = clamp(dest.r + color.r, 0.0F, 1.0F);
+        dest.g = clamp(dest.g + color.g, 0.0F, 1.0F);
+        dest.b = clamp(dest.b + color.b, 0.0F, 1.0F);
+      }
+    }
+
+  private:
+    // Move particles, apply gravity and remove dead or fallen particles
+    void move(float dt)
+    {
+      const int32_t dtQ16 = static_cast<int32_t>(dt * 65536.0F);
+      const int32_t gravityStep = (Gravity * dtQ16) >> 16;
+      const uint16_t dtMs = static_cast<uint16_t>(dt * 1000.0F + 0.5F);
+      unsigned i = 0;
+      while (i < m_count)
+      {
+        const int32_t x = m_x[i] + ((m_vx[i] * dtQ16) >> 16);
+        const int32_t y = m_y[i] + ((m_vy[i] * dtQ16) >> 16);
+        if (m_life[i] <= dtMs || x < 0 || x >= static_cast<int32_t>(WIDTH) * One || y < -static_cast<int32_t>(HEIGHT) * One || y >= static_cast<int32_t>(HEIGHT) * One)
+        {
+          remove(i);
+          continue;
+        }
+        m_x[i] = static_cast<int16_t>(x);
+        m_y[i] = static_cast<int16_t>(y);
+        const int32_t vy = m_vy[i] + gravityStep;
+        m_vy[i] = static_cast<int16_t>(vy > INT16_MAX ? INT16_MAX : vy);
+        m_life[i] -= dtMs;
+        i++;
+      }
+    }
+
+    // Sparks from the top of bands that are at their peak, like bars drawn by DrawSpectrum
+    void spawnSparks(float dt, const AnalysisFrame &frame)
+    {
+      for (unsigned band = 0; band < NR_OF_BANDS; band++)
+      {
+        const float level = frame.levels[band];
+        if (level < SparkThreshold || level < frame.peaks[band] - 0.02F)
+        {
+          m_sparkCredit[band] = 0.0F;
+          continue;
+        }
+        m_sparkCredit[band] += SparkRate * level * dt;
+        const int32_t x = static_cast<int32_t>(((2 * band + 1) * WIDTH * One) / (2 * NR_OF_BANDS));
+        const int32_t y = static_cast<int32_t>((HEIGHT / 2 - 0.5F * (HEIGHT - 1) * level) * One);
+        const uint8_t color = static_cast<uint8_t>((band * (Palette::SIZE - 1)) / (NR_OF_BANDS > 1 ? NR_OF_BANDS - 1 : 1));
+        for (; m_sparkCredit[band] >= 1.0F; m_sparkCredit[band] -= 1.0F)
+        {
+          spawn(x + randomRange(-One / 2, One / 2), y, randomRange(-8 * One, 8 * One), randomRange(-static_cast<int32_t>(HEIGHT) * One, -static_cast<int32_t>(HEIGHT) * One / 4), randomRange(500, 1000), color);
+        }
+      }
+    }
+
+    // Fountain from bottom center with bass energy
+    void spawnFountain(float dt, const AnalysisFrame &frame)
+    {
+      float bass = 0.0F;
+      for (unsigned band = 0; band < NrOfBassBands; band++)
+      {
+        bass += frame.levels[band];
+      }
+      bass /= NrOfBassBands;
+      m_fountainCredit += FountainRate * bass * bass * dt;
+      // launch speed to reach 50-100% of the panel height
+      const int32_t maxSpeed = static_cast<int32_t>(std::sqrt(2.0F * Gravity * HEIGHT * One));
+      for (; m_fountainCredit >= 1.0F; m_fountainCredit -= 1.0F)
+      {
+        spawn(static_cast<int32_t>(WIDTH * One / 2) + randomRange(-One, One), static_cast<int32_t>(HEIGHT - 1) * One, randomRange(-static_cast<int32_t>(WIDTH) * One / 4, static_cast<int32_t>(WIDTH) * One / 4), -randomRange(maxSpeed * 7 / 10, maxSpeed), randomRange(1500, 2500), static_cast<uint8_t>(randomRange(0, 32)));
+      }
+    }
+
+    // Explosion from center
+    void spawnBurst()
+    {
+      const int32_t speed = static_cast<int32_t>(HEIGHT) * One;
+      const uint8_t color = static_cast<uint8_t>(randomRange(0, 255));
+      for (unsigned i = 0; i < BeatBurst; i++)
+      {
+        spawn(static_cast<int32_t>(WIDTH * One / 2), static_cast<int32_t>(HEIGHT * One / 2), randomRange(-speed, speed), randomRange(-speed, speed), randomRange(400, 1200), static_cast<uint8_t>(color + randomRange(0, 32)));
+      }
+    }
+
+    // Add particle. Does nothing if the pool is full
+    void spawn(int32_t x, int32_t y, int32_t vx, int32_t vy, int32_t lifeMs, uint8_t color)
+    {
+      if (m_count >= CAPACITY)
+      {
+        m_dropped++;
+        return;
+      }
+      m_x[m_count] = static_cast<int16_t>(x);
+      m_y[m_count] = static_cast<int16_t>(y);
+      m_vx[m_count] = static_cast<int16_t>(vx);
+      m_vy[m_count] = static_cast<int16_t>(vy);
+      m_life[m_count] = static_cast<uint16_t>(lifeMs);
+      m_color[m_count] = color;
+      m_count++;
+    }
+
+    // Remove particle by moving the last one into its slot
+    void remove(unsigned i)
+    {
+      m_count--;
+      m_x[i] = m_x[m_count];
+      m_y[i] = m_y[m_count];
+      m_vx[i] = m_vx[m_count];
+      m_vy[i] = m_vy[m_count];
+      m_life[i] = m_life[m_count];
+      m_color[i] = m_color[m_count];
+    }
+
+    // Random integer in [minimum, maximum] from xorshift32
+    auto randomRange(int32_t minimum, int32_t maximum) -> int32_t
+    {
+      m_random ^= m_random << 13;
+      m_random ^= m_random >> 17;
+      m_random ^= m_random << 5;
+      return minimum + static_cast<int32_t>(m_random % static_cast<uint32_t>(maximum - minimum + 1));
+    }
+
+    const Palette *m_palette = nullptr;
+    int16_t m_x[CAPACITY];
+    int16_t m_y[CAPACITY];
+    int16_t m_vx[CAPACITY];
+    int16_t m_vy[CAPACITY];
+    uint16_t m_life[CAPACITY]; // Remaining life in ms
+    uint8_t m_color[CAPACITY]; // Palette index
+    unsigned m_count = 0;
+    uint32_t m_dropped = 0;
+    float m_sparkCredit[NR_OF_BANDS] = {0};
+    float m_fountainCredit = 0.0F;
+    uint32_t m_random = 2463534242;
+    bool m_wasBeat = false;
+  };
+
+}
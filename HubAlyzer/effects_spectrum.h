@@ -2,6 +2,8 @@
 
 #include "color.h"
 #include "effect.h"
+#include "palette.h"
+#include "raster.h"
 
 #include <cmath>
 
@@ -11,6 +13,8 @@ namespace Effects
   template <unsigned WIDTH, unsigned HEIGHT, unsigned NR_OF_BANDS>
   class DrawSpectrum : public Effect
   {
+    static_assert(NR_OF_BANDS <= AnalysisFrame::MAX_BANDS, "Too many bands for AnalysisFrame");
+
   public:
     enum class Mode {BandsCentered, RaysCentered};
 
@@ -20,6 +24,7 @@ namespace Effects
     static constexpr int MaxX = Width - 1;
     static constexpr int MaxY = Height - 1;
     static constexpr int NrOfBands = static_cast<int>(NR_OF_BANDS);
+    static constexpr float RotationSpeed = 0.5F; // Ray rotation in radians / s
 
     struct Point
     {
@@ -27,31 +32,26 @@ namespace Effects
       float y;
     };
 
-    // Convert polar coordinates (radius, angle) to cartesian (x, y)
-    Point polarToCartesian(float radius, float angle)
+    // Set pixel if row y is part of strip
+    template <typename STRIP>
+    static void setPixel(const STRIP &strip, int x, int y, const RGBf &color)
     {
-      // auto sincos = sincosf_fast(radius_angle.second);
-      // return std::make_pair(radius_angle.first * sincos.second, radius_angle.first * sincos.first);
-      return {radius * cosf(angle), radius * sinf(angle)};
-    }
-
-    void displayLine(RGBf *dest, int band, int y, rgb24 color)
-    {
-      int xStart = band * (Width / NrOfBands);
-      int index = y * WIDTH + xStart;
-      for (int x = 0; x < Width / NrOfBands; x++)
+      if (y >= strip.firstRow && y < strip.endRow)
       {
-        dest[index + x] = color;
+        storePixel(strip.destRow(y)[x], color);
       }
     }
 
-    void displayBand(RGBf *dest, int band, float value, float peak, int y0, float scaleFactor, bool invert)
+    // Draw band into a float Strip or a ScreenStrip
+    template <typename STRIP>
+    void displayBand(const STRIP &strip, int band, float value, float peak, int y0, float scaleFactor, bool invert)
     {
       int x = band * (Width / NrOfBands);
       x = x < 0 ? 0 : x;
       x = x > MaxX ? MaxX : x;
-      // color hue based on band
-      auto color = RGBf(HSVf((float)band / (NrOfBands - 1), 1.0F, 1.0F));
+      // color based on band
+      const uint8_t colorIndex = m_bandIndices[band] + m_paletteOffset;
+      const auto &color = (*m_palette)[colorIndex];
       // draw bar until last pixel
       float barHeightf = MaxY * value * scaleFactor;
       int barHeight = trunc(barHeightf);
@@ -59,110 +59,414 @@ namespace Effects
       {
         // draw top-down
         auto yMin = (y0 - barHeight) < 0 ? 0 : (y0 - barHeight);
-        for (int y = y0; y > yMin; y--)
+        const int yStart = y0 < strip.endRow - 1 ? y0 : strip.endRow - 1;
+        const int yStop = yMin > strip.firstRow - 1 ? yMin : strip.firstRow - 1;
+        for (int y = yStart; y > yStop; y--)
         {
-          dest[y * WIDTH + x] = color;
+          storePixel(strip.destRow(y)[x], color);
         }
         // draw final pixel
         if (yMin > 0)
         {
           float barRest = barHeightf - barHeight;
-          auto restColor = RGBf(HSVf((float)band / (NrOfBands - 1), 1.0F, barRest));
-          dest[yMin * WIDTH + x] = restColor;
+          setPixel(strip, x, yMin, m_palette->at(colorIndex, barRest));
         }
       }
       else
       {
         // draw bottom-up
         auto yMax = (y0 + barHeight) > MaxY ? MaxY : (y0 + barHeight);
-        for (int y = y0; y < yMax; y++)
+        const int yStart = y0 > strip.firstRow ? y0 : strip.firstRow;
+        const int yStop = yMax < strip.endRow ? yMax : strip.endRow;
+        for (int y = yStart; y < yStop; y++)
         {
-          dest[y * WIDTH + x] = color;
+          storePixel(strip.destRow(y)[x], color);
         }
         // draw final pixel
         if (yMax < MaxY)
         {
           float barRest = barHeightf - barHeight;
-          auto restColor = RGBf(HSVf((float)band / (NrOfBands - 1), 1.0F, barRest));
-          dest[yMax * WIDTH + x] = restColor;
+          setPixel(strip, x, yMax, m_palette->at(colorIndex, barRest));
         }
       }
       // draw peak
       if (peak > (0.5f / Height))
       {
-        auto peakColor = RGBf(HSVf((float)band / (NrOfBands - 1), 0.4F, 0.2F));
+        auto peakColor = peakColorFor(color);
         int peakY = MaxY * peak * scaleFactor;
         if (invert)
         {
           auto peakMin = (y0 - peakY) < 0 ? 0 : (y0 - peakY);
-          dest[peakMin * WIDTH + x] = peakColor;
+          setPixel(strip, x, peakMin, peakColor);
         }
         else
         {
           auto peakMax = (y0 + peakY) > MaxY ? MaxY : (y0 + peakY);
-          dest[peakMax * WIDTH + x] = peakColor;
+          setPixel(strip, x, peakMax, peakColor);
         }
       }
     }
 
-    void spectrumCentered(RGBf *dest, const float *levels, const float *peaks, bool isBeat)
+    template <typename STRIP>
+    void spectrumCentered(const STRIP &strip, const AnalysisFrame &frame)
     {
       for (int i = 0; i < NrOfBands; i++)
       {
-        displayBand(dest, i, levels[i], peaks[i], Height / 2, 0.5f, true);
-        displayBand(dest, i, levels[i], peaks[i], Height / 2, 0.5f, false);
+        displayBand(strip, i, frame.levels[i], frame.peaks[i], Height / 2, 0.5f, true);
+        displayBand(strip, i, frame.levels[i], frame.peaks[i], Height / 2, 0.5f, false);
       }
-      /*if (isBeat)
+      /*if (frame.isBeat)
       {
         dest[0] = RGBf{1.0F, 1.0F, 1.0F};
       }*/
     }
 
-    void spectrumRays(RGBf *dest, const float *levels, const float *peaks, float angle)
+    // Rotate band directions once per frame instead of calculating sin / cos per band
+    void rotateDirections(float angle)
+    {
+      const float ca = std::cos(angle);
+      const float sa = std::sin(angle);
+      for (int i = 0; i <= NrOfBands; i++)
+      {
+        m_rotatedDirections[i] = {ca * m_directions[i].x - sa * m_directions[i].y, sa * m_directions[i].x + ca * m_directions[i].y};
+      }
+    }
+
+    void spectrumRays(const Strip &strip, const AnalysisFrame &frame)
     {
+      const Raster::Canvas canvas = {strip.destRow(strip.firstRow), Width, strip.firstRow, strip.endRow};
       const Point center = {Width / 2, Height / 2};
-      constexpr float angleDelta = 2.0F * M_PI / NrOfBands;
       for (int i = 0; i < NrOfBands; i++)
       {
-        float angle0 = angle + static_cast<float>(i) * angleDelta;
-        float angle1 = angle0 + angleDelta;
-        float levelRadius = 1.5f * Height * levels[i];
-        float peakRadius = 1.5f * Height * peaks[i];
+        const auto &d0 = m_rotatedDirections[i];
+        const auto &d1 = m_rotatedDirections[i + 1];
+        float levelRadius = 1.5f * Height * frame.levels[i];
+        float peakRadius = 1.5f * Height * frame.peaks[i];
+        const auto &color = (*m_palette)[static_cast<uint8_t>(m_bandIndices[i] + m_paletteOffset)];
         if (levelRadius > 0.5f)
         {
-          auto color = RGBf(HSVf((float)i / (NrOfBands - 1), 1.0F, 1.0F));
-          auto p1 = polarToCartesian(levelRadius, angle0);
-          auto p2 = polarToCartesian(levelRadius, angle1);
-          //fillTriangle(center.x, center.y, center.x + p1.x, center.y + p1.y, center.x + p2.x, center.y + p2.y, color);
+          Raster::fillTriangle(canvas, center.x, center.y, center.x + levelRadius * d0.x, center.y + levelRadius * d0.y, center.x + levelRadius * d1.x, center.y + levelRadius * d1.y, color);
         }
         if (peakRadius > 0.5f)
         {
-          auto color = RGBf(HSVf((float)i / (NrOfBands - 1), 0.4F, 0.2F));
-          auto p1 = polarToCartesian(peakRadius, angle0);
-          auto p2 = polarToCartesian(peakRadius, angle1);
-          //drawLine(center.x + p1.x, center.y + p1.y, center.x + p2.x, center.y + p2.y, color);
+          Raster::drawLine(canvas, center.x + peakRadius * d0.x, center.y + peakRadius * d0.y, center.x + peakRadius * d1.x, center.y + peakRadius * d1.y, peakColorFor(color));
         }
       }
     }
 
+    // Dim, desaturated version of color for peaks. Same as HSV saturation 0.4, value 0.2
+    static RGBf peakColorFor(const RGBf &color)
+    {
+      auto peakColor = lerp(RGBf(1.0F, 1.0F, 1.0F), color, 0.4F);
+      return RGBf(0.2F * peakColor.r, 0.2F * peakColor.g, 0.2F * peakColor.b);
+    }
+
   public:
-    virtual auto render(RGBf *dest, [[maybe_unused]] const RGBf *src, const float *levels, const float *peaks, bool isBeat) -> void override
+    /// @brief Create spectrum effect
+    /// @p mode How to draw bands
+    /// @p palette Band colors. Bands are spread over the whole palette
+    /// @p paletteSpeed Palette rotation in entries / s
+    DrawSpectrum(Mode mode = Mode::BandsCentered, const Palette &palette = Palettes::rainbow(), float paletteSpeed = 0)
+        : m_mode(mode), m_palette(&palette), m_paletteSpeed(paletteSpeed)
+    {
+      // band directions and colors for rays
+      constexpr float angleDelta = 2.0F * M_PI / NrOfBands;
+      for (int i = 0; i <= NrOfBands; i++)
+      {
+        m_directions[i] = {std::cos(i * angleDelta), std::sin(i * angleDelta)};
+      }
+      for (int i = 0; i < NrOfBands; i++)
+      {
+        m_bandIndices[i] = static_cast<uint8_t>((i * (Palette::SIZE - 1)) / (NrOfBands > 1 ? NrOfBands - 1 : 1));
+      }
+    }
+
+    virtual auto prepare(float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      if (m_mode == Mode::RaysCentered)
+      {
+        rotateDirections(m_angle);
+        m_angle = std::fmod(m_angle + (m_rotate ? RotationSpeed * dt : 0), 2.0F * static_cast<float>(M_PI));
+      }
+      m_palettePosition = std::fmod(m_palettePosition + m_paletteSpeed * dt, static_cast<float>(Palette::SIZE));
+      m_paletteOffset = static_cast<uint8_t>(m_palettePosition);
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, const AnalysisFrame &frame) -> void override
     {
       switch (m_mode)
       {
       case Mode::RaysCentered:
-        spectrumRays(dest, levels, peaks, m_angle);
-        m_angle += m_rotate ? 0.01F : 0;
+        spectrumRays(strip, frame);
         break;
       default:
-        spectrumCentered(dest, levels, peaks, isBeat);
+        spectrumCentered(strip, frame);
       }
     }
 
+    // Rays are blended additively, so only bands can be rendered to the screen
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return m_mode == Mode::BandsCentered;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, const AnalysisFrame &frame) -> void override
+    {
+      spectrumCentered(strip, frame);
+    }
+
   private:
     Mode m_mode = Mode::BandsCentered;
+    Point m_directions[NR_OF_BANDS + 1];
+    Point m_rotatedDirections[NR_OF_BANDS + 1];
+    const Palette *m_palette = nullptr;
+    uint8_t m_bandIndices[NR_OF_BANDS];
+    uint8_t m_paletteOffset = 0;
+    float m_palettePosition = 0.0F;
+    float m_paletteSpeed = 0.0F;
     float m_angle = 0.0F;
     bool m_rotate = true;
   };
 
+  // Scrolling spectrogram / waterfall. Keeps a circular buffer of band rows stored as palette indices.
+  // One new row is written per analysis frame and the output is read with a rotating row offset,
+  // so nothing is moved in memory when scrolling. The history scrolls at the analysis rate, independent of the frame rate.
+  // Levels are normalized dB values, so palette indices are proportional to log magnitude.
+  // DEPTH = Number of band rows kept. Independent of the panel size. History is sampled to fit the panel
+  template <unsigned WIDTH, unsigned HEIGHT, unsigned NR_OF_BANDS, unsigned DEPTH = HEIGHT>
+  class Spectrogram : public Effect
+  {
+    static_assert(NR_OF_BANDS <= AnalysisFrame::MAX_BANDS, "Too many bands for AnalysisFrame");
+
+  public:
+    enum class Scroll
+    {
+      Down, // Bands from left to right, newest row at the top
+      Right // Bands from bottom to top, newest column on the left
+    };
+
+    /// @brief Create spectrogram effect
+    /// @p scroll Direction history moves in
+    /// @p palette Colors from silence (index 0) to maximum level (index 255)
+    Spectrogram(Scroll scroll = Scroll::Down, const Palette &palette = Palettes::fire())
+        : m_scroll(scroll), m_palette(&palette)
+    {
+      // map panel columns / rows to bands and history ages once
+      const unsigned bandAxis = scroll == Scroll::Down ? WIDTH : HEIGHT;
+      const unsigned timeAxis = scroll == Scroll::Down ? HEIGHT : WIDTH;
+      for (unsigned i = 0; i < bandAxis; i++)
+      {
+        const unsigned band = (i * NR_OF_BANDS) / bandAxis;
+        m_bands[i] = static_cast<uint8_t>(scroll == Scroll::Down ? band : NR_OF_BANDS - 1 - band);
+      }
+      for (unsigned i = 0; i < timeAxis; i++)
+      {
+        m_ages[i] = static_cast<uint16_t>((i * DEPTH) / timeAxis);
+      }
+    }
+
+    virtual auto prepare([[maybe_unused]] float dt, const AnalysisFrame &frame) -> void override
+    {
+      // render frames between analysis frames repeat the sequence. Frames dropped by the analysis are not filled in
+      if (!m_hasRows || frame.sequence != m_lastSequence)
+      {
+        m_hasRows = true;
+        m_lastSequence = frame.sequence;
+        addRow(frame.levels);
+      }
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip);
+    }
+
+  private:
+    // Store levels as palette indices in the next history row, overwriting the oldest one
+    void addRow(const float *levels)
+    {
+      m_newest = m_newest + 1 < DEPTH ? m_newest + 1 : 0;
+      auto row = m_history[m_newest];
+      for (unsigned band = 0; band < NR_OF_BANDS; band++)
+      {
+        const float level = levels[band] < 0.0F ? 0.0F : (levels[band] > 1.0F ? 1.0F : levels[band]);
+        row[band] = static_cast<uint8_t>(level * (Palette::SIZE - 1));
+      }
+    }
+
+    // History row of age. Age 0 is the newest row
+    auto historyRow(unsigned age) const -> const uint8_t *
+    {
+      return m_history[m_newest >= age ? m_newest - age : m_newest + DEPTH - age];
+    }
+
+    template <typename STRIP>
+    void renderRows(const STRIP &strip) const
+    {
+      for (int y = strip.firstRow; y < strip.endRow; y++)
+      {
+        auto dest = strip.destRow(y);
+        if (m_scroll == Scroll::Down)
+        {
+          // one history row per panel row
+          const auto row = historyRow(m_ages[y]);
+          for (unsigned x = 0; x < WIDTH; x++)
+          {
+            storePixel(dest[x], (*m_palette)[row[m_bands[x]]]);
+          }
+        }
+        else
+        {
+          // one band per panel row
+          const unsigned band = m_bands[y];
+          for (unsigned x = 0; x < WIDTH; x++)
+          {
+            storePixel(dest[x], (*m_palette)[historyRow(m_ages[x])[band]]);
+          }
+        }
+      }
+    }
+
+    Scroll m_scroll = Scroll::Down;
+    const Palette *m_palette = nullptr;
+    uint32_t m_lastSequence = 0; // Sequence of the analysis frame of the newest row
+    bool m_hasRows = false;      // False until the first row was added, so the first frame is added even with sequence 0
+    uint8_t m_history[DEPTH][NR_OF_BANDS] = {{0}};
+    unsigned m_newest = 0;
+    uint8_t m_bands[WIDTH > HEIGHT ? WIDTH : HEIGHT];
+    uint16_t m_ages[WIDTH > HEIGHT ? WIDTH : HEIGHT];
+  };
+
+
+  // Stereo spectrum from the per-channel levels of the analysis frame. One band per row group, low bands at the bottom.
+  // Mono frames have equal channel levels, so the display stays centered
+  template <unsigned WIDTH, unsigned HEIGHT, unsigned NR_OF_BANDS>
+  class StereoSpectrum : public Effect
+  {
+    static_assert(NR_OF_BANDS <= AnalysisFrame::MAX_BANDS, "Too many bands for AnalysisFrame");
+
+  public:
+    enum class Mode
+    {
+      Split,  // Left channel bars grow to the left from the center, right channel bars grow to the right
+      Balance // One dot per band at its left / right balance. Brightness follows the band level
+    };
+
+    /// @brief Create stereo spectrum effect
+    /// @p mode Display mode
+    /// @p palette Band colors. Bands are spread over the whole palette
+    StereoSpectrum(Mode mode = Mode::Split, const Palette &palette = Palettes::rainbow())
+        : m_mode(mode), m_palette(&palette)
+    {
+      // map panel rows to bands once
+      for (unsigned y = 0; y < HEIGHT; y++)
+      {
+        const unsigned band = NR_OF_BANDS - 1 - (y * NR_OF_BANDS) / HEIGHT;
+        m_bands[y] = static_cast<uint8_t>(band);
+        m_colorIndices[y] = static_cast<uint8_t>((band * (Palette::SIZE - 1)) / (NR_OF_BANDS > 1 ? NR_OF_BANDS - 1 : 1));
+      }
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip, frame);
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, const AnalysisFrame &frame) -> void override
+    {
+      renderRows(strip, frame);
+    }
+
+  private:
+    static constexpr int HalfWidth = static_cast<int>(WIDTH / 2);
+
+    static auto clamp01(float value) -> float
+    {
+      return value < 0.0F ? 0.0F : (value > 1.0F ? 1.0F : value);
+    }
+
+    // Draw bar of level from the center. Direction -1 grows to the left, 1 to the right
+    template <typename PIXEL>
+    void drawBar(PIXEL *dest, float level, int direction, uint8_t colorIndex) const
+    {
+      const float length = clamp01(level) * HalfWidth;
+      const int fullPixels = static_cast<int>(length);
+      const auto &color = (*m_palette)[colorIndex];
+      // the left bar starts at the last pixel left of the center
+      const int x0 = direction < 0 ? HalfWidth - 1 : HalfWidth;
+      for (int i = 0; i < fullPixels; i++)
+      {
+        storePixel(dest[x0 + direction * i], color);
+      }
+      if (fullPixels < HalfWidth)
+      {
+        storePixel(dest[x0 + direction * fullPixels], m_palette->at(colorIndex, length - fullPixels));
+      }
+    }
+
+    template <typename STRIP>
+    void renderRows(const STRIP &strip, const AnalysisFrame &frame) const
+    {
+      for (int y = strip.firstRow; y < strip.endRow; y++)
+      {
+        auto dest = strip.destRow(y);
+        const unsigned band = m_bands[y];
+        const float left = frame.leftLevels[band];
+        const float right = frame.rightLevels[band];
+        if (m_mode == Mode::Split)
+        {
+          drawBar(dest, left, -1, m_colorIndices[y]);
+          drawBar(dest, right, 1, m_colorIndices[y]);
+        }
+        else
+        {
+          const float sum = left + right;
+          if (sum > 0.0F)
+          {
+            // balance in [-1,1], -1 is left only, 1 is right only
+            const float balance = (right - left) / sum;
+            int x = static_cast<int>((balance + 1.0F) * 0.5F * WIDTH);
+            x = x > static_cast<int>(WIDTH) - 1 ? static_cast<int>(WIDTH) - 1 : x;
+            storePixel(dest[x], m_palette->at(m_colorIndices[y], clamp01(0.5F * sum)));
+          }
+        }
+      }
+    }
+
+    Mode m_mode = Mode::Split;
+    const Palette *m_palette = nullptr;
+    uint8_t m_bands[HEIGHT];        // Band of panel row
+    uint8_t m_colorIndices[HEIGHT]; // Palette index of panel row
+  };
+
 }
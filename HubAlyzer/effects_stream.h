@@ -0,0 +1,69 @@
+#pragma once
+
+#include "color.h"
+#include "effect.h"
+#include "frame_exchange.h"
+
+#include <cstring>
+
+namespace Effects
+{
+
+  // 8-bit RGB frame received from the network, e.g. by a PixelStreamReceiver
+  template <int WIDTH, int HEIGHT>
+  struct PixelFrame
+  {
+    RGB8 pixels[WIDTH * HEIGHT] = {};
+  };
+
+  // Draws the latest pixel frame received from the network, e.g. from a lighting desk or a PC visualizer.
+  // Use it as the first effect of a chain, so local effects are composited on top of the stream.
+  // Frames are picked up from a FrameExchange once per frame, so the receiving task never waits for rendering
+  template <int WIDTH, int HEIGHT>
+  class PixelStream : public Effect
+  {
+  public:
+    using Frames = FrameExchange<PixelFrame<WIDTH, HEIGHT>>;
+
+    /// @brief Create stream layer
+    /// @p frames Frames published by the receiving task. This effect is their only reader
+    PixelStream(Frames &frames)
+      : m_frames(frames)
+    {}
+
+    virtual auto prepare([[maybe_unused]] float dt, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      m_frames.update();
+    }
+
+    virtual auto isRowParallel() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto render(const Strip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      constexpr float Scale = 1.0F / 255.0F;
+      const auto src = m_frames.readFrame().pixels + strip.firstRow * WIDTH;
+      auto dest = strip.destRow(strip.firstRow);
+      for (int i = 0; i < (strip.endRow - strip.firstRow) * WIDTH; i++)
+      {
+        dest[i] = RGBf(src[i].r * Scale, src[i].g * Scale, src[i].b * Scale);
+      }
+    }
+
+    virtual auto canRenderToScreen() const -> bool override
+    {
+      return true;
+    }
+
+    virtual auto renderToScreen(const ScreenStrip &strip, [[maybe_unused]] const AnalysisFrame &frame) -> void override
+    {
+      memcpy(strip.destRow(strip.firstRow), m_frames.readFrame().pixels + strip.firstRow * WIDTH, (strip.endRow - strip.firstRow) * WIDTH * sizeof(RGB8));
+    }
+
+  private:
+    Frames &m_frames;
+  };
+
+}
@@ -1,47 +1,63 @@
 #pragma once
 
-#define FFT_SPEED_OVER_PRECISION
-#define FFT_SQRT_APPROXIMATION
-#include "arduinoFFT.h" // Arduino FFT library
+#ifdef ARDUINO
+#include "fft_backend_arduino.h"
+#endif
+#include "fft_backend_q15.h"
+#include "fft_backend_reference.h"
+#if __has_include("esp_dsp.h")
+#include "fft_backend_espdsp.h"
+#endif
 
-#include <cmath>
-#include <functional>
+#include <utility>
+
+// ArduinoFFT is the default backend. Host builds have no ArduinoFFT and use the reference backend
+#ifdef ARDUINO
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ>
+using FFTBackendDefault = FFTBackendArduino<SAMPLE_COUNT, SAMPLE_RATE_HZ>;
+#else
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ>
+using FFTBackendDefault = FFTBackendReference<SAMPLE_COUNT, SAMPLE_RATE_HZ>;
+#endif
 
 // FFT transform wrapper
-// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two. This will again allocate the amount of 4-byte float values
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two
 // SAMPLE_RATE = Audio sample rate in Hz
-template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+// BACKEND = FFT implementation to use:
+//   FFTBackendArduino - ArduinoFFT library. Only available in Arduino builds
+//   FFTBackendEspDsp - Espressif esp-dsp library with assembly optimized FFTs. Only available on device
+//   FFTBackendReference - Portable radix-2 implementation that works anywhere, e.g. for host builds
+//   FFTBackendQ15 - Block-floating-point integer implementation for CPUs without FPU. Takes int32_t samples and returns log2 magnitudes
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000, template <unsigned, unsigned> class BACKEND = FFTBackendDefault>
 class FFT
 {
+    using Backend = BACKEND<SAMPLE_COUNT, SAMPLE_RATE_HZ>;
+
 public:
+    using Sample = typename Backend::Sample; // Sample value type, float or int32_t
+
     /// @brief Construct a new FFT transform
-    /// @p amplitudes Amplitude values for individual frequency bands from the FFT. This MUST be allocated from the outside!
-    FFT(float (*samples)[SAMPLE_COUNT])
-        : m_real(reinterpret_cast<float *>(samples)), m_fft(ArduinoFFT<float>(m_real, m_imag, SAMPLE_COUNT, SAMPLE_RATE_HZ, m_weighingFactors))
+    /// @p samples Sample values to transform. Will be overwritten with amplitudes. This MUST be allocated from the outside!
+    FFT(Sample (*samples)[SAMPLE_COUNT])
+        : m_backend(reinterpret_cast<Sample *>(samples))
     {
     }
 
     /// @brief Call to update FFT data from samples
-    /// @return Returns SAMPLE_COUNT amplitude values
-    float *calculate()
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values
+    Sample *calculate()
+    {
+        return m_backend.calculate();
+    }
+
+    /// @brief Call to update FFT data of two channels with one complex FFT. Only FFTBackendReference and FFTBackendEspDsp support this
+    /// @p right Right channel samples. The left channel are the samples passed to the constructor. Will be overwritten with amplitudes
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values for the left and right channel
+    std::pair<Sample *, Sample *> calculateStereo(Sample *right)
     {
-        // apply windowing and FFT
-        memset(m_imag, 0, sizeof(m_imag));
-        // m_fft.windowing(FFTWindow::Hamming, FFTDirection::Forward);
-        m_fft.windowing(FFTWindow::Blackman_Harris, FFTDirection::Forward);
-        m_fft.compute(FFTDirection::Forward);
-        // kill the DC part in bin 0
-        // m_real[0] = 0;
-        // m_imag[0] = 0;
-        // m_fft.dcRemoval();
-        // calculate magnitude values from real + imaginary values
-        m_fft.complexToMagnitude();
-        return m_real;
+        return m_backend.calculateStereo(right);
     }
 
 private:
-    float m_weighingFactors[SAMPLE_COUNT] = {0};
-    float *m_real = nullptr;
-    float m_imag[SAMPLE_COUNT] = {0};
-    ArduinoFFT<float> m_fft;
+    Backend m_backend;
 };
@@ -0,0 +1,57 @@
+#pragma once
+
+// ArduinoFFT trades precision for speed by default. Define FFT_ARDUINO_PRECISE before including this to compare
+// the exact version, e.g. with AnalysisCheck
+#ifndef FFT_ARDUINO_PRECISE
+#define FFT_SPEED_OVER_PRECISION
+#define FFT_SQRT_APPROXIMATION
+#endif
+#include "arduinoFFT.h" // Arduino FFT library
+#include "lookup_tables.h"
+
+#include <cstring>
+
+// FFT backend using the ArduinoFFT library
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two. This will again allocate the amount of 4-byte float values
+// SAMPLE_RATE = Audio sample rate in Hz
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+class FFTBackendArduino
+{
+public:
+    using Sample = float;
+
+    /// @brief Construct a new FFT backend
+    /// @p samples Sample values to transform. This MUST be allocated from the outside!
+    FFTBackendArduino(float *samples)
+        : m_real(samples), m_fft(ArduinoFFT<float>(m_real, m_imag, SAMPLE_COUNT, SAMPLE_RATE_HZ, nullptr))
+    {
+    }
+
+    /// @brief Window samples, transform them and convert the result to magnitudes in-place
+    /// @return Returns at least SAMPLE_COUNT / 2 amplitude values
+    float *calculate()
+    {
+        // apply windowing and FFT
+        memset(m_imag, 0, sizeof(m_imag));
+        // m_fft.windowing(FFTWindow::Hamming, FFTDirection::Forward);
+        // Blackman-Harris window from flash instead of m_fft.windowing(), which computes its weighing factors at runtime
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            m_real[i] *= Window[i];
+        }
+        m_fft.compute(FFTDirection::Forward);
+        // kill the DC part in bin 0
+        // m_real[0] = 0;
+        // m_imag[0] = 0;
+        // m_fft.dcRemoval();
+        // calculate magnitude values from real + imaginary values
+        m_fft.complexToMagnitude();
+        return m_real;
+    }
+
+private:
+    static constexpr std::array<float, SAMPLE_COUNT> Window = LookupTables::blackmanHarrisWindow<SAMPLE_COUNT>();
+    float *m_real = nullptr;
+    float m_imag[SAMPLE_COUNT] = {0};
+    ArduinoFFT<float> m_fft;
+};
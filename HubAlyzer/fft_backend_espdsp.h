@@ -0,0 +1,108 @@
+#pragma once
+
+#include "esp_dsp.h" // Espressif DSP library
+#include "fft_backend_reference.h"
+#include "logging.h"
+#include "lookup_tables.h"
+
+#include <cmath>
+#include <memory>
+#include <utility>
+
+// FFT backend using the assembly optimized radix-2 FFT from Espressif's esp-dsp library.
+// If esp-dsp can not allocate its twiddle table, an error is logged and FFTBackendReference is used instead
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two
+// SAMPLE_RATE = Audio sample rate in Hz
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+class FFTBackendEspDsp
+{
+public:
+    using Sample = float;
+
+    /// @brief Construct a new FFT backend
+    /// @p samples Sample values to transform. This MUST be allocated from the outside!
+    FFTBackendEspDsp(float *samples)
+        : m_real(samples)
+    {
+    }
+
+    /// @brief Window samples, transform them and convert the result to magnitudes in-place
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values
+    float *calculate()
+    {
+        if (!initialized())
+        {
+            return fallback().calculate();
+        }
+        // window and interleave samples to complex values
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            m_data[2 * i] = m_real[i] * Window[i];
+            m_data[2 * i + 1] = 0.0F;
+        }
+        dsps_fft2r_fc32(m_data, SAMPLE_COUNT);
+        dsps_bit_rev_fc32(m_data, SAMPLE_COUNT);
+        for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+        {
+            m_real[i] = std::sqrt(m_data[2 * i] * m_data[2 * i] + m_data[2 * i + 1] * m_data[2 * i + 1]);
+        }
+        return m_real;
+    }
+
+    /// @brief Transform two channels with one complex FFT, left as real and right as imaginary part, and separate
+    /// the spectra afterwards. Costs about the same as calculate() for one channel
+    /// @p right Right channel samples. The left channel are the samples passed to the constructor. Will be overwritten with amplitudes
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values for the left and right channel
+    std::pair<float *, float *> calculateStereo(float *right)
+    {
+        if (!initialized())
+        {
+            return fallback().calculateStereo(right);
+        }
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            m_data[2 * i] = m_real[i] * Window[i];
+            m_data[2 * i + 1] = right[i] * Window[i];
+        }
+        dsps_fft2r_fc32(m_data, SAMPLE_COUNT);
+        dsps_bit_rev_fc32(m_data, SAMPLE_COUNT);
+        // Z = L + iR. L[k] = (Z[k] + conj(Z[N - k])) / 2, R[k] = (Z[k] - conj(Z[N - k])) / 2i
+        for (unsigned k = 0; k < SAMPLE_COUNT / 2; k++)
+        {
+            const unsigned n = (SAMPLE_COUNT - k) & (SAMPLE_COUNT - 1);
+            const float leftRe = m_data[2 * k] + m_data[2 * n];
+            const float leftIm = m_data[2 * k + 1] - m_data[2 * n + 1];
+            const float rightRe = m_data[2 * k + 1] + m_data[2 * n + 1];
+            const float rightIm = m_data[2 * n] - m_data[2 * k];
+            m_real[k] = 0.5F * std::sqrt(leftRe * leftRe + leftIm * leftIm);
+            right[k] = 0.5F * std::sqrt(rightRe * rightRe + rightIm * rightIm);
+        }
+        return {m_real, right};
+    }
+
+private:
+    using Fallback = FFTBackendReference<SAMPLE_COUNT, SAMPLE_RATE_HZ>;
+
+    // The twiddle table is shared by all transforms and allocated on first use. Returns false if that failed
+    static bool initialized()
+    {
+        static const esp_err_t result = dsps_fft2r_init_fc32(nullptr, SAMPLE_COUNT);
+        return result == ESP_OK;
+    }
+
+    // Portable backend working on the same samples. Created and logged once, when esp-dsp is first found to be unusable
+    Fallback &fallback()
+    {
+        if (!m_fallback)
+        {
+            Log::error("Failed to initialize esp-dsp FFT with %d samples. Using reference FFT\n", static_cast<int>(SAMPLE_COUNT));
+            m_fallback.reset(new Fallback(m_real));
+        }
+        return *m_fallback;
+    }
+
+    static constexpr std::array<float, SAMPLE_COUNT> Window = LookupTables::blackmanHarrisWindow<SAMPLE_COUNT>(); // Same as ArduinoFFT
+    float *m_real = nullptr;
+    float m_data[2 * SAMPLE_COUNT] __attribute__((aligned(16))) = {0}; // Interleaved complex values
+    std::unique_ptr<Fallback> m_fallback;
+};
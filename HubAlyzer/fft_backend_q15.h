@@ -0,0 +1,157 @@
+#pragma once
+
+#include "fixed_point.h"
+
+#include <cmath>
+#include <cstdint>
+
+// Block-floating-point Q15 FFT backend for the integer analysis path.
+// Data is kept as 16-bit values with one exponent for the whole block. Before every stage values are
+// scaled down just enough so the butterflies can not overflow. Instead of magnitudes this returns log2
+// of the magnitudes in Q16, which is all the following dB conversion needs and saves the square root.
+// Use Normalization<..., int32_t> to convert the result.
+// Magnitudes within 30dB of the loudest bin are within ~0.05dB of a floating-point FFT, 30dB to 60dB below it within ~3dB.
+// Results are bit-identical on every platform, see test/fixed_point_test.cpp
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two
+// SAMPLE_RATE = Audio sample rate in Hz
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+class FFTBackendQ15
+{
+    static_assert(SAMPLE_COUNT >= 4 && SAMPLE_COUNT <= 4096 && (SAMPLE_COUNT & (SAMPLE_COUNT - 1)) == 0, "Sample count must be a power-of-two <= 4096");
+
+    // A radix-2 butterfly can grow a component by at most 1 + sqrt(2), so values must stay below 32767 / 2.414
+    static constexpr int32_t MaxButterflyInput = 13573;
+
+public:
+    using Sample = int32_t;
+
+    /// @brief Construct a new FFT backend and precompute Q15 window and twiddle factors
+    /// @p samples Integer sample values to transform. This MUST be allocated from the outside!
+    FFTBackendQ15(int32_t *samples)
+        : m_samples(samples)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        // Blackman-Harris window, same as ArduinoFFT
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double r = 2.0 * Pi * i / (SAMPLE_COUNT - 1);
+            const double window = 0.35875 - 0.48829 * std::cos(r) + 0.14128 * std::cos(2.0 * r) - 0.01168 * std::cos(3.0 * r);
+            m_window[i] = toQ15(window);
+        }
+        for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+        {
+            m_cos[i] = toQ15(std::cos(2.0 * Pi * i / SAMPLE_COUNT));
+            m_sin[i] = toQ15(-std::sin(2.0 * Pi * i / SAMPLE_COUNT));
+        }
+        for (unsigned i = 0, j = 0; i < SAMPLE_COUNT; i++)
+        {
+            m_bitReversed[i] = j;
+            unsigned bit = SAMPLE_COUNT >> 1;
+            for (; j & bit; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+        }
+    }
+
+    /// @brief Window samples, transform them and convert the result to log2 magnitudes in-place
+    /// @return Returns SAMPLE_COUNT / 2 values of log2(magnitude) in Q16.
+    /// The magnitudes have the same scale as those of a floating-point FFT of the samples
+    int32_t *calculate()
+    {
+        // normalize block to 15 bits and remember exponent
+        uint32_t maxAbs = 0;
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const uint32_t a = m_samples[i] < 0 ? -static_cast<uint32_t>(m_samples[i]) : m_samples[i];
+            maxAbs = a > maxAbs ? a : maxAbs;
+        }
+        int32_t exponent = (31 - clz32(maxAbs | 1)) - 14;
+        // window and reorder input in bit-reversed order
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const auto j = m_bitReversed[i];
+            const int32_t value = exponent >= 0 ? roundShift(m_samples[j], exponent) : m_samples[j] << -exponent;
+            m_re[i] = mulQ15(static_cast<int16_t>(value > INT16_MAX ? INT16_MAX : value), m_window[j]);
+            m_im[i] = 0;
+        }
+        // radix-2 decimation-in-time stages with block scaling
+        for (unsigned size = 2; size <= SAMPLE_COUNT; size <<= 1)
+        {
+            exponent += scaleBlock();
+            const unsigned half = size >> 1;
+            const unsigned step = SAMPLE_COUNT / size;
+            for (unsigned start = 0; start < SAMPLE_COUNT; start += size)
+            {
+                for (unsigned k = 0; k < half; k++)
+                {
+                    const int32_t wr = m_cos[k * step];
+                    const int32_t wi = m_sin[k * step];
+                    const unsigned a = start + k;
+                    const unsigned b = a + half;
+                    const int32_t tr = (wr * m_re[b] - wi * m_im[b] + (1 << 14)) >> 15;
+                    const int32_t ti = (wr * m_im[b] + wi * m_re[b] + (1 << 14)) >> 15;
+                    m_re[b] = static_cast<int16_t>(m_re[a] - tr);
+                    m_im[b] = static_cast<int16_t>(m_im[a] - ti);
+                    m_re[a] = static_cast<int16_t>(m_re[a] + tr);
+                    m_im[a] = static_cast<int16_t>(m_im[a] + ti);
+                }
+            }
+        }
+        // log2(|X| * 2^exponent) = log2(re^2 + im^2) / 2 + exponent
+        for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+        {
+            const uint32_t power = static_cast<uint32_t>(m_re[i] * m_re[i]) + static_cast<uint32_t>(m_im[i] * m_im[i]);
+            m_samples[i] = (log2Q16(power) >> 1) + (exponent << 16);
+        }
+        return m_samples;
+    }
+
+private:
+    static int16_t toQ15(double value)
+    {
+        const auto q = std::lround(value * 32768.0);
+        return static_cast<int16_t>(q > INT16_MAX ? INT16_MAX : (q < INT16_MIN ? INT16_MIN : q));
+    }
+
+    static int32_t roundShift(int32_t value, int32_t shift)
+    {
+        return shift == 0 ? value : static_cast<int32_t>((static_cast<int64_t>(value) + (1 << (shift - 1))) >> shift);
+    }
+
+    // Scale data down so the next stage can not overflow. Returns the number of bits shifted
+    int32_t scaleBlock()
+    {
+        int32_t maxAbs = 0;
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const int32_t re = m_re[i] < 0 ? -m_re[i] : m_re[i];
+            const int32_t im = m_im[i] < 0 ? -m_im[i] : m_im[i];
+            maxAbs = re > maxAbs ? re : maxAbs;
+            maxAbs = im > maxAbs ? im : maxAbs;
+        }
+        int32_t shift = 0;
+        while ((maxAbs >> shift) >= MaxButterflyInput)
+        {
+            shift++;
+        }
+        if (shift > 0)
+        {
+            for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+            {
+                m_re[i] = static_cast<int16_t>(roundShift(m_re[i], shift));
+                m_im[i] = static_cast<int16_t>(roundShift(m_im[i], shift));
+            }
+        }
+        return shift;
+    }
+
+    int32_t *m_samples = nullptr;
+    int16_t m_re[SAMPLE_COUNT] = {0};
+    int16_t m_im[SAMPLE_COUNT] = {0};
+    int16_t m_window[SAMPLE_COUNT] = {0};
+    int16_t m_cos[SAMPLE_COUNT / 2] = {0};
+    int16_t m_sin[SAMPLE_COUNT / 2] = {0};
+    uint16_t m_bitReversed[SAMPLE_COUNT] = {0};
+};
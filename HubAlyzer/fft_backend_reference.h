@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Portable radix-2 FFT backend without library or platform dependencies, e.g. for host builds
+// and as a reference when checking other backends
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two
+// SAMPLE_RATE = Audio sample rate in Hz
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+class FFTBackendReference
+{
+    static_assert(SAMPLE_COUNT >= 4 && (SAMPLE_COUNT & (SAMPLE_COUNT - 1)) == 0, "Sample count must be a power-of-two");
+
+public:
+    using Sample = float;
+
+    /// @brief Construct a new FFT backend and precompute window, twiddle factors and bit-reversal permutation
+    /// @p samples Sample values to transform. This MUST be allocated from the outside!
+    FFTBackendReference(float *samples)
+        : m_real(samples)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        // Blackman-Harris window, same as ArduinoFFT
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double r = 2.0 * Pi * i / (SAMPLE_COUNT - 1);
+            m_window[i] = static_cast<float>(0.35875 - 0.48829 * std::cos(r) + 0.14128 * std::cos(2.0 * r) - 0.01168 * std::cos(3.0 * r));
+        }
+        for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+        {
+            m_cos[i] = static_cast<float>(std::cos(2.0 * Pi * i / SAMPLE_COUNT));
+            m_sin[i] = static_cast<float>(-std::sin(2.0 * Pi * i / SAMPLE_COUNT));
+        }
+        for (unsigned i = 0, j = 0; i < SAMPLE_COUNT; i++)
+        {
+            m_bitReversed[i] = j;
+            unsigned bit = SAMPLE_COUNT >> 1;
+            for (; j & bit; bit >>= 1)
+            {
+                j ^= bit;
+            }
+            j ^= bit;
+        }
+    }
+
+    /// @brief Window samples, transform them and convert the result to magnitudes in-place
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values
+    float *calculate()
+    {
+        // window and reorder input in bit-reversed order
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const auto j = m_bitReversed[i];
+            m_re[i] = m_real[j] * m_window[j];
+            m_im[i] = 0.0F;
+        }
+        transform(m_re, m_im);
+        for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+        {
+            m_real[i] = std::sqrt(m_re[i] * m_re[i] + m_im[i] * m_im[i]);
+        }
+        return m_real;
+    }
+
+    /// @brief Transform two channels with one complex FFT, left as real and right as imaginary part, and separate
+    /// the spectra afterwards. Costs about the same as calculate() for one channel
+    /// @p right Right channel samples. The left channel are the samples passed to the constructor. Will be overwritten with amplitudes
+    /// @return Returns SAMPLE_COUNT / 2 amplitude values for the left and right channel
+    std::pair<float *, float *> calculateStereo(float *right)
+    {
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const auto j = m_bitReversed[i];
+            m_re[i] = m_real[j] * m_window[j];
+            m_im[i] = right[j] * m_window[j];
+        }
+        transform(m_re, m_im);
+        // Z = L + iR. L[k] = (Z[k] + conj(Z[N - k])) / 2, R[k] = (Z[k] - conj(Z[N - k])) / 2i
+        for (unsigned k = 0; k < SAMPLE_COUNT / 2; k++)
+        {
+            const unsigned n = (SAMPLE_COUNT - k) & (SAMPLE_COUNT - 1);
+            const float leftRe = m_re[k] + m_re[n];
+            const float leftIm = m_im[k] - m_im[n];
+            const float rightRe = m_im[k] + m_im[n];
+            const float rightIm = m_re[n] - m_re[k];
+            m_real[k] = 0.5F * std::sqrt(leftRe * leftRe + leftIm * leftIm);
+            right[k] = 0.5F * std::sqrt(rightRe * rightRe + rightIm * rightIm);
+        }
+        return {m_real, right};
+    }
+
+    /// @brief Forward complex FFT of bit-reversed input in-place
+    void transform(float *re, float *im) const
+    {
+        for (unsigned size = 2; size <= SAMPLE_COUNT; size <<= 1)
+        {
+            const unsigned half = size >> 1;
+            const unsigned step = SAMPLE_COUNT / size;
+            for (unsigned start = 0; start < SAMPLE_COUNT; start += size)
+            {
+                for (unsigned k = 0; k < half; k++)
+                {
+                    const float wr = m_cos[k * step];
+                    const float wi = m_sin[k * step];
+                    const unsigned a = start + k;
+                    const unsigned b = a + half;
+                    const float tr = wr * re[b] - wi * im[b];
+                    const float ti = wr * im[b] + wi * re[b];
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+
+private:
+    float *m_real = nullptr;
+    float m_re[SAMPLE_COUNT] = {0};
+    float m_im[SAMPLE_COUNT] = {0};
+    float m_window[SAMPLE_COUNT] = {0};
+    float m_cos[SAMPLE_COUNT / 2] = {0};
+    float m_sin[SAMPLE_COUNT / 2] = {0};
+    uint16_t m_bitReversed[SAMPLE_COUNT] = {0};
+};
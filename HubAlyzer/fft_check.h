@@ -0,0 +1,131 @@
+#pragma once
+
+#include "cycle_counter.h"
+#include "fft.h"
+#include "serial_printf.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// Shared accuracy check and benchmark for FFT backends. Call from setup() to print results to the serial port.
+// Every backend transforms the same test signals and its magnitudes are compared against a double precision DFT.
+// Also runs on the host, see test/fft_check_test.cpp, where it measures nanoseconds instead of cycles
+// SAMPLE_COUNT = Number of audio samples to use for FFT. Must be a power-of-two
+// SAMPLE_RATE = Audio sample rate in Hz
+template <unsigned SAMPLE_COUNT, unsigned SAMPLE_RATE_HZ = 48000>
+class FFTCheck
+{
+    static constexpr float MaxErrorDb = -60.0F;      // Maximum allowed magnitude error relative to the largest magnitude
+    static constexpr unsigned NR_OF_SIGNALS = 4;     // Tone at bin centre, tone at bin edge, two tones, noise
+    static constexpr unsigned NR_OF_RUNS = 4;        // Transforms per signal for measuring time
+    static constexpr double Amplitude = 100000.0;    // Test signal amplitude, similar to microphone values
+
+public:
+    /// @brief Check accuracy of a FFT backend and measure its speed
+    /// @p name Backend name to print
+    /// @return Returns true if the backend passed the accuracy check
+    template <template <unsigned, unsigned> class BACKEND>
+    static bool run(const char *name)
+    {
+        std::vector<float> samples(SAMPLE_COUNT);
+        std::vector<double> reference(SAMPLE_COUNT / 2);
+        auto backend = std::unique_ptr<BACKEND<SAMPLE_COUNT, SAMPLE_RATE_HZ>>(new BACKEND<SAMPLE_COUNT, SAMPLE_RATE_HZ>(samples.data()));
+        float maxErrorDb = -200.0F;
+        uint32_t cycles = 0;
+        for (unsigned signal = 0; signal < NR_OF_SIGNALS; signal++)
+        {
+            generate(signal, samples.data());
+            const auto peak = referenceMagnitudes(samples.data(), reference.data());
+            for (unsigned i = 0; i < NR_OF_RUNS; i++)
+            {
+                generate(signal, samples.data());
+                const auto start = CycleCounter::now();
+                backend->calculate();
+                cycles += CycleCounter::now() - start;
+            }
+            for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+            {
+                const auto error = std::fabs(samples[i] - reference[i]) / peak;
+                const auto errorDb = error > 0 ? static_cast<float>(20.0 * std::log10(error)) : -200.0F;
+                maxErrorDb = errorDb > maxErrorDb ? errorDb : maxErrorDb;
+            }
+        }
+        const bool passed = maxErrorDb <= MaxErrorDb;
+        Serial_printf("FFT %s, %d samples: max. error %.1f dB, %l %s / transform -> %s\n", name, SAMPLE_COUNT, maxErrorDb, static_cast<long>(cycles / (NR_OF_SIGNALS * NR_OF_RUNS)), CycleCounter::Unit, passed ? "passed" : "FAILED");
+        return passed;
+    }
+
+    /// @brief Check all backends available on this platform
+    /// @return Returns true if all backends passed the accuracy check
+    static bool runAll()
+    {
+        bool passed = run<FFTBackendReference>("Reference");
+#ifdef ARDUINO
+        passed = run<FFTBackendArduino>("ArduinoFFT") && passed;
+#endif
+#if __has_include("esp_dsp.h")
+        passed = run<FFTBackendEspDsp>("esp-dsp") && passed;
+#endif
+        return passed;
+    }
+
+private:
+    // Fill samples with test signal #index
+    static void generate(unsigned index, float *samples)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        uint32_t random = 12345;
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double t = 2.0 * Pi * i / SAMPLE_COUNT;
+            switch (index)
+            {
+            case 0:
+                samples[i] = static_cast<float>(Amplitude * std::sin(t * (SAMPLE_COUNT / 16)));
+                break;
+            case 1:
+                samples[i] = static_cast<float>(Amplitude * std::sin(t * (SAMPLE_COUNT / 16 + 0.5)));
+                break;
+            case 2:
+                samples[i] = static_cast<float>(Amplitude * std::sin(t * (SAMPLE_COUNT / 8 + 0.25)) + 0.01 * Amplitude * std::sin(t * (SAMPLE_COUNT / 4)));
+                break;
+            default:
+                random = random * 1664525 + 1013904223;
+                samples[i] = static_cast<float>(Amplitude * (static_cast<double>(random) / 4294967296.0 - 0.5));
+            }
+        }
+    }
+
+public:
+    /// @brief Calculate magnitudes of Blackman-Harris windowed samples with a double precision Goertzel DFT, e.g. as golden values
+    /// @p samples SAMPLE_COUNT samples
+    /// @p magnitudes Receives SAMPLE_COUNT / 2 magnitudes
+    /// @return Returns the largest magnitude
+    static double referenceMagnitudes(const float *samples, double *magnitudes)
+    {
+        constexpr double Pi = 3.14159265358979323846;
+        std::vector<double> windowed(SAMPLE_COUNT);
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double r = 2.0 * Pi * i / (SAMPLE_COUNT - 1);
+            windowed[i] = samples[i] * (0.35875 - 0.48829 * std::cos(r) + 0.14128 * std::cos(2.0 * r) - 0.01168 * std::cos(3.0 * r));
+        }
+        double peak = 0.0;
+        for (unsigned k = 0; k < SAMPLE_COUNT / 2; k++)
+        {
+            const double coefficient = 2.0 * std::cos(2.0 * Pi * k / SAMPLE_COUNT);
+            double s1 = 0.0;
+            double s2 = 0.0;
+            for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+            {
+                const double s = windowed[i] + coefficient * s1 - s2;
+                s2 = s1;
+                s1 = s;
+            }
+            magnitudes[k] = std::sqrt(std::fabs(s1 * s1 + s2 * s2 - coefficient * s1 * s2));
+            peak = magnitudes[k] > peak ? magnitudes[k] : peak;
+        }
+        return peak;
+    }
+};
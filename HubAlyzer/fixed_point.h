@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+// Fixed-point helpers for the integer analysis path on CPUs without (fast) FPU.
+// Only integer operations and constant tables are used, so results are bit-identical on every platform.
+// Qm.n notation: QN means a signed value with N fractional bits, e.g. Q15 = int16_t in [-1,1), Q16 = int32_t with 16 fractional bits
+
+// Count leading zero bits. Returns 32 for 0
+int32_t clz32(uint32_t x)
+{
+    return x == 0 ? 32 : __builtin_clz(x);
+}
+
+// Multiply two Q15 values, rounding to nearest
+int16_t mulQ15(int16_t a, int16_t b)
+{
+    return static_cast<int16_t>((static_cast<int32_t>(a) * b + (1 << 14)) >> 15);
+}
+
+// Multiply a value with a Q16 factor, rounding to nearest
+int32_t mulQ16(int32_t a, int32_t b)
+{
+    return static_cast<int32_t>((static_cast<int64_t>(a) * b + (1 << 15)) >> 16);
+}
+
+// Convert a float constant to QN. Use for compile-time constants only
+constexpr int32_t toQ(float value, unsigned fractionalBits)
+{
+    return static_cast<int32_t>(value * static_cast<float>(1UL << fractionalBits) + (value < 0 ? -0.5f : 0.5f));
+}
+
+// Saturate a 64-bit value to the int32_t range
+int32_t saturate32(int64_t x)
+{
+    return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : static_cast<int32_t>(x));
+}
+
+// Compute log2(x) in Q16 using the position of the leading one bit and a table for the mantissa.
+// The table is linearly interpolated. Max. error is 4 LSBs (~6e-5). Returns Log2Q16OfZero for x == 0
+static constexpr int32_t Log2Q16OfZero = -(32 << 16);
+
+int32_t log2Q16(uint32_t x)
+{
+    // log2(1 + i / 64) in Q16
+    static const uint32_t log2Table[64 + 1] = {
+        0, 1466, 2909, 4331, 5732, 7112, 8473, 9814, 11136, 12440, 13727, 14996,
+        16248, 17484, 18704, 19909, 21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+        30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346, 38336, 39316, 40286, 41246,
+        42196, 43137, 44068, 44990, 45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+        52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643, 59434, 60219, 60997, 61769,
+        62534, 63294, 64047, 64794, 65536};
+    if (x == 0)
+    {
+        return Log2Q16OfZero;
+    }
+    const int32_t leadingZeros = clz32(x);
+    // normalize so the leading one is bit 31. The next 6 bits index the table, the 16 after that interpolate
+    const uint32_t normalized = x << leadingZeros;
+    const uint32_t index = (normalized >> 25) & 63;
+    const uint32_t fraction = (normalized >> 9) & 0xFFFF;
+    const uint32_t a = log2Table[index];
+    const uint32_t b = log2Table[index + 1];
+    const int32_t mantissa = static_cast<int32_t>(a + (((b - a) * fraction + (1 << 15)) >> 16));
+    return ((31 - leadingZeros) << 16) + mantissa;
+}
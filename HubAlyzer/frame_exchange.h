@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest frame from one writer task to one reader task without locks (triple buffering).
+// The writer fills writeFrame() and publishes it. The reader picks up the latest published frame with update().
+// Neither side ever waits and frames the reader did not pick up in time are skipped.
+// T = Frame type, e.g. AnalysisFrame
+template <typename T>
+class FrameExchange
+{
+    static constexpr uint8_t FRESH = 0x80;      // Set in m_middle if the middle frame was not read yet
+    static constexpr uint8_t INDEX_MASK = 0x03;
+
+public:
+    /// @brief Frame to fill. Only call from the writer task
+    T &writeFrame()
+    {
+        return m_frames[m_write];
+    }
+
+    /// @brief Publish frame returned by writeFrame(). Only call from the writer task
+    void publish()
+    {
+        const auto previous = m_middle.exchange(m_write | FRESH, std::memory_order_acq_rel);
+        m_write = previous & INDEX_MASK;
+    }
+
+    /// @brief Pick up latest published frame. Only call from the reader task
+    /// @return Returns true if a new frame was published since the last call
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+        const auto previous = m_middle.exchange(m_read, std::memory_order_acq_rel);
+        m_read = previous & INDEX_MASK;
+        return true;
+    }
+
+    /// @brief Frame picked up by the last update(). Only call from the reader task
+    const T &readFrame() const
+    {
+        return m_frames[m_read];
+    }
+
+private:
+    T m_frames[3];
+    uint8_t m_write = 0;
+    uint8_t m_read = 1;
+    std::atomic<uint8_t> m_middle{2};
+};
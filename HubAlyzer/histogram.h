@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts values in fixed-width buckets to estimate percentiles without storing the values, e.g. for frame timing.
+// Values beyond the last bucket are counted in the last bucket.
+// NR_OF_BUCKETS = Number of buckets
+// BUCKET_WIDTH = Range of values per bucket, e.g. 50 for 50us buckets
+template <unsigned NR_OF_BUCKETS, uint32_t BUCKET_WIDTH>
+class Histogram
+{
+public:
+    /// @brief Count a value
+    auto add(uint32_t value) -> void
+    {
+        const uint32_t bucket = value / BUCKET_WIDTH;
+        m_counts[bucket < NR_OF_BUCKETS ? bucket : NR_OF_BUCKETS - 1]++;
+        m_count++;
+    }
+
+    /// @brief Number of values counted
+    auto count() const -> uint32_t
+    {
+        return m_count;
+    }
+
+    /// @brief Estimate a percentile of the values counted
+    /// @p fraction Fraction of values at or below the percentile, e.g. 0.99 for p99
+    /// @return Returns the upper bound of the bucket the percentile falls into, so at most BUCKET_WIDTH too high.
+    /// Returns NR_OF_BUCKETS * BUCKET_WIDTH if it falls into the last bucket and 0 if no values were counted
+    auto percentile(float fraction) const -> uint32_t
+    {
+        // rank of the value, counting from 1
+        auto rank = static_cast<uint32_t>(fraction * m_count);
+        rank += rank < fraction * m_count || rank == 0 ? 1 : 0;
+        uint32_t sum = 0;
+        for (unsigned bucket = 0; bucket < NR_OF_BUCKETS; bucket++)
+        {
+            sum += m_counts[bucket];
+            if (sum >= rank)
+            {
+                return (bucket + 1) * BUCKET_WIDTH;
+            }
+        }
+        return 0;
+    }
+
+private:
+    uint32_t m_counts[NR_OF_BUCKETS] = {};
+    uint32_t m_count = 0;
+};
@@ -24,9 +24,12 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
-#include "sos-iir-filter.h"
+#include "esp32-i2s-slm/sos-iir-filter.h"
+#include "logging.h"
+#include "sos_filter_q31.h"
 
-#define SERIAL_OUTPUT
+#include <functional>
+#include <type_traits>
 
 // I2S microphone connnection
 // SAMPLE_COUNT = Number of microphone samples to take and return in queue
@@ -40,35 +43,46 @@
 // MIC_BITS = Number of valid bits in microphone data
 // MSB_SHIFT = Set to true to fix MSB timing for some microphones, i.e. SPH0645LM4H-x
 // SAMPLE_RATE_HZ = Microphone sample rate in Hz. must be 48kHz to fit filter design
-template <unsigned SAMPLE_COUNT, int PIN_WS = 18, int PIN_SCK = 23, int PIN_SD = 19, i2s_port_t I2S_PORT = I2S_NUM_0, unsigned MIC_BITS = 24, bool MSB_SHIFT = false, unsigned SAMPLE_RATE_HZ = 48000>
+// VALUE_T = Type of returned samples. float or int32_t. int32_t samples are filtered with SOSFilterQ31
+// CHANNELS = 1 for a single microphone, 2 for two microphones sharing the data line, e.g. INMP441 with L/R pins pulled low and high.
+//            Stereo buffers hold SAMPLE_COUNT left samples followed by SAMPLE_COUNT right samples.
+//            If the channels are swapped, swap the L/R pin levels of the microphones
+template <unsigned SAMPLE_COUNT, int PIN_WS = 18, int PIN_SCK = 23, int PIN_SD = 19, i2s_port_t I2S_PORT = I2S_NUM_0, unsigned MIC_BITS = 24, bool MSB_SHIFT = false, unsigned SAMPLE_RATE_HZ = 48000, typename VALUE_T = float, unsigned CHANNELS = 1>
 class Microphone_I2S
 {
   static constexpr unsigned TASK_PRIO = 4;     // FreeRTOS priority
   static constexpr unsigned TASK_STACK = 4096; // FreeRTOS stack size (in 32-bit words)
+  static constexpr unsigned STARTUP_MS = 85;   // Microphone startup time. Samples are discarded, i.e. INMP441 up to 83ms
+
+  static_assert(std::is_same<VALUE_T, float>::value || std::is_same<VALUE_T, int32_t>::value, "Sample values must be float or int32_t");
+  static_assert(CHANNELS == 1 || CHANNELS == 2, "Only mono or stereo microphones are supported");
+  using Filter = std::conditional_t<std::is_same<VALUE_T, int32_t>::value, SOSFilterQ31, SOS_IIR_Filter>;
 
 public:
   using SAMPLE_T = int32_t;
-  using SampleBuffer = float[SAMPLE_COUNT];
+  using SampleBuffer = VALUE_T[CHANNELS * SAMPLE_COUNT];
+  using SampleHook = std::function<void(VALUE_T *samples, unsigned count)>;
   static const constexpr uint32_t SAMPLE_BITS = sizeof(SAMPLE_T) * 8;
-  static const constexpr uint32_t BUFFER_SIZE = SAMPLE_COUNT * sizeof(SAMPLE_T);
+  static const constexpr uint32_t BUFFER_SIZE = CHANNELS * SAMPLE_COUNT * sizeof(SAMPLE_T);
 
   /// @brief Create new I2S microphone.
-  /// @param filter Microphone IIR filter function to apply to samples
+  /// @param filter Microphone IIR filter function to apply to samples. Converted to fixed-point for int32_t samples.
+  /// Stereo microphones use a filter with the same coefficients, but separate state for the right channel
   Microphone_I2S(const SOS_IIR_Filter &filter)
-      : m_filter(filter)
+      : m_filter(filter), m_filterRight(SOS_IIR_Filter(filter.num_sos, filter.gain, filter.sos))
   {
   }
 
   void begin()
   {
-    // Setup I2S to sample mono channel for SAMPLE_RATE_HZ * SAMPLE_BITS
+    // Setup I2S to sample mono or stereo channels for SAMPLE_RATE_HZ * SAMPLE_BITS
     // NOTE: Recent update to Arduino_esp32 (1.0.2 -> 1.0.3)
     //       seems to have swapped ONLY_LEFT and ONLY_RIGHT channels
     const i2s_config_t i2s_config = {
         .mode = i2s_mode_t(I2S_MODE_MASTER | I2S_MODE_RX),
         .sample_rate = SAMPLE_RATE_HZ,
         .bits_per_sample = i2s_bits_per_sample_t(SAMPLE_BITS),
-        .channel_format = I2S_CHANNEL_FMT_ONLY_RIGHT,
+        .channel_format = CHANNELS == 2 ? I2S_CHANNEL_FMT_RIGHT_LEFT : I2S_CHANNEL_FMT_ONLY_RIGHT,
         .communication_format = i2s_comm_format_t(I2S_COMM_FORMAT_STAND_I2S | I2S_COMM_FORMAT_I2S_MSB),
         .intr_alloc_flags = 0, // ESP_INTR_FLAG_LEVEL1,                             // default interrupt priority
         .dma_buf_count = 4,
@@ -78,27 +92,12 @@ public:
         .fixed_mclk = 0};
     if (auto i2sError = i2s_driver_install(I2S_PORT, &i2s_config, 0, nullptr); i2sError != ESP_OK)
     {
-      Serial.println("Failed to install microphone I2S driver: ");
-      Serial.println(i2sError);
+      Log::error("Failed to install microphone I2S driver: %d\n", static_cast<int>(i2sError));
     }
-#ifdef SERIAL_OUTPUT
     else
     {
-      Serial.print("Installed microphone I2S driver at ");
-      if (I2S_PORT == I2S_NUM_0)
-      {
-        Serial.println("I2S0");
-      }
-      else if (I2S_PORT == I2S_NUM_1)
-      {
-        Serial.println("I2S1");
-      }
-      else
-      {
-        Serial.println("unknown port");
-      }
+      Log::info("Installed microphone I2S driver at %s\n", I2S_PORT == I2S_NUM_0 ? "I2S0" : (I2S_PORT == I2S_NUM_1 ? "I2S1" : "unknown port"));
     }
-#endif
 
     // I2S pin mapping
     const i2s_pin_config_t pin_config = {
@@ -108,15 +107,12 @@ public:
         .data_in_num = PIN_SD};
     if (auto i2sError = i2s_set_pin(I2S_PORT, &pin_config); i2sError != ESP_OK)
     {
-      Serial.print("Failed to set microphone I2S pin mapping: ");
-      Serial.println(i2sError);
+      Log::error("Failed to set microphone I2S pin mapping: %d\n", static_cast<int>(i2sError));
     }
-#ifdef SERIAL_OUTPUT
     else
     {
-      Serial.println("Installed microphone I2S pin mapping");
+      Log::info("Installed microphone I2S pin mapping\n");
     }
-#endif
 
     // FIXME: There is a known issue with esp-idf and sampling rates, see:
     //        https://github.com/espressif/esp-idf/issues/2634
@@ -129,14 +125,12 @@ public:
     //  Create FreeRTOS queue
     if (m_sampleQueue = xQueueCreate(2, BUFFER_SIZE); m_sampleQueue == nullptr)
     {
-      Serial.println("Failed to create microphone sample queue");
+      Log::error("Failed to create microphone sample queue\n");
     }
-#ifdef SERIAL_OUTPUT
     else
     {
-      Serial.println("Created microphone sample queue");
+      Log::info("Created microphone sample queue\n");
     }
-#endif
     // Create the I2S reader FreeRTOS task
     // NOTE: Current version of ESP-IDF will pin the task
     //       automatically to the first core it happens to run on
@@ -145,13 +139,11 @@ public:
     TaskHandle_t xHandle = nullptr;
     if (xTaskCreatePinnedToCore(readerTask, "Microphone_I2S reader", TASK_STACK, this, TASK_PRIO, &xHandle, 0) != pdPASS || xHandle == nullptr)
     {
-      Serial.println("Failed to create microphone I2S reader task");
+      Log::error("Failed to create microphone I2S reader task\n");
     }
     else
     {
-#ifdef SERIAL_OUTPUT
-      Serial.println("Created microphone I2S reader task");
-#endif
+      Log::info("Created microphone I2S reader task\n");
     }
   }
 
@@ -161,6 +153,13 @@ public:
     return m_sampleQueue;
   }
 
+  /// @brief Set a function that is called from the reader task for every filtered sample buffer before it is queued.
+  /// The function may modify the samples. It receives CHANNELS * SAMPLE_COUNT samples. Set this before calling startSampling().
+  void setSampleHook(SampleHook hook)
+  {
+    m_sampleHook = hook;
+  }
+
   /// @brief Start sampling from microphone.
   void startSampling()
   {
@@ -176,23 +175,27 @@ public:
 private:
   static void readerTask(void *parameter)
   {
-#ifdef SERIAL_OUTPUT
-    Serial.println("Mic reader task started");
-#endif
+    Log::info("Mic reader task started\n");
     auto object = reinterpret_cast<Microphone_I2S *>(parameter);
-    // Discard first blocks, microphone may have startup time (i.e. INMP441 up to 83ms)
+    // Discard samples during microphone startup time. This runs while setup() continues on the other core
     size_t bytes_read = 0;
-    for (int i = 0; i < 5; i++)
+    for (size_t discardBytes = CHANNELS * (SAMPLE_RATE_HZ * STARTUP_MS / 1000) * sizeof(SAMPLE_T); discardBytes > 0; discardBytes -= bytes_read)
     {
-      if (auto i2sError = i2s_read(I2S_PORT, &object->m_sampleBuffer, BUFFER_SIZE, &bytes_read, portMAX_DELAY); i2sError != ESP_OK || bytes_read != BUFFER_SIZE)
+      const size_t readBytes = discardBytes < BUFFER_SIZE ? discardBytes : BUFFER_SIZE;
+      if (auto i2sError = i2s_read(I2S_PORT, &object->m_sampleBuffer, readBytes, &bytes_read, portMAX_DELAY); i2sError != ESP_OK || bytes_read != readBytes)
       {
-        Serial.print("Failed to read from I2S: ");
-        Serial.println(i2sError);
+        Log::error("Failed to read from I2S: %d\n", static_cast<int>(i2sError));
+        break;
       }
     }
     while (true)
     {
-      if (object->m_isSampling)
+      if (!object->m_isSampling)
+      {
+        // don't starve lower priority tasks on this core until sampling starts
+        vTaskDelay(1);
+      }
+      else
       {
         // Block and wait for microphone values from I2S
         // Data is moved from DMA buffers to our m_sampleBuffer by the driver ISR
@@ -200,23 +203,50 @@ private:
         //
         // Note: i2s_read does not care it is writing in float[] buffer, it will write
         //       integer values to the given address, as received from the hardware peripheral.
-        i2s_read(I2S_PORT, &object->m_sampleBuffer, BUFFER_SIZE, &bytes_read, portMAX_DELAY);
-
         // Debug only. Ticks we spent filtering and summing block of I2S data
         // TickType_t start_tick = xTaskGetTickCount();
 
-        // Convert (including shifting) integer microphone values to floats,
-        // using the same buffer (assumed sample size is same as size of float),
-        // to save a bit of memory
-        auto int_samples = reinterpret_cast<const SAMPLE_T *>(&object->m_sampleBuffer);
-        for (int i = 0; i < SAMPLE_COUNT; i++)
+        if constexpr (CHANNELS == 1)
+        {
+          i2s_read(I2S_PORT, &object->m_sampleBuffer, BUFFER_SIZE, &bytes_read, portMAX_DELAY);
+          // Convert (including shifting) integer microphone values to floats,
+          // using the same buffer (assumed sample size is same as size of float),
+          // to save a bit of memory. For int32_t samples this only shifts
+          auto int_samples = reinterpret_cast<const SAMPLE_T *>(&object->m_sampleBuffer);
+          for (int i = 0; i < SAMPLE_COUNT; i++)
+          {
+            object->m_sampleBuffer[i] = int_samples[i] >> (SAMPLE_BITS - MIC_BITS);
+          }
+        }
+        else
         {
-          object->m_sampleBuffer[i] = int_samples[i] >> (SAMPLE_BITS - MIC_BITS);
+          // Interleaved left / right samples can not be separated in place, so they are read into a raw buffer
+          // and deinterleaved while converting them, so no extra pass over the samples is needed
+          i2s_read(I2S_PORT, &object->m_rawBuffer, BUFFER_SIZE, &bytes_read, portMAX_DELAY);
+          auto left = object->m_sampleBuffer;
+          auto right = object->m_sampleBuffer + SAMPLE_COUNT;
+          for (int i = 0; i < SAMPLE_COUNT; i++)
+          {
+            left[i] = object->m_rawBuffer[2 * i] >> (SAMPLE_BITS - MIC_BITS);
+            right[i] = object->m_rawBuffer[2 * i + 1] >> (SAMPLE_BITS - MIC_BITS);
+          }
         }
 
         // filter values and apply gain setting
         object->m_filter.applyFilters(object->m_sampleBuffer, object->m_sampleBuffer, SAMPLE_COUNT);
         object->m_filter.applyGain(object->m_sampleBuffer, object->m_sampleBuffer, SAMPLE_COUNT);
+        if constexpr (CHANNELS == 2)
+        {
+          auto right = object->m_sampleBuffer + SAMPLE_COUNT;
+          object->m_filterRight.applyFilters(right, right, SAMPLE_COUNT);
+          object->m_filterRight.applyGain(right, right, SAMPLE_COUNT);
+        }
+
+        // Process samples in the reader task, e.g. for per-sample analysis
+        if (object->m_sampleHook)
+        {
+          object->m_sampleHook(object->m_sampleBuffer, CHANNELS * SAMPLE_COUNT);
+        }
 
         // Debug only. Ticks we spent filtering and summing block of I2S data
         // auto proc_ticks = xTaskGetTickCount() - start_tick;
@@ -256,8 +286,11 @@ private:
     }
   }
 
-  SOS_IIR_Filter m_filter;
+  Filter m_filter;
+  Filter m_filterRight; // Filter state of the right channel. Only used for stereo
+  SampleHook m_sampleHook;
   QueueHandle_t m_sampleQueue;
   SampleBuffer m_sampleBuffer __attribute__((aligned(4)));
+  SAMPLE_T m_rawBuffer[CHANNELS == 2 ? CHANNELS * SAMPLE_COUNT : 1]; // Interleaved samples from I2S. Only used for stereo
   bool m_isSampling = false;
 };
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "serial_printf.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Messages with a level above LOG_LEVEL are removed at compile time: 0 = off, 1 = errors, 2 = warnings, 3 = info, 4 = debug
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
+#endif
+
+// Deferred logging that never blocks the caller. A log call stores the format string pointer and the raw arguments in a
+// lock-free ring buffer of the calling core. A task with idle priority formats the records with Serial_format() and prints them.
+// Records that do not fit into a full ring are dropped and counted, so logging from the I2S reader or render task is safe.
+// The format string and %s arguments are stored as pointers, so they must stay valid, e.g. string literals.
+// Arguments are stored as 32-bit values. Pass float for %f and int or long for integers, like with Serial_printf.
+// Host builds, e.g. tests, have no log task and a single ring. Call drain() to print the records
+namespace Log
+{
+    enum class Level : uint8_t
+    {
+        Error = 1,
+        Warning = 2,
+        Info = 3,
+        Debug = 4
+    };
+
+    constexpr unsigned MAX_ARGUMENTS = 8;
+    constexpr unsigned NR_OF_CORES = 2;
+
+    using Word = uintptr_t; // Stored argument. 32 bits on the ESP32, big enough for pointers on hosts
+
+    // Bounded ring of log records for multiple producers and a single consumer.
+    // Producers reserve a slot with a compare-and-swap and mark it ready with its sequence number, so tasks that
+    // preempt each other never see half-written records. Unpinned tasks moving to the other core are safe too
+    template <unsigned CAPACITY>
+    class Ring
+    {
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power-of-two");
+        static constexpr uint32_t INDEX_MASK = CAPACITY - 1;
+
+    public:
+        struct Record
+        {
+            std::atomic<uint32_t> sequence{0}; // Index + 1 if the record is ready to be read, index if the slot is free
+            const char *format = nullptr;
+            Level level = Level::Info;
+            uint8_t count = 0;                  // Number of arguments
+            Word arguments[MAX_ARGUMENTS] = {0};
+        };
+
+        Ring()
+        {
+            for (uint32_t i = 0; i < CAPACITY; i++)
+            {
+                m_records[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief Add record. Can be called from any task
+        /// @return Returns false if the ring is full and the record was dropped
+        bool push(Level level, const char *format, const Word *arguments, unsigned count)
+        {
+            auto tail = m_tail.load(std::memory_order_relaxed);
+            Record *record = nullptr;
+            while (true)
+            {
+                record = &m_records[tail & INDEX_MASK];
+                const auto difference = static_cast<int32_t>(record->sequence.load(std::memory_order_acquire) - tail);
+                if (difference < 0)
+                {
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (difference == 0 && m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+                if (difference > 0)
+                {
+                    tail = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+            record->format = format;
+            record->level = level;
+            record->count = count;
+            memcpy(record->arguments, arguments, count * sizeof(Word));
+            record->sequence.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /// @brief Oldest ready record or nullptr. Only call from the consumer. Call release() after reading it
+        const Record *peek() const
+        {
+            const auto &record = m_records[m_head & INDEX_MASK];
+            return record.sequence.load(std::memory_order_acquire) == m_head + 1 ? &record : nullptr;
+        }
+
+        /// @brief Free record returned by peek(). Only call from the consumer
+        void release()
+        {
+            m_records[m_head & INDEX_MASK].sequence.store(m_head + CAPACITY, std::memory_order_release);
+            m_head++;
+        }
+
+        /// @brief Number of records dropped so far
+        uint32_t dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        Record m_records[CAPACITY];
+        std::atomic<uint32_t> m_tail{0};
+        uint32_t m_head = 0; // Only used by the consumer
+        std::atomic<uint32_t> m_dropped{0};
+    };
+
+    // Per-core rings, so the cores do not contend for the same ring, and the task draining them
+    class Logger
+    {
+        static constexpr unsigned RING_CAPACITY = 64;       // Records per core. Uses 44 bytes per record
+        static constexpr unsigned TASK_STACK = 3072;       // FreeRTOS stack size (in 32-bit words)
+        static constexpr uint32_t DRAIN_INTERVAL_MS = 10;  // Time to sleep when all rings are empty
+
+        // Arguments of a stored record for Serial_format()
+        struct RecordArguments
+        {
+            const Word *arguments;
+            unsigned count;
+            unsigned next = 0;
+
+            Word nextWord() { return next < count ? arguments[next++] : 0; }
+            int nextInt() { return static_cast<int32_t>(nextWord()); }
+            long nextLong() { return static_cast<int32_t>(nextWord()); }
+            double nextDouble()
+            {
+                const auto word = static_cast<uint32_t>(nextWord());
+                float value;
+                memcpy(&value, &word, sizeof(value));
+                return value;
+            }
+            const char *nextString() { return reinterpret_cast<const char *>(nextWord()); }
+        };
+
+    public:
+        using RingType = Ring<RING_CAPACITY>;
+
+        /// @brief Logger all log functions write to
+        static Logger &instance()
+        {
+            static Logger logger;
+            return logger;
+        }
+
+#ifdef ARDUINO
+        /// @brief Start the task printing records to Serial. Records logged before are kept and printed then
+        void begin()
+        {
+            if (xTaskCreatePinnedToCore(drainTask, "Log", TASK_STACK, this, tskIDLE_PRIORITY, nullptr, tskNO_AFFINITY) != pdPASS)
+            {
+                Serial.println("Failed to create log task");
+            }
+        }
+#endif
+
+        /// @brief Ring of the calling core
+        RingType &ring()
+        {
+#ifdef ARDUINO
+            return m_rings[xPortGetCoreID() % NR_OF_CORES];
+#else
+            return m_rings[0];
+#endif
+        }
+
+        /// @brief Format and print all ready records of all cores. Only call from one task
+        /// @p out Output with print() like Arduino's Print, e.g. Serial
+        /// @return Returns the number of records printed
+        template <typename OUTPUT>
+        unsigned drain(OUTPUT &out)
+        {
+            unsigned printed = 0;
+            uint32_t dropped = 0;
+            for (auto &ring : m_rings)
+            {
+                for (auto record = ring.peek(); record != nullptr; record = ring.peek())
+                {
+                    if (record->level == Level::Error)
+                    {
+                        out.print("Error: ");
+                    }
+                    else if (record->level == Level::Warning)
+                    {
+                        out.print("Warning: ");
+                    }
+                    RecordArguments arguments{record->arguments, record->count};
+                    Serial_format(out, record->format, arguments);
+                    ring.release();
+                    printed++;
+                }
+                dropped += ring.dropped();
+            }
+            if (dropped != m_reportedDropped)
+            {
+                out.print("Log records dropped: ");
+                out.print(static_cast<long>(dropped - m_reportedDropped), DEC);
+                out.print("\n");
+                m_reportedDropped = dropped;
+            }
+            return printed;
+        }
+
+    private:
+#ifdef ARDUINO
+        static void drainTask(void *parameter)
+        {
+            auto logger = reinterpret_cast<Logger *>(parameter);
+            while (true)
+            {
+                if (logger->drain(Serial) == 0)
+                {
+                    vTaskDelay(pdMS_TO_TICKS(DRAIN_INTERVAL_MS));
+                }
+            }
+        }
+#endif
+
+        RingType m_rings[NR_OF_CORES];
+        uint32_t m_reportedDropped = 0;
+    };
+
+    // Store argument. Floating-point values are stored as float bits, integers are truncated to 32 bits
+    template <typename T>
+    Word toWord(T value)
+    {
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            const float single = static_cast<float>(value);
+            uint32_t bits;
+            memcpy(&bits, &single, sizeof(bits));
+            return bits;
+        }
+        else if constexpr (std::is_pointer<T>::value)
+        {
+            return reinterpret_cast<Word>(value);
+        }
+        else
+        {
+            return static_cast<uint32_t>(value);
+        }
+    }
+
+    /// @brief Log message with level. Removed at compile time if LEVEL is above LOG_LEVEL
+    template <Level LEVEL, typename... ARGS>
+    void write(const char *format, ARGS... arguments)
+    {
+        static_assert(sizeof...(ARGS) <= MAX_ARGUMENTS, "Too many log arguments");
+        if constexpr (static_cast<int>(LEVEL) <= LOG_LEVEL)
+        {
+            const Word words[sizeof...(ARGS) + 1] = {toWord(arguments)..., 0};
+            Logger::instance().ring().push(LEVEL, format, words, sizeof...(ARGS));
+        }
+    }
+
+    template <typename... ARGS>
+    void error(const char *format, ARGS... arguments)
+    {
+        write<Level::Error>(format, arguments...);
+    }
+
+    template <typename... ARGS>
+    void warning(const char *format, ARGS... arguments)
+    {
+        write<Level::Warning>(format, arguments...);
+    }
+
+    template <typename... ARGS>
+    void info(const char *format, ARGS... arguments)
+    {
+        write<Level::Info>(format, arguments...);
+    }
+
+    template <typename... ARGS>
+    void debug(const char *format, ARGS... arguments)
+    {
+        write<Level::Debug>(format, arguments...);
+    }
+}
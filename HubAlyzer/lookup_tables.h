@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+
+// Lookup tables computed by the compiler. Use them as static constexpr members, so they are stored in flash and
+// neither cost RAM nor time at boot. std::cos is not constexpr, so these use their own series expansions
+namespace LookupTables
+{
+    constexpr double Pi = 3.14159265358979323846;
+
+    /// @brief Cosine of x for constant expressions. Accurate to ~1e-15
+    constexpr double cosine(double x)
+    {
+        // reduce to [-pi, pi]
+        const auto turns = static_cast<long long>(x / (2.0 * Pi));
+        x -= 2.0 * Pi * static_cast<double>(turns);
+        x = x > Pi ? x - 2.0 * Pi : (x < -Pi ? x + 2.0 * Pi : x);
+        // Taylor series
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 2; n <= 40; n += 2)
+        {
+            term *= -x * x / (n * (n - 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    /// @brief Sine of x for constant expressions. Accurate to ~1e-15
+    constexpr double sine(double x)
+    {
+        return cosine(x - 0.5 * Pi);
+    }
+
+    /// @brief Binary logarithm of x > 0 for constant expressions. Accurate to ~1e-15
+    constexpr double logarithm2(double x)
+    {
+        // reduce to [1, 2)
+        double exponent = 0.0;
+        for (; x >= 2.0; x *= 0.5)
+        {
+            exponent += 1.0;
+        }
+        for (; x < 1.0; x *= 2.0)
+        {
+            exponent -= 1.0;
+        }
+        // ln(x) = 2 * atanh((x - 1) / (x + 1)) as series
+        const double r = (x - 1.0) / (x + 1.0);
+        double term = r;
+        double sum = 0.0;
+        for (int n = 1; n <= 61; n += 2)
+        {
+            sum += term / n;
+            term *= r * r;
+        }
+        return exponent + 2.0 * sum / 0.69314718055994530942;
+    }
+
+    /// @brief 4-term Blackman-Harris window value i of a symmetric window of length n
+    constexpr double blackmanHarris(double i, double n)
+    {
+        const double r = 2.0 * Pi * i / (n - 1);
+        return 0.35875 - 0.48829 * cosine(r) + 0.14128 * cosine(2.0 * r) - 0.01168 * cosine(3.0 * r);
+    }
+
+    /// @brief Symmetric 4-term Blackman-Harris window, like ArduinoFFT's FFTWindow::Blackman_Harris
+    template <unsigned N>
+    constexpr auto blackmanHarrisWindow() -> std::array<float, N>
+    {
+        std::array<float, N> window = {};
+        for (unsigned i = 0; i < N; i++)
+        {
+            window[i] = static_cast<float>(blackmanHarris(i, N));
+        }
+        return window;
+    }
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#ifdef ENABLE_OTA
+#ifdef ENABLE_WIFI
     constexpr const char* wifiSsid = "YOUR_WIFI_SSID";
     constexpr const char* wifiPassword = "YOUR_WIFI_PASSWORD";
 #endif
@@ -1,6 +1,11 @@
 #pragma once
 
+#include "approx.h"
+#include "fixed_point.h"
+#include "parameters.h"
+
 #include <cmath>
+#include <cstring>
 #include <functional>
 
 // Audio amplitude normalizer and automatic gain control
@@ -9,7 +14,8 @@
 // AUDIO_MAX_DB = Max. audio signal in dB
 // MAX_HZ = Maximum / end of frequency spectrum
 // SAMPLE_RATE = Audio sample rate in Hz
-template <unsigned SAMPLE_COUNT, unsigned int AUDIO_NOISE_DB = 33, unsigned int AUDIO_MAX_DB = 120, unsigned int MAX_HZ = 4000, unsigned SAMPLE_RATE_HZ = 48000>
+// VALUE_T = Type of FFT values. float for amplitudes, int32_t for log2 amplitudes in Q16 from FFTBackendQ15
+template <unsigned SAMPLE_COUNT, unsigned int AUDIO_NOISE_DB = 33, unsigned int AUDIO_MAX_DB = 120, unsigned int MAX_HZ = 4000, unsigned SAMPLE_RATE_HZ = 48000, typename VALUE_T = float>
 class Normalization
 {
   static constexpr float MIN_HZ = 1.0f / SAMPLE_COUNT * SAMPLE_RATE_HZ;                                            // Minimum frequency ~94Hz for 512 samples, 48kHz sample rate
@@ -18,9 +24,6 @@ class Normalization
   static constexpr unsigned int BINS_FOR_MAX_HZ = std::ceil((MAX_HZ - MIN_HZ) / BIN_SIZE_HZ) + BIN_START;          // # of bins needed to get to MAX_HZ, ~83 bins to 4KHz, at 48kHz and 512 samples
   static constexpr unsigned int NR_OF_BINS_USED = SAMPLE_COUNT < BINS_FOR_MAX_HZ ? SAMPLE_COUNT : BINS_FOR_MAX_HZ; // Maximum used bins from magnitudes array
 
-  static constexpr float AgcSpeedFactor = 0.01f; // The speed of the "Automatic Gain Control" mechanism [0,1]
-  static constexpr float AgcKeepLevel = 10.0f;   // The maximum amount the "automatic gain control" mechanism will remove from the signal
-
 public:
   /// @brief Construct a new normalizer
   /// @p amplitudeToDbFunc Function that converts audio amplitude values to dB values. This is audio input system dependent and thus has to come from outside
@@ -29,6 +32,13 @@ public:
   {
   }
 
+  /// @brief Construct a new normalizer converting amplitudes with the batch dB kernel Approx::amplitudeToDb (max. error 2e-4 dB)
+  /// @p amplitudeOneDb dB value of a FFT amplitude of 1. This is audio input system dependent and thus has to come from outside
+  Normalization(float amplitudeOneDb)
+      : m_amplitudeOneDb(amplitudeOneDb)
+  {
+  }
+
   /// @brief Normalize amplitude values from [AUDIO_NOISE_DB, AUDIO_MAX_DB] to range [0,1] and apply gain control
   /// @p amplitudes Amplitude values for individual frequency bands from the FFT. Will be modified!
   /// @p applyAGC If true an automatic gain control will be applied to the amplitudes
@@ -40,54 +50,199 @@ public:
     {
       amplitudes[0] = 0.0F;
     }
-    // calculate bin levels
-    for (unsigned int i = 0; i < NR_OF_BINS_USED; i++)
+    return normalize(amplitudes, NR_OF_BINS_USED, BIN_START, applyAGC);
+  }
+
+  /// @brief Normalize band amplitude values, e.g. from a BandBank, like FFT amplitudes in apply()
+  /// @p amplitudes Amplitude values for individual spectrum bands. Will be modified!
+  /// @p count Number of band amplitudes
+  /// @p applyAGC If true an automatic gain control will be applied to the amplitudes
+  /// @return Returns @p amplitudes converted to magnitudes in range [0,1] (where 0 is AUDIO_NOISE_DB and 1 is AUDIO_MAX_DB)
+  float *applyToBands(float *amplitudes, unsigned int count, bool applyAGC = true)
+  {
+    return normalize(amplitudes, count, 0, applyAGC);
+  }
+
+  /// @brief Normalize amplitude values like apply(), but with the gain control level of the last apply() call instead of updating it,
+  /// e.g. for the channels of a stereo signal, so the balance between them is kept
+  /// @p amplitudes Amplitude values for individual frequency bands from the FFT. Will be modified!
+  /// @p clearBin0 If true DC bin #0 will be set to 0
+  /// @return Returns @p amplitudes converted to magnitudes in range [0,1] (where 0 is AUDIO_NOISE_DB and 1 is AUDIO_MAX_DB)
+  float *applyWithLastGain(float *amplitudes, bool clearBin0 = true)
+  {
+    if (clearBin0)
     {
-      // Calculate dB values from amplitudes. This should give values between ~[AUDIO_NOISE_DB, AUDIO_MAX_DB]
-      auto value = m_amplitudeToDb(amplitudes[i]);
-      // remove noise floor and clamp to 0
-      value -= 1.05F * AUDIO_NOISE_DB;
-      amplitudes[i] = value < 0 ? 0 : value;
+      amplitudes[0] = 0.0F;
     }
+    toDb(amplitudes, NR_OF_BINS_USED);
+    return applyGain(amplitudes, NR_OF_BINS_USED);
+  }
+
+private:
+  // Convert count amplitudes to normalized magnitudes. Values before agcStart are not used to calculate the AGC level
+  float *normalize(float *amplitudes, unsigned int count, unsigned int agcStart, bool applyAGC)
+  {
+    toDb(amplitudes, count);
     // check if we want to apply the AGC
     if (applyAGC)
     {
+      m_agcSpeed.update();
+      const float agcSpeedFactor = m_agcSpeed.value();
       // get average and minimum of all bins except #0
       float tempAvg = 0.0f;
       float tempMin = AUDIO_MAX_DB;
-      for (unsigned int i = BIN_START; i < NR_OF_BINS_USED; i++)
+      for (unsigned int i = agcStart; i < count; i++)
       {
         tempAvg += amplitudes[i];
         tempMin = amplitudes[i] < tempMin ? amplitudes[i] : tempMin;
       }
-      tempAvg *= 1.0F / NR_OF_BINS_USED;
+      tempAvg *= 1.0F / count;
       // calculate new running average. we use an average of the minimum and average here,
       // as both alone won't give goode results
       auto levelFuzz = 0.5f * tempAvg + 0.5f * tempMin;
-      m_levelsAvg = AgcSpeedFactor * levelFuzz + (1.0f - AgcSpeedFactor) * m_levelsAvg;
+      m_levelsAvg = agcSpeedFactor * levelFuzz + (1.0f - agcSpeedFactor) * m_levelsAvg;
       // calculate amount of AGC
-      const auto agcLevel = m_levelsAvg;
-      const auto agcFactor = 0.033333f * m_levelsAvg + 1.0f;
-      // apply AGC and normalize to [0,1] range
-      for (unsigned int i = 0; i < NR_OF_BINS_USED; i++)
-      {
-        amplitudes[i] = amplitudes[i] - agcLevel;
-        amplitudes[i] = amplitudes[i] < 0 ? 0 : amplitudes[i];
-        amplitudes[i] *= agcFactor * 1.0f / (AUDIO_MAX_DB - AUDIO_NOISE_DB);
-      }
+      m_agcLevel = m_levelsAvg;
+      m_agcFactor = 0.033333f * m_levelsAvg + 1.0f;
     }
     else
     {
-      // normalize to [0,1] range
-      for (unsigned int i = 0; i < NR_OF_BINS_USED; i++)
+      m_agcLevel = 0.0f;
+      m_agcFactor = 1.0f;
+    }
+    return applyGain(amplitudes, count);
+  }
+
+  // Calculate dB values above the noise floor from amplitudes
+  void toDb(float *amplitudes, unsigned int count)
+  {
+    // Calculate dB values from amplitudes. This should give values between ~[AUDIO_NOISE_DB, AUDIO_MAX_DB]
+    if (m_amplitudeToDb)
+    {
+      for (unsigned int i = 0; i < count; i++)
       {
-        amplitudes[i] *= 1.0f / (AUDIO_MAX_DB - AUDIO_NOISE_DB);
+        amplitudes[i] = m_amplitudeToDb(amplitudes[i]);
       }
     }
+    else
+    {
+      Approx::amplitudeToDb<ApproxPrecision::Medium>(amplitudes, amplitudes, count, m_amplitudeOneDb);
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+      // remove noise floor and clamp to 0
+      const auto value = amplitudes[i] - 1.05F * AUDIO_NOISE_DB;
+      amplitudes[i] = value < 0 ? 0 : value;
+    }
+  }
+
+  // Apply AGC level of the last normalize() call and normalize dB values to [0,1] range
+  float *applyGain(float *amplitudes, unsigned int count) const
+  {
+    for (unsigned int i = 0; i < count; i++)
+    {
+      amplitudes[i] = amplitudes[i] - m_agcLevel;
+      amplitudes[i] = amplitudes[i] < 0 ? 0 : amplitudes[i];
+      amplitudes[i] *= m_agcFactor * 1.0f / (AUDIO_MAX_DB - AUDIO_NOISE_DB);
+    }
     return amplitudes;
   }
 
-private:
   std::function<float(float)> m_amplitudeToDb{};
+  float m_amplitudeOneDb = 0.0f; // dB value of amplitude 1 if m_amplitudeToDb is not set
+  Parameter<float> m_agcSpeed{"Normalization.agcSpeed", 0.01f, 0.0f, 1.0f}; // The speed of the "Automatic Gain Control" mechanism [0,1]
   float m_levelsAvg = 0.0f; // running average level
+  float m_agcLevel = 0.0f;  // AGC level subtracted by the last normalize() call
+  float m_agcFactor = 1.0f; // AGC factor applied by the last normalize() call
+};
+
+// Fixed-point audio normalizer and automatic gain control for the integer analysis path.
+// Works like the floating-point version, but on log2 amplitudes in Q16 as returned by FFTBackendQ15.
+// All calculations use integers. Only the final magnitudes are converted to float for Spectrum.
+// Bins within 50dB of the loudest bin stay within ~0.015 (~1.3dB) of the floating-point path. Quieter bins are
+// limited by the dynamic range of the 16-bit FFT and differ by up to ~0.4, see test/fixed_point_test.cpp
+template <unsigned SAMPLE_COUNT, unsigned int AUDIO_NOISE_DB, unsigned int AUDIO_MAX_DB, unsigned int MAX_HZ, unsigned SAMPLE_RATE_HZ>
+class Normalization<SAMPLE_COUNT, AUDIO_NOISE_DB, AUDIO_MAX_DB, MAX_HZ, SAMPLE_RATE_HZ, int32_t>
+{
+  static constexpr float MIN_HZ = 1.0f / SAMPLE_COUNT * SAMPLE_RATE_HZ;                                            // Minimum frequency ~94Hz for 512 samples, 48kHz sample rate
+  static constexpr unsigned int BIN_START = 1;                                                                     // Bin #0 is crap / DC offset, so we don't use it
+  static constexpr float BIN_SIZE_HZ = float(SAMPLE_RATE_HZ) / SAMPLE_COUNT;                                       // Size of each FFT bin in Hz, ~46Hz at 48kHz and 512 samples
+  static constexpr unsigned int BINS_FOR_MAX_HZ = std::ceil((MAX_HZ - MIN_HZ) / BIN_SIZE_HZ) + BIN_START;          // # of bins needed to get to MAX_HZ, ~83 bins to 4KHz, at 48kHz and 512 samples
+  static constexpr unsigned int NR_OF_BINS_USED = SAMPLE_COUNT < BINS_FOR_MAX_HZ ? SAMPLE_COUNT : BINS_FOR_MAX_HZ; // Maximum used bins from magnitudes array
+
+  static constexpr int32_t Log2ToDbQ16 = toQ(6.0205999f, 16);                           // 20 * log10(2). Converts log2 amplitudes to dB
+  static constexpr int32_t NoiseFloorQ16 = toQ(1.05F * AUDIO_NOISE_DB, 16);             // Noise floor removed from dB values
+  static constexpr int32_t AgcGainQ16 = toQ(0.033333f, 16);                             // How much AGC gain is applied per dB of average level
+  static constexpr int64_t InvRangeQ24 = (1LL << 24) / (AUDIO_MAX_DB - AUDIO_NOISE_DB); // 1 / dB range for normalization
+
+public:
+  /// @brief Construct a new fixed-point normalizer
+  /// @p amplitudeOneDb dB value of a FFT amplitude of 1. This is audio input system dependent and thus has to come from outside
+  Normalization(float amplitudeOneDb)
+      : m_dbOffset(static_cast<int32_t>(std::lround(amplitudeOneDb * 65536.0F)))
+  {
+  }
+
+  /// @brief Normalize log2 amplitude values from [AUDIO_NOISE_DB, AUDIO_MAX_DB] to range [0,1] and apply gain control
+  /// @p log2Amplitudes log2 amplitude values in Q16 for individual frequency bands from the FFT. Will be overwritten by the float results!
+  /// @p applyAGC If true an automatic gain control will be applied to the amplitudes
+  /// @p clearBin0 If true DC bin #0 will be set to 0
+  /// @return Returns @p log2Amplitudes converted to float magnitudes in range [0,1] (where 0 is AUDIO_NOISE_DB and 1 is AUDIO_MAX_DB)
+  float *apply(int32_t *log2Amplitudes, bool applyAGC = true, bool clearBin0 = true)
+  {
+    if (clearBin0)
+    {
+      log2Amplitudes[0] = Log2Q16OfZero;
+    }
+    // calculate bin levels in dB
+    auto values = log2Amplitudes;
+    for (unsigned int i = 0; i < NR_OF_BINS_USED; i++)
+    {
+      auto value = mulQ16(values[i], Log2ToDbQ16) + m_dbOffset;
+      // remove noise floor and clamp to 0
+      value -= NoiseFloorQ16;
+      values[i] = value < 0 ? 0 : value;
+    }
+    // normalization factor in Q24
+    int64_t scale = InvRangeQ24;
+    int32_t agcLevel = 0;
+    if (applyAGC)
+    {
+      // get average and minimum of all bins except #0
+      int64_t tempSum = 0;
+      int32_t tempMin = static_cast<int32_t>(AUDIO_MAX_DB) << 16;
+      for (unsigned int i = BIN_START; i < NR_OF_BINS_USED; i++)
+      {
+        tempSum += values[i];
+        tempMin = values[i] < tempMin ? values[i] : tempMin;
+      }
+      const auto tempAvg = static_cast<int32_t>(tempSum / static_cast<int32_t>(NR_OF_BINS_USED));
+      // calculate new running average of the average and minimum
+      const auto levelFuzz = (tempAvg >> 1) + (tempMin >> 1);
+      if (m_agcSpeed.update())
+      {
+        m_agcSpeedQ16 = static_cast<int32_t>(std::lround(m_agcSpeed.value() * 65536.0F));
+      }
+      m_levelsAvg += mulQ16(levelFuzz - m_levelsAvg, m_agcSpeedQ16);
+      // calculate amount of AGC
+      agcLevel = m_levelsAvg;
+      const auto agcFactor = mulQ16(m_levelsAvg, AgcGainQ16) + (1 << 16);
+      scale = (static_cast<int64_t>(agcFactor) * InvRangeQ24) >> 16;
+    }
+    // apply AGC and normalize to [0,1] range. Convert to float in-place
+    for (unsigned int i = 0; i < NR_OF_BINS_USED; i++)
+    {
+      auto value = values[i] - agcLevel;
+      value = value < 0 ? 0 : value;
+      const float magnitude = static_cast<float>((static_cast<int64_t>(value) * scale) >> 24) * (1.0F / 65536.0F);
+      memcpy(&values[i], &magnitude, sizeof(float));
+    }
+    return reinterpret_cast<float *>(log2Amplitudes);
+  }
+
+private:
+  int32_t m_dbOffset = 0;   // dB value of amplitude 1 in Q16
+  int32_t m_levelsAvg = 0;  // running average level in Q16
+  Parameter<float> m_agcSpeed{"Normalization.agcSpeed", 0.01f, 0.0f, 1.0f}; // The speed of the "Automatic Gain Control" mechanism [0,1]
+  int32_t m_agcSpeedQ16 = toQ(0.01f, 16);                                     // m_agcSpeed in Q16
 };
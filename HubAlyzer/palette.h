@@ -0,0 +1,100 @@
+#pragma once
+
+#include "color.h"
+
+#include <cstdint>
+#include <initializer_list>
+
+// 256-entry color gradient that is built once and looked up with an 8-bit index.
+// Rotate a palette by adding an offset to the index. The index wraps around, so rotation is free
+class Palette
+{
+public:
+    static constexpr unsigned SIZE = 256;
+
+    // Color at a palette index for building gradients
+    struct Stop
+    {
+        uint8_t index;
+        RGBf color;
+    };
+
+    /// @brief Build palette as a ramp through the HSV hue circle
+    static auto hsvRamp(float hueStart = 0.0F, float hueEnd = 1.0F, float saturation = 1.0F, float value = 1.0F) -> Palette
+    {
+        Palette palette;
+        for (unsigned i = 0; i < SIZE; i++)
+        {
+            auto hue = hueStart + (hueEnd - hueStart) * static_cast<float>(i) / (SIZE - 1);
+            hue -= static_cast<int>(hue);
+            palette.m_colors[i] = RGBf(HSVf(hue, saturation, value));
+        }
+        return palette;
+    }
+
+    /// @brief Build palette by linearly interpolating between color stops
+    /// @p stops Color stops sorted by index. Colors before the first and after the last stop are constant
+    static auto fromStops(std::initializer_list<Stop> stops) -> Palette
+    {
+        Palette palette;
+        const Stop *previous = nullptr;
+        for (const auto &stop : stops)
+        {
+            const unsigned first = previous != nullptr ? previous->index : 0;
+            for (unsigned i = first; i <= stop.index; i++)
+            {
+                const float t = previous != nullptr && stop.index > previous->index ? static_cast<float>(i - previous->index) / (stop.index - previous->index) : 1.0F;
+                palette.m_colors[i] = previous != nullptr ? lerp(previous->color, stop.color, t) : stop.color;
+            }
+            previous = &stop;
+        }
+        for (unsigned i = previous != nullptr ? previous->index + 1 : 0; i < SIZE; i++)
+        {
+            palette.m_colors[i] = previous != nullptr ? previous->color : RGBf(0, 0, 0);
+        }
+        return palette;
+    }
+
+    /// @brief Get color at index
+    auto operator[](uint8_t index) const -> const RGBf &
+    {
+        return m_colors[index];
+    }
+
+    /// @brief Get color at index scaled by brightness. Same as changing the HSV value of the color
+    auto at(uint8_t index, float brightness) const -> RGBf
+    {
+        const auto &color = m_colors[index];
+        return RGBf(brightness * color.r, brightness * color.g, brightness * color.b);
+    }
+
+private:
+    RGBf m_colors[SIZE];
+};
+
+// Shared palettes. Each one is built on first use
+namespace Palettes
+{
+
+    // Full hue circle, red to red
+    inline auto rainbow() -> const Palette &
+    {
+        static const Palette palette = Palette::hsvRamp();
+        return palette;
+    }
+
+    // Black to red to yellow to white
+    inline auto fire() -> const Palette &
+    {
+        static const Palette palette = Palette::fromStops({{0, RGBf(0, 0, 0)}, {96, RGBf(1, 0, 0)}, {192, RGBf(1, 1, 0)}, {255, RGBf(1, 1, 1)}});
+        return palette;
+    }
+
+    // Dark blue to cyan to white
+    inline auto ice() -> const Palette &
+    {
+        static const Palette palette = Palette::fromStops({{0, RGBf(0, 0, 0.2F)}, {128, RGBf(0, 0.8F, 1)}, {255, RGBf(1, 1, 1)}});
+        return palette;
+    }
+
+}
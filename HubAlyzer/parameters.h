@@ -0,0 +1,215 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+class ParameterRegistry;
+
+// Named tuning value with a range that can be changed at runtime, e.g. from serial or Bluetooth without reflashing.
+// Any task can set() a new value. The owner picks it up with update() at a frame or block boundary and reads the
+// same value() until the next update(), so values never change in the middle of a frame.
+// Values are handed over in a single atomic slot, so updates are tear-free, lock-free and need no heap
+class ParameterBase
+{
+public:
+    ParameterBase(const ParameterBase &) = delete;
+    ParameterBase &operator=(const ParameterBase &) = delete;
+
+    /// @brief Parameter name, e.g. "Spectrum.smoothing"
+    const char *name() const
+    {
+        return m_name;
+    }
+
+    /// @brief Set new value. Can be called from any task. The value is clamped to the parameter range. NaN is ignored
+    virtual void set(float value) = 0;
+
+    /// @brief Last value set as float. Can be called from any task
+    virtual float get() const = 0;
+
+    /// @brief Minimum value as float
+    virtual float minimum() const = 0;
+
+    /// @brief Maximum value as float
+    virtual float maximum() const = 0;
+
+    /// @brief Next parameter in registry or nullptr
+    const ParameterBase *next() const
+    {
+        return m_next;
+    }
+
+protected:
+    ParameterBase(const char *name);
+    ~ParameterBase();
+
+    std::atomic<bool> m_changed{false}; // Set by set(), cleared by update() of the owner
+
+private:
+    friend class ParameterRegistry;
+
+    const char *m_name = "";
+    ParameterBase *m_next = nullptr;
+};
+
+// List of all parameters, so they can be found by name. Parameters add themselves when they are constructed.
+// Adding and removing parameters is not thread-safe. Construct all parameters at boot before other tasks access the registry
+class ParameterRegistry
+{
+public:
+    /// @brief Registry all parameters are added to
+    static ParameterRegistry &instance()
+    {
+        static ParameterRegistry registry;
+        return registry;
+    }
+
+    /// @brief First parameter or nullptr. Use ParameterBase::next() to iterate
+    const ParameterBase *first() const
+    {
+        return m_first;
+    }
+
+    /// @brief Set value of all parameters with name, e.g. the same parameter of effects in different presets
+    /// @return Returns the number of parameters changed
+    unsigned set(const char *name, float value)
+    {
+        unsigned count = 0;
+        for (auto parameter = m_first; parameter != nullptr; parameter = parameter->m_next)
+        {
+            if (strcmp(parameter->m_name, name) == 0)
+            {
+                parameter->set(value);
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    friend class ParameterBase;
+
+    void add(ParameterBase *parameter)
+    {
+        // append, so parameters are listed in construction order
+        auto link = &m_first;
+        while (*link != nullptr)
+        {
+            link = &(*link)->m_next;
+        }
+        *link = parameter;
+    }
+
+    void remove(ParameterBase *parameter)
+    {
+        for (auto link = &m_first; *link != nullptr; link = &(*link)->m_next)
+        {
+            if (*link == parameter)
+            {
+                *link = parameter->m_next;
+                return;
+            }
+        }
+    }
+
+    ParameterBase *m_first = nullptr;
+};
+
+inline ParameterBase::ParameterBase(const char *name)
+    : m_name(name)
+{
+    ParameterRegistry::instance().add(this);
+}
+
+inline ParameterBase::~ParameterBase()
+{
+    ParameterRegistry::instance().remove(this);
+}
+
+// Typed parameter. Read with value() in the owner task and pick up new values with update().
+// update() costs a single relaxed atomic load if nothing changed
+// T = float, int32_t or bool
+template <typename T>
+class Parameter : public ParameterBase
+{
+    static_assert(std::is_same<T, float>::value || std::is_same<T, int32_t>::value || std::is_same<T, bool>::value, "Parameters must be float, int32_t or bool");
+
+public:
+    /// @brief Create parameter and add it to the registry
+    /// @p name Parameter name. Must stay valid
+    /// @p value Initial value
+    /// @p minimum Minimum value
+    /// @p maximum Maximum value
+    Parameter(const char *name, T value, T minimum, T maximum)
+        : ParameterBase(name), m_value(value), m_minimum(minimum), m_maximum(maximum), m_slot(value)
+    {
+    }
+
+    /// @brief Value picked up by the last update(). Only call from the owner task
+    T value() const
+    {
+        return m_value;
+    }
+
+    /// @brief Pick up a value set since the last call. Only call from the owner task, e.g. once per frame
+    /// @return Returns true if a new value was set
+    bool update()
+    {
+        if (!m_changed.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+        m_changed.exchange(false, std::memory_order_acquire);
+        m_value = m_slot.load(std::memory_order_relaxed);
+        return true;
+    }
+
+    virtual void set(float value) override
+    {
+        // NaN fails every comparison, so it would pass the clamping below
+        if (std::isnan(value))
+        {
+            return;
+        }
+        T converted;
+        if constexpr (std::is_same<T, float>::value)
+        {
+            converted = value;
+        }
+        else if constexpr (std::is_same<T, int32_t>::value)
+        {
+            converted = static_cast<int32_t>(std::lround(value));
+        }
+        else
+        {
+            converted = value != 0.0F;
+        }
+        converted = converted < m_minimum ? m_minimum : (converted > m_maximum ? m_maximum : converted);
+        m_slot.store(converted, std::memory_order_relaxed);
+        m_changed.store(true, std::memory_order_release);
+    }
+
+    virtual float get() const override
+    {
+        return static_cast<float>(m_slot.load(std::memory_order_relaxed));
+    }
+
+    virtual float minimum() const override
+    {
+        return static_cast<float>(m_minimum);
+    }
+
+    virtual float maximum() const override
+    {
+        return static_cast<float>(m_maximum);
+    }
+
+private:
+    T m_value;
+    T m_minimum;
+    T m_maximum;
+    std::atomic<T> m_slot; // Last value set
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cycle_counter.h"
+#include "effects_particles.h"
+#include "serial_printf.h"
+
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+// Benchmark for the particle effect. Call from setup() to print results to the serial port.
+// Feeds analysis frames with all bands at their peak and a beat every BEAT_INTERVAL_MS, then measures update and
+// render time per frame, compares it to the frame budget and reports how many particles did not fit into the pool.
+// Also runs on the host, see test/particles_check_test.cpp, where it measures nanoseconds instead of cycles.
+// Open: The frame budget on the ESP32 has not been measured yet. Only the host numbers back the pool size of the presets,
+// e.g. ~30 us per frame for 2048 particles. Run this on the device before relying on thousands of particles at 64x64
+// WIDTH, HEIGHT = Frame size, e.g. 64x64
+// NR_OF_BANDS = Number of spectrum bands
+// RATE_HZ = Render rate that defines the frame budget
+// BEAT_INTERVAL_MS = Time between beats, e.g. 500 for 120 BPM
+template <unsigned WIDTH, unsigned HEIGHT, unsigned NR_OF_BANDS, unsigned RATE_HZ, unsigned BEAT_INTERVAL_MS = 500>
+class ParticlesCheck
+{
+    static constexpr unsigned NR_OF_WARMUP_FRAMES = 3 * RATE_HZ; // Frames to fill the particle pool
+    static constexpr unsigned NR_OF_FRAMES = 2 * RATE_HZ;        // Frames to measure
+    static constexpr unsigned BeatFrames = BEAT_INTERVAL_MS * RATE_HZ / 1000 > 1 ? BEAT_INTERVAL_MS * RATE_HZ / 1000 : 2;
+    static constexpr float Dt = 1.0F / RATE_HZ;
+
+public:
+    /// @brief Measure update and render time for CAPACITY particles
+    /// @p level Level of all bands, e.g. 1 for the worst case
+    /// @return Returns the number of particles dropped per second because the pool was full
+    template <unsigned CAPACITY>
+    static uint32_t run(float level = 1.0F)
+    {
+        auto particles = std::unique_ptr<Effects::Particles<WIDTH, HEIGHT, NR_OF_BANDS, CAPACITY>>(new Effects::Particles<WIDTH, HEIGHT, NR_OF_BANDS, CAPACITY>());
+        auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+        std::vector<RGBf> pixels(WIDTH * HEIGHT);
+        const Strip strip = {pixels.data(), pixels.data(), WIDTH, HEIGHT, 0, HEIGHT, 0, HEIGHT};
+        frame->nrOfBands = NR_OF_BANDS;
+        for (unsigned band = 0; band < NR_OF_BANDS; band++)
+        {
+            frame->levels[band] = level;
+            frame->peaks[band] = level;
+        }
+        for (unsigned i = 0; i < NR_OF_WARMUP_FRAMES; i++)
+        {
+            frame->isBeat = i % BeatFrames == 0;
+            particles->prepare(Dt, *frame);
+        }
+        const uint32_t warmupDropped = particles->dropped();
+        uint32_t prepareCycles = 0;
+        uint32_t renderCycles = 0;
+        unsigned count = 0;
+        unsigned maxCount = 0;
+        for (unsigned i = 0; i < NR_OF_FRAMES; i++)
+        {
+            frame->isBeat = i % BeatFrames == 0;
+            auto start = CycleCounter::now();
+            particles->prepare(Dt, *frame);
+            prepareCycles += CycleCounter::now() - start;
+            count += particles->size();
+            maxCount = particles->size() > maxCount ? particles->size() : maxCount;
+            start = CycleCounter::now();
+            particles->render(strip, *frame);
+            renderCycles += CycleCounter::now() - start;
+        }
+        const uint32_t budgetCycles = CycleCounter::perSecond() / RATE_HZ;
+        const uint32_t cycles = (prepareCycles + renderCycles) / NR_OF_FRAMES;
+        const uint32_t droppedPerSecond = (particles->dropped() - warmupDropped) * RATE_HZ / NR_OF_FRAMES;
+        Serial_printf("Particles %dx%d, level %.1f, pool of %d: %d live, max. %d, %l dropped / s, update %l, render %l %s / frame -> %.1f%% of frame budget @ %d Hz\n", WIDTH, HEIGHT, level,
+                      CAPACITY, count / NR_OF_FRAMES, maxCount, static_cast<long>(droppedPerSecond), static_cast<long>(prepareCycles / NR_OF_FRAMES),
+                      static_cast<long>(renderCycles / NR_OF_FRAMES), CycleCounter::Unit, 100.0F * cycles / budgetCycles, RATE_HZ);
+        return droppedPerSecond;
+    }
+
+    /// @brief Measure a range of pool sizes at full, half and 30% level. PARTICLE_POOL_SIZE in the sketch is chosen to drop nothing at 30%
+    static void runAll()
+    {
+        for (float level : {1.0F, 0.5F, 0.3F})
+        {
+            run<512>(level);
+            run<1024>(level);
+            run<2048>(level);
+            run<4096>(level);
+        }
+    }
+};
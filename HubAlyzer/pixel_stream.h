@@ -0,0 +1,269 @@
+#pragma once
+
+#include "color.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+// Distributed Display Protocol (DDP) constants, see http://www.3waylabs.com/ddp/.
+// Supported by xLights, LedFx, WLED and many lighting desks. A frame is sent as packets of up to 480 RGB pixels.
+// Each packet carries its byte offset in the frame, so packets can be stored in any order. The last packet has the push flag set
+namespace Ddp
+{
+    constexpr uint16_t DEFAULT_PORT = 4048;
+    constexpr unsigned HEADER_SIZE = 10;          // Header size without time code
+    constexpr unsigned TIMECODE_SIZE = 4;         // Extra header bytes if FLAG_TIMECODE is set
+    constexpr unsigned MAX_DATA_SIZE = 1440;      // Maximum payload per packet, 480 RGB pixels
+    constexpr uint8_t VERSION_MASK = 0xC0;
+    constexpr uint8_t VERSION_1 = 0x40;
+    constexpr uint8_t FLAG_TIMECODE = 0x10;
+    constexpr uint8_t FLAG_QUERY = 0x02;
+    constexpr uint8_t FLAG_PUSH = 0x01;
+    constexpr uint8_t SEQUENCE_MASK = 0x0F;       // Sequence number 1-15. 0 if not used
+    constexpr uint8_t TYPE_RGB8 = 0x0B;           // 8-bit RGB pixels
+    constexpr uint8_t ID_DISPLAY = 1;             // Default output device
+    constexpr uint8_t ID_ALL = 255;               // All devices
+}
+
+// Receives DDP pixel frames over UDP. Payloads are received straight from the socket into the frame buffer, e.g. the
+// SmartMatrix back buffer, so pixels are copied only once by the network stack. Returns after each pushed frame, so the
+// caller can swap buffers. Packets missing from a frame keep the pixels of the buffer and are counted. Uses BSD sockets,
+// so it also runs on a Linux host. On the ESP32 CONFIG_LWIP_UDP_RECVMBOX_SIZE should hold at least one frame of packets
+template <int WIDTH, int HEIGHT>
+class PixelStreamReceiver
+{
+public:
+    static constexpr unsigned FRAME_SIZE = WIDTH * HEIGHT * sizeof(RGB8); // Frame size in bytes
+
+    ~PixelStreamReceiver()
+    {
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    /// @brief Open socket
+    /// @p port UDP port to listen on
+    /// @return Returns false if the socket could not be opened
+    bool begin(uint16_t port = Ddp::DEFAULT_PORT)
+    {
+        m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        // buffer a few frames, so packets are not dropped while the caller swaps buffers. Not supported everywhere
+        const int bufferSize = 4 * FRAME_SIZE;
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(m_socket, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) < 0)
+        {
+            close(m_socket);
+            m_socket = -1;
+            return false;
+        }
+        fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+        return true;
+    }
+
+    /// @brief Wait until a packet arrives or the timeout expires
+    /// @return Returns true if a packet can be received
+    bool wait(uint32_t timeoutMs)
+    {
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(m_socket, &sockets);
+        timeval timeout = {static_cast<decltype(timeout.tv_sec)>(timeoutMs / 1000), static_cast<decltype(timeout.tv_usec)>((timeoutMs % 1000) * 1000)};
+        return select(m_socket + 1, &sockets, nullptr, nullptr, &timeout) > 0;
+    }
+
+    /// @brief Receive pending packets into frame without blocking until a frame is pushed.
+    /// Call again with the same frame until it returns true, then swap buffers and continue with the next frame
+    /// @p frame Frame of WIDTH * HEIGHT pixels stored row by row
+    /// @return Returns true if the sender pushed the frame, false if no more packets are pending
+    bool receive(RGB8 *frame)
+    {
+        while (m_socket >= 0)
+        {
+            // peek at the header to find where the payload goes
+            uint8_t header[Ddp::HEADER_SIZE + Ddp::TIMECODE_SIZE] = {};
+            const auto peeked = recv(m_socket, header, sizeof(header), MSG_PEEK | MSG_DONTWAIT);
+            if (peeked <= 0)
+            {
+                return false;
+            }
+            const unsigned headerSize = Ddp::HEADER_SIZE + ((header[0] & Ddp::FLAG_TIMECODE) != 0 ? Ddp::TIMECODE_SIZE : 0);
+            const uint32_t offset = (static_cast<uint32_t>(header[4]) << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+            const unsigned length = (header[8] << 8) | header[9];
+            if (static_cast<unsigned>(peeked) < headerSize || (header[0] & Ddp::VERSION_MASK) != Ddp::VERSION_1 || (header[0] & Ddp::FLAG_QUERY) != 0 ||
+                header[2] != Ddp::TYPE_RGB8 || (header[3] != Ddp::ID_DISPLAY && header[3] != Ddp::ID_ALL) || offset >= FRAME_SIZE)
+            {
+                // drop packet
+                recv(m_socket, header, sizeof(header), MSG_DONTWAIT);
+                m_invalidPackets++;
+                continue;
+            }
+            // receive header and payload in one go, clipping the payload to the frame
+            iovec parts[2];
+            parts[0].iov_base = header;
+            parts[0].iov_len = headerSize;
+            parts[1].iov_base = reinterpret_cast<uint8_t *>(frame) + offset;
+            parts[1].iov_len = length < FRAME_SIZE - offset ? length : FRAME_SIZE - offset;
+            msghdr message = {};
+            message.msg_iov = parts;
+            message.msg_iovlen = 2;
+            const auto size = recvmsg(m_socket, &message, MSG_DONTWAIT);
+            if (size < static_cast<ssize_t>(headerSize))
+            {
+                return false;
+            }
+            m_frameBytes += size - headerSize;
+            // sequence numbers 1-15 wrap to 1. 0 means the sender does not use them
+            const uint8_t sequence = header[1] & Ddp::SEQUENCE_MASK;
+            if (sequence != 0 && m_lastSequence != 0)
+            {
+                const uint8_t expected = m_lastSequence == 15 ? 1 : m_lastSequence + 1;
+                m_lostPackets += sequence >= expected ? sequence - expected : sequence + 15 - expected;
+            }
+            m_lastSequence = sequence;
+            if ((header[0] & Ddp::FLAG_PUSH) != 0)
+            {
+                m_frames++;
+                m_incompleteFrames += m_frameBytes < FRAME_SIZE ? 1 : 0;
+                m_frameBytes = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Number of frames pushed
+    uint32_t frames() const
+    {
+        return m_frames;
+    }
+
+    /// @brief Number of frames pushed with less than FRAME_SIZE bytes, e.g. because packets were lost
+    uint32_t incompleteFrames() const
+    {
+        return m_incompleteFrames;
+    }
+
+    /// @brief Number of packets lost, i.e. sequence gaps. Gaps of 15 or more packets are not detected
+    uint32_t lostPackets() const
+    {
+        return m_lostPackets;
+    }
+
+    /// @brief Number of packets dropped because they were no 8-bit RGB pixel data for this display
+    uint32_t invalidPackets() const
+    {
+        return m_invalidPackets;
+    }
+
+private:
+    int m_socket = -1;
+    unsigned m_frameBytes = 0; // Payload bytes received since the last push
+    uint8_t m_lastSequence = 0;
+    uint32_t m_frames = 0;
+    uint32_t m_incompleteFrames = 0;
+    uint32_t m_lostPackets = 0;
+    uint32_t m_invalidPackets = 0;
+};
+
+// Sends pixel frames as DDP packets, e.g. to mirror a matrix to other matrices or to test a PixelStreamReceiver on a host.
+// Packets are gathered from a header and the frame buffer, so pixels are not copied
+class PixelStreamSender
+{
+public:
+    ~PixelStreamSender()
+    {
+        if (m_socket >= 0)
+        {
+            close(m_socket);
+        }
+    }
+
+    /// @brief Open socket
+    /// @p address IPv4 address of the receiver, e.g. "127.0.0.1" for tests
+    /// @p port Destination UDP port
+    /// @return Returns false if the socket could not be opened
+    bool begin(const char *address, uint16_t port = Ddp::DEFAULT_PORT)
+    {
+        m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        memset(&m_destination, 0, sizeof(m_destination));
+        m_destination.sin_family = AF_INET;
+        m_destination.sin_port = htons(port);
+        m_destination.sin_addr.s_addr = inet_addr(address);
+        return true;
+    }
+
+    /// @brief Send frame and push it
+    /// @p frame Pixels stored row by row
+    /// @p count Number of pixels
+    /// @return Returns false if a packet could not be sent
+    bool send(const RGB8 *frame, unsigned count)
+    {
+        if (m_socket < 0)
+        {
+            return false;
+        }
+        const unsigned size = count * sizeof(RGB8);
+        for (unsigned offset = 0; offset < size; offset += Ddp::MAX_DATA_SIZE)
+        {
+            const unsigned length = size - offset < Ddp::MAX_DATA_SIZE ? size - offset : Ddp::MAX_DATA_SIZE;
+            m_sequence = m_sequence >= 15 ? 1 : m_sequence + 1;
+            uint8_t header[Ddp::HEADER_SIZE];
+            header[0] = Ddp::VERSION_1 | (offset + length >= size ? Ddp::FLAG_PUSH : 0);
+            header[1] = m_sequence;
+            header[2] = Ddp::TYPE_RGB8;
+            header[3] = Ddp::ID_DISPLAY;
+            header[4] = offset >> 24;
+            header[5] = offset >> 16;
+            header[6] = offset >> 8;
+            header[7] = offset;
+            header[8] = length >> 8;
+            header[9] = length;
+            iovec parts[2];
+            parts[0].iov_base = header;
+            parts[0].iov_len = sizeof(header);
+            parts[1].iov_base = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(frame) + offset);
+            parts[1].iov_len = length;
+            msghdr message = {};
+            message.msg_name = &m_destination;
+            message.msg_namelen = sizeof(m_destination);
+            message.msg_iov = parts;
+            message.msg_iovlen = 2;
+            if (sendmsg(m_socket, &message, 0) != static_cast<ssize_t>(sizeof(header) + length))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int m_socket = -1;
+    sockaddr_in m_destination = {};
+    uint8_t m_sequence = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "arena.h"
+#include "effect.h"
+
+#include <initializer_list>
+
+// Library of effect chains that can be switched at runtime.
+// All effects are constructed into an arena when presets are built at boot, so switching never touches the heap.
+// MAX_PRESETS = Maximum number of presets
+// ARENA_SIZE = Size of memory for effect objects in bytes
+template <unsigned MAX_PRESETS = 16, size_t ARENA_SIZE = 4096>
+class PresetLibrary
+{
+public:
+    /// @brief Construct a new effect in the preset arena
+    /// @return Returns a pointer to the effect or nullptr if the arena is full
+    template <typename T, typename... ARGS>
+    auto create(ARGS &&...args) -> T *
+    {
+        return m_arena.template create<T>(std::forward<ARGS>(args)...);
+    }
+
+    /// @brief Add a preset from effects created with create()
+    /// @p name Preset name. Must stay valid
+    /// @p effects Effects in render order
+    /// @return Returns the new preset or nullptr if the library is full, there are too many effects or an effect is nullptr
+    auto add(const char *name, std::initializer_list<Effect *> effects) -> const EffectChain *
+    {
+        if (m_count >= MAX_PRESETS || effects.size() > EffectChain::MAX_EFFECTS)
+        {
+            return nullptr;
+        }
+        auto &chain = m_presets[m_count];
+        chain.name = name;
+        chain.count = 0;
+        for (auto effect : effects)
+        {
+            if (effect == nullptr)
+            {
+                return nullptr;
+            }
+            chain.effects[chain.count++] = effect;
+        }
+        return &m_presets[m_count++];
+    }
+
+    /// @brief Number of presets in library
+    auto size() const -> unsigned
+    {
+        return m_count;
+    }
+
+    /// @brief Get preset by index
+    auto operator[](unsigned index) const -> const EffectChain *
+    {
+        return index < m_count ? &m_presets[index] : nullptr;
+    }
+
+    /// @brief Get index of preset or size() if it is not in this library
+    auto indexOf(const EffectChain *chain) const -> unsigned
+    {
+        return chain >= m_presets && chain < m_presets + m_count ? static_cast<unsigned>(chain - m_presets) : m_count;
+    }
+
+    /// @brief Arena the effects are allocated from, e.g. to report memory usage
+    auto arena() const -> const Arena<ARENA_SIZE> &
+    {
+        return m_arena;
+    }
+
+private:
+    Arena<ARENA_SIZE> m_arena;
+    EffectChain m_presets[MAX_PRESETS];
+    unsigned m_count = 0;
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "color.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+// Triangle and line rasterizer drawing straight into RGBf frame buffers.
+// Vertices are snapped to 1/16 pixel. Edge values are stepped with integers in 16.16 pixels,
+// and only the pixels covered by a primitive (plus a 1 pixel anti-aliasing fringe) are visited.
+// Pixel (x, y) covers [x, x+1) x [y, y+1), so its center is at (x + 0.5, y + 0.5)
+namespace Raster
+{
+
+    // Frame buffer rows to draw to. Only rows [firstRow, endRow) are written, e.g. the rows of a Strip
+    struct Canvas
+    {
+        RGBf *pixels = nullptr; // Row firstRow of frame buffer
+        int width = 0;
+        int firstRow = 0;
+        int endRow = 0;
+    };
+
+    enum class Blend
+    {
+        Replace, // Blend color over destination using coverage
+        Add      // Add color * coverage to destination and clamp to 1
+    };
+
+    namespace Detail
+    {
+        static constexpr int SubpixelBits = 4;                  // Vertex precision 1/16 pixel
+        static constexpr float SubpixelScale = 1 << SubpixelBits;
+        static constexpr float MaxCoordinate = 4096.0F;         // Larger coordinates are clamped to keep edge values in 32 bit
+        static constexpr int32_t One = 1 << 16;                 // 1.0 in 16.16 fixed-point
+
+        inline auto toSubpixel(float v) -> int32_t
+        {
+            v = v < -MaxCoordinate ? -MaxCoordinate : (v > MaxCoordinate ? MaxCoordinate : v);
+            return static_cast<int32_t>(std::lround(v * SubpixelScale));
+        }
+
+        inline auto floorDiv(int32_t a, int32_t b) -> int32_t
+        {
+            int32_t q = a / b;
+            return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+        }
+
+        // Blend color into pixel with coverage in 16.16
+        template <Blend BLEND>
+        inline auto plot(RGBf &dest, const RGBf &color, int32_t coverage) -> void
+        {
+            const float c = static_cast<float>(coverage) * (1.0F / One);
+            if constexpr (BLEND == Blend::Add)
+            {
+                const float r = dest.r + c * color.r;
+                const float g = dest.g + c * color.g;
+                const float b = dest.b + c * color.b;
+                dest.r = r > 1.0F ? 1.0F : r;
+                dest.g = g > 1.0F ? 1.0F : g;
+                dest.b = b > 1.0F ? 1.0F : b;
+            }
+            else
+            {
+                dest.r += c * (color.r - dest.r);
+                dest.g += c * (color.g - dest.g);
+                dest.b += c * (color.b - dest.b);
+            }
+        }
+
+        template <Blend BLEND>
+        inline auto plotClipped(const Canvas &canvas, int x, int y, const RGBf &color, int32_t coverage) -> void
+        {
+            if (x >= 0 && x < canvas.width && y >= canvas.firstRow && y < canvas.endRow && coverage > 0)
+            {
+                plot<BLEND>(canvas.pixels[(y - canvas.firstRow) * canvas.width + x], color, coverage);
+            }
+        }
+    }
+
+    /// @brief Fill a triangle. Vertices can be in any order
+    /// ANTIALIAS = If true edge pixels are blended by the approximate area covered
+    /// BLEND = How to combine color with frame buffer
+    template <bool ANTIALIAS = true, Blend BLEND = Blend::Add>
+    auto fillTriangle(const Canvas &canvas, float x0, float y0, float x1, float y1, float x2, float y2, const RGBf &color) -> void
+    {
+        using namespace Detail;
+        const int32_t vx[3] = {toSubpixel(x0), toSubpixel(x1), toSubpixel(x2)};
+        const int32_t vy[3] = {toSubpixel(y0), toSubpixel(y1), toSubpixel(y2)};
+        const int64_t area = static_cast<int64_t>(vx[1] - vx[0]) * (vy[2] - vy[0]) - static_cast<int64_t>(vy[1] - vy[0]) * (vx[2] - vx[0]);
+        if (area == 0)
+        {
+            return;
+        }
+        // Set up edge functions as signed distance to the edge in 16.16 pixels, positive inside.
+        // Values are for pixel centers, so pixel (x, y) has value stepX * x + stepY * y + start
+        int32_t stepX[3];
+        int32_t stepY[3];
+        int32_t start[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const int a = i;
+            const int b = i == 2 ? 0 : i + 1;
+            const int32_t ex = -(vy[b] - vy[a]);
+            const int32_t ey = vx[b] - vx[a];
+            const int64_t c = -(static_cast<int64_t>(ex) * vx[a] + static_cast<int64_t>(ey) * vy[a]);
+            const float length = std::sqrt(static_cast<float>(ex) * ex + static_cast<float>(ey) * ey);
+            const float scale = (area > 0 ? 1.0F : -1.0F) * One / length;
+            stepX[i] = static_cast<int32_t>(std::lround(ex * scale));
+            stepY[i] = static_cast<int32_t>(std::lround(ey * scale));
+            start[i] = static_cast<int32_t>(std::lround(static_cast<float>((ex + ey) * (1 << (SubpixelBits - 1)) + c) * scale * (1.0F / SubpixelScale)));
+        }
+        // Pixels with a center at most half a pixel outside all edges are touched when anti-aliasing.
+        // Without anti-aliasing the top-left rule applies: centers exactly on an edge are only inside for top and left edges,
+        // so triangles sharing an edge never draw a pixel twice. Edge values of a shared edge are exact negatives of each other
+        int32_t limit[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const bool topLeft = stepX[i] > 0 || (stepX[i] == 0 && stepY[i] > 0);
+            limit[i] = ANTIALIAS ? -One / 2 : (topLeft ? -1 : 0);
+        }
+        const int32_t minY = vy[0] < vy[1] ? (vy[0] < vy[2] ? vy[0] : vy[2]) : (vy[1] < vy[2] ? vy[1] : vy[2]);
+        const int32_t maxY = vy[0] > vy[1] ? (vy[0] > vy[2] ? vy[0] : vy[2]) : (vy[1] > vy[2] ? vy[1] : vy[2]);
+        int yStart = (minY >> SubpixelBits) - (ANTIALIAS ? 1 : 0);
+        int yEnd = (maxY >> SubpixelBits) + (ANTIALIAS ? 2 : 1);
+        yStart = yStart < canvas.firstRow ? canvas.firstRow : yStart;
+        yEnd = yEnd > canvas.endRow ? canvas.endRow : yEnd;
+        for (int y = yStart; y < yEnd; y++)
+        {
+            // find span of row where all edge values are > limit
+            int xStart = 0;
+            int xEnd = canvas.width - 1;
+            int32_t row[3];
+            for (int i = 0; i < 3; i++)
+            {
+                row[i] = stepY[i] * y + start[i];
+                if (stepX[i] > 0)
+                {
+                    const int x = floorDiv(limit[i] - row[i], stepX[i]) + 1;
+                    xStart = x > xStart ? x : xStart;
+                }
+                else if (stepX[i] < 0)
+                {
+                    const int x = -floorDiv(row[i] - limit[i], stepX[i]) - 1;
+                    xEnd = x < xEnd ? x : xEnd;
+                }
+                else if (row[i] <= limit[i])
+                {
+                    xEnd = -1;
+                }
+            }
+            if (xStart > xEnd)
+            {
+                continue;
+            }
+            int32_t d0 = stepX[0] * xStart + row[0];
+            int32_t d1 = stepX[1] * xStart + row[1];
+            int32_t d2 = stepX[2] * xStart + row[2];
+            auto dest = canvas.pixels + (y - canvas.firstRow) * canvas.width + xStart;
+            for (int x = xStart; x <= xEnd; x++)
+            {
+                if constexpr (ANTIALIAS)
+                {
+                    // coverage from distance to the closest edge
+                    int32_t d = d0 < d1 ? d0 : d1;
+                    d = d < d2 ? d : d2;
+                    d += One / 2;
+                    plot<BLEND>(*dest, color, d > One ? One : d);
+                }
+                else
+                {
+                    plot<BLEND>(*dest, color, One);
+                }
+                dest++;
+                d0 += stepX[0];
+                d1 += stepX[1];
+                d2 += stepX[2];
+            }
+        }
+    }
+
+    /// @brief Draw a 1 pixel wide line. Anti-aliased lines use Xiaolin Wu's algorithm
+    /// ANTIALIAS = If true the line is spread over two pixels by subpixel position
+    /// BLEND = How to combine color with frame buffer
+    template <bool ANTIALIAS = true, Blend BLEND = Blend::Add>
+    auto drawLine(const Canvas &canvas, float x0, float y0, float x1, float y1, const RGBf &color) -> void
+    {
+        using namespace Detail;
+        // work in 16.16 relative to pixel centers
+        int32_t ax = toSubpixel(x0 - 0.5F) << (16 - SubpixelBits);
+        int32_t ay = toSubpixel(y0 - 0.5F) << (16 - SubpixelBits);
+        int32_t bx = toSubpixel(x1 - 0.5F) << (16 - SubpixelBits);
+        int32_t by = toSubpixel(y1 - 0.5F) << (16 - SubpixelBits);
+        const bool steep = std::abs(by - ay) > std::abs(bx - ax);
+        if (steep)
+        {
+            std::swap(ax, ay);
+            std::swap(bx, by);
+        }
+        if (ax > bx)
+        {
+            std::swap(ax, bx);
+            std::swap(ay, by);
+        }
+        const int32_t dx = bx - ax;
+        const int32_t dy = by - ay;
+        const int32_t gradient = dx > 0 ? static_cast<int32_t>((static_cast<int64_t>(dy) << 16) / dx) : 0;
+        // start at first pixel center on major axis
+        const int xStart = (ax + One / 2) >> 16;
+        const int xEnd = (bx + One / 2) >> 16;
+        int32_t y = ay + static_cast<int32_t>((static_cast<int64_t>((xStart << 16) - ax) * gradient) >> 16);
+        for (int x = xStart; x <= xEnd; x++)
+        {
+            if constexpr (ANTIALIAS)
+            {
+                const int yi = y >> 16;
+                const int32_t fraction = y & (One - 1);
+                if (steep)
+                {
+                    plotClipped<BLEND>(canvas, yi, x, color, One - fraction);
+                    plotClipped<BLEND>(canvas, yi + 1, x, color, fraction);
+                }
+                else
+                {
+                    plotClipped<BLEND>(canvas, x, yi, color, One - fraction);
+                    plotClipped<BLEND>(canvas, x, yi + 1, color, fraction);
+                }
+            }
+            else
+            {
+                const int yi = (y + One / 2) >> 16;
+                if (steep)
+                {
+                    plotClipped<BLEND>(canvas, yi, x, color, One);
+                }
+                else
+                {
+                    plotClipped<BLEND>(canvas, x, yi, color, One);
+                }
+            }
+            y += gradient;
+        }
+    }
+
+}
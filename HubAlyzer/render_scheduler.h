@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cmath>
+#include <functional>
+
+#include "histogram.h"
+#include "logging.h"
+
+// Calls a render function from its own task at a fixed frame rate, independent of audio block arrival.
+// Frames are scheduled with vTaskDelayUntil. Frame periods that are not a whole number of ticks alternate
+// between the neighbouring tick counts, so the average rate is exact. Frame interval jitter is measured,
+// including p50 and p99 from a histogram of 50us buckets.
+// RATE_HZ = Frames per second, e.g. 60, 100 or 120
+template <unsigned RATE_HZ>
+class RenderScheduler
+{
+    static constexpr unsigned TASK_STACK = 8192;                            // FreeRTOS stack size (in 32-bit words)
+    static constexpr uint32_t PERIOD_US = 1000000 / RATE_HZ;                // Frame period in microseconds
+    static constexpr uint32_t US_PER_TICK = 1000 * portTICK_PERIOD_MS;      // FreeRTOS tick period in microseconds
+    static constexpr unsigned NR_OF_JITTER_BUCKETS = 64;                    // Jitter histogram buckets. Jitter above 3.2ms is counted in the last one
+    static constexpr uint32_t JITTER_BUCKET_US = 50;                        // Jitter histogram bucket width in microseconds
+
+public:
+    /// @brief Render function. Gets the time since the last frame in seconds
+    using RenderFunction = std::function<void(float dt)>;
+
+    /// @brief Frame timing since the last call to printStatistics()
+    struct Statistics
+    {
+        uint32_t frames = 0;        // Number of frames rendered
+        uint32_t lateFrames = 0;    // Frames started more than half a period late
+        uint64_t sumJitterUs = 0;   // Sum of |interval - period|
+        uint64_t sumSqJitterUs = 0; // Sum of (interval - period)^2
+        uint32_t maxJitterUs = 0;   // Maximum |interval - period|
+        Histogram<NR_OF_JITTER_BUCKETS, JITTER_BUCKET_US> jitterUs; // Distribution of |interval - period|
+        uint32_t sumRenderUs = 0;   // Time spent in render function
+        uint32_t maxRenderUs = 0;   // Maximum time spent in render function
+    };
+
+    /// @brief Start render task
+    /// @p render Function to call every frame. Called from the render task
+    /// @p core CPU core to run the render task on
+    /// @p priority FreeRTOS priority of the render task. Should be higher than the analysis task, so frames start on time
+    void begin(RenderFunction render, BaseType_t core = 1, UBaseType_t priority = 2)
+    {
+        m_render = render;
+        TaskHandle_t xHandle = nullptr;
+        if (xTaskCreatePinnedToCore(renderTask, "Render", TASK_STACK, this, priority, &xHandle, core) != pdPASS || xHandle == nullptr)
+        {
+            Log::error("Failed to create render task\n");
+        }
+    }
+
+    /// @brief Get frame timing statistics. Only valid in the render task, e.g. from the render function
+    const Statistics &statistics() const
+    {
+        return m_statistics;
+    }
+
+    /// @brief Print frame timing statistics and reset them. Call from the render function
+    void printStatistics()
+    {
+        const auto &s = m_statistics;
+        if (s.frames > 0)
+        {
+            const float meanJitterUs = static_cast<float>(s.sumJitterUs) / s.frames;
+            const float rmsJitterUs = std::sqrt(static_cast<float>(s.sumSqJitterUs) / s.frames);
+            // percentiles are bucket upper bounds, the maximum is exact
+            const uint32_t p50JitterUs = s.jitterUs.percentile(0.5F) < s.maxJitterUs ? s.jitterUs.percentile(0.5F) : s.maxJitterUs;
+            const uint32_t p99JitterUs = s.jitterUs.percentile(0.99F) < s.maxJitterUs ? s.jitterUs.percentile(0.99F) : s.maxJitterUs;
+            Log::info("%d frames @ %d Hz, jitter mean %1f us, rms %1f us, p50 %d us, p99 %d us, max %d us, %d late, render mean %d us, max %d us\n",
+                          static_cast<int>(s.frames), static_cast<int>(RATE_HZ), meanJitterUs, rmsJitterUs, static_cast<int>(p50JitterUs),
+                          static_cast<int>(p99JitterUs), static_cast<int>(s.maxJitterUs),
+                          static_cast<int>(s.lateFrames), static_cast<int>(s.sumRenderUs / s.frames), static_cast<int>(s.maxRenderUs));
+        }
+        m_statistics = Statistics();
+    }
+
+private:
+    static void renderTask(void *parameter)
+    {
+        auto object = reinterpret_cast<RenderScheduler *>(parameter);
+        TickType_t lastWakeTime = xTaskGetTickCount();
+        uint32_t remainderUs = 0;
+        uint32_t lastFrameUs = micros();
+        while (true)
+        {
+            // wait for a whole number of ticks and carry the rest to the next frame
+            remainderUs += PERIOD_US;
+            const TickType_t ticks = remainderUs / US_PER_TICK;
+            remainderUs -= ticks * US_PER_TICK;
+            vTaskDelayUntil(&lastWakeTime, ticks);
+            const uint32_t frameUs = micros();
+            const uint32_t intervalUs = frameUs - lastFrameUs;
+            lastFrameUs = frameUs;
+            object->m_render(static_cast<float>(intervalUs) * 1e-6F);
+            object->updateStatistics(intervalUs, micros() - frameUs);
+        }
+    }
+
+    void updateStatistics(uint32_t intervalUs, uint32_t renderUs)
+    {
+        auto &s = m_statistics;
+        const uint32_t jitterUs = intervalUs > PERIOD_US ? intervalUs - PERIOD_US : PERIOD_US - intervalUs;
+        s.frames++;
+        s.lateFrames += intervalUs > PERIOD_US + PERIOD_US / 2 ? 1 : 0;
+        s.sumJitterUs += jitterUs;
+        s.sumSqJitterUs += static_cast<uint64_t>(jitterUs) * jitterUs;
+        s.maxJitterUs = jitterUs > s.maxJitterUs ? jitterUs : s.maxJitterUs;
+        s.jitterUs.add(jitterUs);
+        s.sumRenderUs += renderUs;
+        s.maxRenderUs = renderUs > s.maxRenderUs ? renderUs : s.maxRenderUs;
+    }
+
+    RenderFunction m_render;
+    Statistics m_statistics;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "logging.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+// Runs jobs in a worker task, usually on the other CPU core, so a frame can be rendered by both cores.
+// The caller starts a job, does its own share of the work and then waits for the worker, which acts as a barrier.
+// Synchronization uses direct task notifications, which are the cheapest FreeRTOS primitive.
+// Host builds, e.g. tests, run jobs in a std::thread with the same start() / wait() protocol instead
+class RowWorker
+{
+    static constexpr unsigned TASK_STACK = 4096; // FreeRTOS stack size (in 32-bit words)
+
+public:
+    // Job function. Gets the context passed to start()
+    using Job = void (*)(void *context);
+
+#ifdef ARDUINO
+    using Core = BaseType_t;
+    using Priority = UBaseType_t;
+#else
+    using Core = int;
+    using Priority = unsigned;
+
+    ~RowWorker()
+    {
+        if (m_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_signal.notify_all();
+            m_thread.join();
+        }
+    }
+#endif
+
+    /// @brief Create worker task
+    /// @p core CPU core to run jobs on. Ignored on hosts
+    /// @p priority FreeRTOS priority of the worker task. Keep it below real-time tasks on the same core, e.g. the microphone reader. Ignored on hosts
+    /// @return Returns false if the task could not be created
+    bool begin(Core core, Priority priority)
+    {
+#ifdef ARDUINO
+        if (xTaskCreatePinnedToCore(workerTask, "Render worker", TASK_STACK, this, priority, &m_worker, core) != pdPASS || m_worker == nullptr)
+        {
+            Log::error("Failed to create render worker task\n");
+            m_worker = nullptr;
+            return false;
+        }
+#else
+        m_thread = std::thread(workerThread, this);
+        m_running = true;
+#endif
+        return true;
+    }
+
+    /// @brief Returns true if the worker task is running and jobs can be started
+    bool isRunning() const
+    {
+#ifdef ARDUINO
+        return m_worker != nullptr;
+#else
+        return m_running;
+#endif
+    }
+
+    /// @brief Start job in worker task. Must be followed by wait() before the next start()
+    void start(Job job, void *context)
+    {
+        m_job = job;
+        m_context = context;
+#ifdef ARDUINO
+        m_caller = xTaskGetCurrentTaskHandle();
+        xTaskNotifyGive(m_worker);
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_started = true;
+        }
+        m_signal.notify_all();
+#endif
+    }
+
+    /// @brief Wait until the job started with start() has finished
+    void wait()
+    {
+#ifdef ARDUINO
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_signal.wait(lock, [this]()
+                      { return !m_started; });
+#endif
+    }
+
+private:
+#ifdef ARDUINO
+    static void workerTask(void *parameter)
+    {
+        auto object = reinterpret_cast<RowWorker *>(parameter);
+        while (true)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            object->m_job(object->m_context);
+            xTaskNotifyGive(object->m_caller);
+        }
+    }
+
+    TaskHandle_t m_worker = nullptr;
+    TaskHandle_t m_caller = nullptr;
+#else
+    static void workerThread(RowWorker *object)
+    {
+        std::unique_lock<std::mutex> lock(object->m_mutex);
+        while (true)
+        {
+            object->m_signal.wait(lock, [object]()
+                                  { return object->m_started || object->m_stop; });
+            if (object->m_stop)
+            {
+                return;
+            }
+            lock.unlock();
+            object->m_job(object->m_context);
+            lock.lock();
+            object->m_started = false;
+            object->m_signal.notify_all();
+        }
+    }
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_signal;
+    bool m_started = false; // Job started and not finished yet. Guarded by m_mutex
+    bool m_stop = false;    // Worker thread must end. Guarded by m_mutex
+    bool m_running = false;
+#endif
+    Job m_job = nullptr;
+    void *m_context = nullptr;
+};
@@ -2,7 +2,9 @@
 
 #include "color.h"
 
+#ifdef ARDUINO
 #include <SmartMatrix.h>
+#endif
 
 // Interface for abstract screens
 class Screen
@@ -11,10 +13,17 @@ public:
     // Blit src buffer to screen back buffer
     virtual void blit(const RGBf *src) = 0;
 
+    // Blit rows [firstRow, endRow) to screen back buffer. src points to row firstRow
+    virtual void blitRows(const RGBf *src, int firstRow, int endRow) = 0;
+
+    // Back buffer to render to directly. Pixels are stored row by row
+    virtual RGB8 *backBuffer() = 0;
+
     // Swap back buffer to display system
     virtual void swap() = 0;
 };
 
+#ifdef ARDUINO
 // Screen implementation for SmartMatrix library screens
 template <int WIDTH, int HEIGHT, unsigned OPTIONS>
 class SMLayerScreen : public Screen
@@ -32,17 +41,26 @@ public:
     }
 
     virtual void blit(const RGBf *src) override
+    {
+        blitRows(src, 0, HEIGHT);
+    }
+
+    virtual void blitRows(const RGBf *src, int firstRow, int endRow) override
     {
         // Convert float buffer to rgb24
-        auto dest = m_layer.backBuffer();
-        for (unsigned i = 0; i < WIDTH * HEIGHT; i++)
+        auto dest = backBuffer() + firstRow * WIDTH;
+        for (int i = 0; i < (endRow - firstRow) * WIDTH; i++)
         {
-            dest[i].red = static_cast<uint8_t>(255.0F * src[i].r);
-            dest[i].green = static_cast<uint8_t>(255.0F * src[i].g);
-            dest[i].blue = static_cast<uint8_t>(255.0F * src[i].b);
+            storePixel(dest[i], src[i]);
         }
     }
 
+    virtual RGB8 *backBuffer() override
+    {
+        static_assert(sizeof(rgb24) == sizeof(RGB8), "rgb24 must be 8-bit RGB");
+        return reinterpret_cast<RGB8 *>(m_layer.backBuffer());
+    }
+
     virtual void swap() override
     {
         m_layer.swapBuffers();
@@ -51,3 +69,4 @@ public:
 private:
     SMLayerBackground<SM_RGB, OPTIONS> &m_layer{};
 };
+#endif
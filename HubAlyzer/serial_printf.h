@@ -1,5 +1,11 @@
 #pragma once
 
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <cstdio>
+#endif
+
 #include <cstdarg>
 
 /*
@@ -32,11 +38,46 @@
  * %%    - escaped percent ("%")
  * Thanks goes to @alw1746 for his %.4f precision enhancement
  */
-void Serial_printf(const char *fmt, ...)
+#ifndef ARDUINO
+// Host builds, e.g. of checks, print to stdout with the same format rules
+constexpr int BIN = 2;
+constexpr int DEC = 10;
+constexpr int HEX = 16;
+
+struct StdoutPrint
 {
-    va_list argv;
-    va_start(argv, fmt);
+    void print(const char *s) { std::fputs(s, stdout); }
+    void print(char c) { std::putchar(c); }
+    void print(double value, int places) { std::printf("%.*f", places, value); }
+    void print(int value, int base) { print(static_cast<long>(value), base); }
+    void print(long value, int base)
+    {
+        if (base == BIN)
+        {
+            const auto bits = static_cast<unsigned long>(value);
+            int bit = 8 * sizeof(bits) - 1;
+            for (; bit > 0 && !(bits >> bit); bit--)
+            {
+            }
+            for (; bit >= 0; bit--)
+            {
+                std::putchar((bits >> bit) & 1 ? '1' : '0');
+            }
+        }
+        else
+        {
+            std::printf(base == HEX ? "%lX" : "%ld", value);
+        }
+    }
+};
+#endif
 
+// Formats fmt to out, taking arguments from args. Lets deferred logging format stored arguments with the same rules.
+// OUTPUT must have print() like Arduino's Print.
+// ARGUMENTS must have int nextInt(), long nextLong(), double nextDouble() and const char *nextString()
+template <typename OUTPUT, typename ARGUMENTS>
+void Serial_format(OUTPUT &out, const char *fmt, ARGUMENTS &args)
+{
     for (int i = 0; fmt[i] != '\0'; i++)
     {
         if (fmt[i] == '%')
@@ -54,46 +95,71 @@ void Serial_printf(const char *fmt, ...)
             switch (fmt[++i])
             {
             case 'B':
-                Serial.print("0b"); // Fall through intended
+                out.print("0b"); // Fall through intended
             case 'b':
-                Serial.print(va_arg(argv, int), BIN);
+                out.print(args.nextInt(), BIN);
                 break;
             case 'c':
-                Serial.print((char)va_arg(argv, int));
+                out.print((char)args.nextInt());
                 break;
             case 'd':
             case 'i':
-                Serial.print(va_arg(argv, int), DEC);
+                out.print(args.nextInt(), DEC);
                 break;
             case 'f':
-                Serial.print(va_arg(argv, double), places);
+                out.print(args.nextDouble(), places);
                 break;
             case 'l':
-                Serial.print(va_arg(argv, long), DEC);
+                out.print(args.nextLong(), DEC);
                 break;
             case 'o':
-                Serial.print(va_arg(argv, int) == 0 ? "off" : "on");
+                out.print(args.nextInt() == 0 ? "off" : "on");
                 break;
             case 's':
-                Serial.print(va_arg(argv, const char *));
+                out.print(args.nextString());
                 break;
             case 'X':
-                Serial.print("0x"); // Fall through intended
+                out.print("0x"); // Fall through intended
             case 'x':
-                Serial.print(va_arg(argv, int), HEX);
+                out.print(args.nextInt(), HEX);
                 break;
             case '%':
-                Serial.print(fmt[i]);
+                out.print(fmt[i]);
                 break;
             default:
-                Serial.print("?");
+                out.print("?");
                 break;
             }
         }
         else
         {
-            Serial.print(fmt[i]);
+            out.print(fmt[i]);
         }
     }
+}
+
+// Arguments of Serial_printf
+struct VaListArguments
+{
+    va_list &argv;
+
+    int nextInt() { return va_arg(argv, int); }
+    long nextLong() { return va_arg(argv, long); }
+    double nextDouble() { return va_arg(argv, double); }
+    const char *nextString() { return va_arg(argv, const char *); }
+};
+
+// Formats and prints on the calling task. Blocks while the UART is busy. Use Log functions from timing-critical tasks
+void Serial_printf(const char *fmt, ...)
+{
+    va_list argv;
+    va_start(argv, fmt);
+    VaListArguments args{argv};
+#ifdef ARDUINO
+    Serial_format(Serial, fmt, args);
+#else
+    StdoutPrint out;
+    Serial_format(out, fmt, args);
+#endif
     va_end(argv);
-}
\ No newline at end of file
+}
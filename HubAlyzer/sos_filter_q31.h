@@ -0,0 +1,94 @@
+#pragma once
+
+#include "fixed_point.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-point version of SOS_IIR_Filter for the integer analysis path.
+// Samples are 32-bit integers, e.g. 24-bit microphone values, which leaves 8 bits of headroom for filter gain.
+// Coefficients and gain are quantized to Q28, so values in [-8,8) can be represented.
+// Uses direct form I with 64-bit accumulators, so the only rounding happens once per section output.
+// The rounding error is fed back into the next output, which keeps it from being amplified by poles close to DC.
+// With the A-weighting filter outputs stay within 4 LSBs of a double precision filter, see test/fixed_point_test.cpp
+class SOSFilterQ31
+{
+    static constexpr unsigned MAX_SECTIONS = 4;     // Maximum # of second-order sections supported
+    static constexpr unsigned COEFFICIENT_BITS = 28; // # of fractional bits of coefficients
+
+    struct Section
+    {
+        int32_t b1 = 0;
+        int32_t b2 = 0;
+        int32_t a1 = 0; // stored negated, like in SOS_IIR_Filter
+        int32_t a2 = 0; // stored negated, like in SOS_IIR_Filter
+        int32_t x1 = 0; // input delay
+        int32_t x2 = 0;
+        int32_t y1 = 0; // output delay
+        int32_t y2 = 0;
+        int64_t error = 0; // rounding error of last output, fed back into the next one
+    };
+
+public:
+    /// @brief Create fixed-point filter from the coefficients of a floating-point filter
+    /// @p filter SOS_IIR_Filter or any filter with the same num_sos, gain and sos[i].b1, b2, a1, a2 members
+    template <typename FILTER>
+    SOSFilterQ31(const FILTER &filter)
+    {
+        m_nrOfSections = static_cast<unsigned>(filter.num_sos) < MAX_SECTIONS ? filter.num_sos : MAX_SECTIONS;
+        m_gain = quantize(filter.gain);
+        for (unsigned i = 0; i < m_nrOfSections; i++)
+        {
+            m_sections[i].b1 = quantize(filter.sos[i].b1);
+            m_sections[i].b2 = quantize(filter.sos[i].b2);
+            m_sections[i].a1 = quantize(filter.sos[i].a1);
+            m_sections[i].a2 = quantize(filter.sos[i].a2);
+        }
+    }
+
+    /// @brief Apply all filter sections to samples. Filter state is kept between calls
+    void applyFilters(const int32_t *input, int32_t *output, size_t count)
+    {
+        for (unsigned s = 0; s < m_nrOfSections; s++)
+        {
+            auto section = m_sections[s];
+            const int32_t *src = s == 0 ? input : output;
+            for (size_t i = 0; i < count; i++)
+            {
+                const int32_t x = src[i];
+                int64_t acc = static_cast<int64_t>(x) << COEFFICIENT_BITS;
+                acc += static_cast<int64_t>(section.b1) * section.x1 + static_cast<int64_t>(section.b2) * section.x2;
+                acc += static_cast<int64_t>(section.a1) * section.y1 + static_cast<int64_t>(section.a2) * section.y2;
+                acc += section.error;
+                const int32_t y = saturate32((acc + (1 << (COEFFICIENT_BITS - 1))) >> COEFFICIENT_BITS);
+                section.error = acc - (static_cast<int64_t>(y) << COEFFICIENT_BITS);
+                section.x2 = section.x1;
+                section.x1 = x;
+                section.y2 = section.y1;
+                section.y1 = y;
+                output[i] = y;
+            }
+            m_sections[s] = section;
+        }
+    }
+
+    /// @brief Apply filter gain to samples
+    void applyGain(const int32_t *input, int32_t *output, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            output[i] = saturate32((static_cast<int64_t>(input[i]) * m_gain + (1 << (COEFFICIENT_BITS - 1))) >> COEFFICIENT_BITS);
+        }
+    }
+
+private:
+    static int32_t quantize(float value)
+    {
+        return static_cast<int32_t>(std::lround(value * static_cast<float>(1UL << COEFFICIENT_BITS)));
+    }
+
+    Section m_sections[MAX_SECTIONS];
+    unsigned m_nrOfSections = 0;
+    int32_t m_gain = 0;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "analysis_frame.h"
+#include "frame_exchange.h"
+#include "parameters.h"
+
+#include <cmath>
+#include <cstdint>
+
+// Sound level meter outputs like the esp32-i2s-slm sound level meter the analysis is based on: Fast and slow time-weighted
+// levels, LAeq over a window of configurable length, LAFmax and LApeak. Energy and peak are accumulated while the A-weighting
+// gain is applied, so no extra pass over the samples is needed. Everything else is updated once per block with O(1) work.
+// Time weighting is applied per block, which is accurate to a few tenths of a dB for blocks much shorter than 125ms.
+// Levels are calibrated like the FFT magnitudes: referenceDb is the level of a signal with RMS amplitude referenceAmplitude.
+// Samples are accumulated and updated in one task, e.g. the microphone reader task. One other task can read the latest levels without locks
+// CHANNELS = Number of channels accumulated per block. Levels are calculated from the average power of all channels
+// SAMPLE_RATE_HZ = Audio sample rate in Hz
+template <unsigned CHANNELS = 1, unsigned SAMPLE_RATE_HZ = 48000>
+class SoundLevelMeter
+{
+    static constexpr float FAST_TIME_S = 0.125F; // Fast time constant
+    static constexpr float SLOW_TIME_S = 1.0F;   // Slow time constant
+
+public:
+    /// @brief Create sound level meter
+    /// @p referenceAmplitude RMS sample amplitude of a signal with level referenceDb, e.g. from the microphone sensitivity
+    /// @p referenceDb Level of referenceAmplitude in dB SPL
+    SoundLevelMeter(float referenceAmplitude, float referenceDb)
+        : m_energyToDb(referenceDb - 20.0F * std::log10(referenceAmplitude))
+    {
+    }
+
+    /// @brief Apply gain to filtered samples and accumulate their energy and peak in the same pass.
+    /// Call for every channel of a block, then call update()
+    /// @p gain Gain of the weighting filter, e.g. SOS_IIR_Filter::gain
+    /// @p samples A-weighted samples without gain. Will be modified!
+    /// @p count Number of samples
+    void applyGain(float gain, float *samples, unsigned count)
+    {
+        float energy = 0.0F;
+        float peak = m_blockPeak;
+        for (unsigned i = 0; i < count; i++)
+        {
+            const float value = samples[i] * gain;
+            samples[i] = value;
+            energy += value * value;
+            peak = std::fabs(value) > peak ? std::fabs(value) : peak;
+        }
+        m_blockEnergy += energy;
+        m_blockPeak = peak;
+        m_blockCount += count;
+    }
+
+    /// @brief Update levels from the samples accumulated since the last call and publish them
+    void update()
+    {
+        if (m_blockCount == 0)
+        {
+            return;
+        }
+        const float meanSquare = m_blockEnergy / m_blockCount;
+        const float blockTimeS = static_cast<float>(m_blockCount) / (CHANNELS * SAMPLE_RATE_HZ);
+        // exponential time weighting, advanced by one block
+        m_fastMeanSquare += (meanSquare - m_fastMeanSquare) * (1.0F - std::exp(-blockTimeS / FAST_TIME_S));
+        m_slowMeanSquare += (meanSquare - m_slowMeanSquare) * (1.0F - std::exp(-blockTimeS / SLOW_TIME_S));
+        // window energy is summed in double, so small blocks still count after minutes of samples
+        m_windowEnergy += m_blockEnergy;
+        m_windowCount += m_blockCount;
+        m_windowFastMax = m_fastMeanSquare > m_windowFastMax ? m_fastMeanSquare : m_windowFastMax;
+        m_windowPeak = m_blockPeak > m_windowPeak ? m_blockPeak : m_windowPeak;
+        m_blockEnergy = 0.0F;
+        m_blockPeak = 0.0F;
+        m_blockCount = 0;
+
+        auto &levels = m_levels.writeFrame();
+        levels.lafDb = meanSquareToDb(m_fastMeanSquare);
+        levels.lasDb = meanSquareToDb(m_slowMeanSquare);
+        levels.laeqDb = meanSquareToDb(static_cast<float>(m_windowEnergy / m_windowCount));
+        levels.lastLaeqDb = m_lastLaeqDb;
+        levels.lafMaxDb = meanSquareToDb(m_windowFastMax);
+        levels.lapeakDb = meanSquareToDb(m_windowPeak * m_windowPeak);
+        m_levels.publish();
+
+        // start next window. A shorter window length set in the middle of a window completes it early
+        m_windowS.update();
+        if (m_windowCount >= static_cast<uint64_t>(m_windowS.value()) * CHANNELS * SAMPLE_RATE_HZ)
+        {
+            m_lastLaeqDb = levels.laeqDb;
+            m_windowEnergy = 0.0;
+            m_windowCount = 0;
+            m_windowFastMax = 0.0F;
+            m_windowPeak = 0.0F;
+        }
+    }
+
+    /// @brief Latest levels. Only call from one reader task
+    const SoundLevels &levels()
+    {
+        m_levels.update();
+        return m_levels.readFrame();
+    }
+
+private:
+    // Level of mean square sample value. Silence is clamped to the level of amplitude 1
+    float meanSquareToDb(float meanSquare) const
+    {
+        return m_energyToDb + 10.0F * std::log10(meanSquare > 1.0F ? meanSquare : 1.0F);
+    }
+
+    const float m_energyToDb; // dB of mean square 1
+    float m_blockEnergy = 0.0F;
+    float m_blockPeak = 0.0F;
+    unsigned m_blockCount = 0;
+    float m_fastMeanSquare = 0.0F;
+    float m_slowMeanSquare = 0.0F;
+    double m_windowEnergy = 0.0;
+    uint64_t m_windowCount = 0;
+    float m_windowFastMax = 0.0F;
+    float m_windowPeak = 0.0F;
+    float m_lastLaeqDb = 0.0F;
+    FrameExchange<SoundLevels> m_levels;
+    Parameter<int32_t> m_windowS{"SoundLevelMeter.laeqWindowS", 60, 1, 3600}; // LAeq window length in seconds
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "parameters.h"
+
 #include <cmath>
 #include <functional>
 
@@ -25,8 +27,6 @@ public:
   static constexpr float BINS_PER_BAND = NR_OF_BINS / NR_OF_BANDS;              // # of bins needed for one band ~2.6 bins, for 32 bands up to 4kHz
   static constexpr unsigned int FRACT_BINS_PER_BAND = std::ceil(BINS_PER_BAND); // # of bins we need to touch to calculate a band
 
-  static constexpr float PeakDecayPerUpdate = (0.2f * SAMPLE_COUNT) / SAMPLE_RATE_HZ; // What amount the peaks decay per update call
-
   /// @brief Call to update spectrum data
   /// @p magnitudes Magnitude values for individual frequency bands from the FFT. Must be in the range [0,1]!
   /// @return Returns (normalized level data, normalized peak data). Read NR_OF_BANDS values from this
@@ -53,17 +53,31 @@ public:
       // average accumulated bins
       tempLevels[bandIndex] *= 1.0F / BINS_PER_BAND;
     }
+    return updateBands(tempLevels);
+  }
+
+  /// @brief Call to update spectrum data from band levels that have already been calculated, e.g. by a BandBank
+  /// @p bandLevels NR_OF_BANDS level values. Must be in the range [0,1]!
+  /// @return Returns (normalized level data, normalized peak data). Read NR_OF_BANDS values from this
+  std::pair<const float *, const float *> updateBands(const float *bandLevels)
+  {
+    m_smoothing.update();
+    m_peakDecay.update();
+    const float smoothing = m_smoothing.value();
+    const float peakDecayPerUpdate = (m_peakDecay.value() * SAMPLE_COUNT) / SAMPLE_RATE_HZ; // What amount the peaks decay per update call
     // update band levels
     for (int i = 0; i < NR_OF_BANDS; i++)
     {
-      m_levels[i] = 0.25f * m_levels[i] + 0.75f * tempLevels[i];
-      m_peaks[i] = m_levels[i] > m_peaks[i] ? m_levels[i] : (m_peaks[i] > 0 ? m_peaks[i] - PeakDecayPerUpdate : 0);
+      m_levels[i] = smoothing * m_levels[i] + (1.0f - smoothing) * bandLevels[i];
+      m_peaks[i] = m_levels[i] > m_peaks[i] ? m_levels[i] : (m_peaks[i] > 0 ? m_peaks[i] - peakDecayPerUpdate : 0);
       // Serial.println(levels[i], 1);
     }
     return {m_levels, m_peaks};
   }
 
 private:
+  Parameter<float> m_smoothing{"Spectrum.smoothing", 0.25f, 0.0f, 0.95f}; // Amount of the previous level kept per update
+  Parameter<float> m_peakDecay{"Spectrum.peakDecay", 0.2f, 0.0f, 10.0f};  // Amount the peaks decay per second
   float m_levels[NR_OF_BANDS] = {0};
   float m_peaks[NR_OF_BANDS] = {0};
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded queue handing values from one producer task to one consumer task without locks.
+// Neither side ever waits. push() fails if the queue is full and pop() fails if it is empty.
+// T = Value type. Must be copyable
+// CAPACITY = Maximum number of queued values. Must be a power-of-two
+template <typename T, unsigned CAPACITY>
+class SpscQueue
+{
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power-of-two");
+    static constexpr uint32_t INDEX_MASK = CAPACITY - 1;
+
+public:
+    /// @brief Add value to queue. Only call from the producer task
+    /// @return Returns false if the queue is full and the value was dropped
+    bool push(const T &value)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= CAPACITY)
+        {
+            return false;
+        }
+        m_values[tail & INDEX_MASK] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Remove oldest value from queue. Only call from the consumer task
+    /// @return Returns false if the queue is empty and value was not changed
+    bool pop(T &value)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        value = m_values[head & INDEX_MASK];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Returns true if the queue is empty. Cheap enough to check every frame
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_relaxed);
+    }
+
+private:
+    T m_values[CAPACITY];
+    std::atomic<uint32_t> m_head{0}; // Index of the next value to pop. Only written by the consumer
+    std::atomic<uint32_t> m_tail{0}; // Index of the next value to push. Only written by the producer
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "color.h"
+#include "effect.h"
+#include "logging.h"
+#include "screen.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#endif
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+// Renders an effect chain in horizontal strips of STRIP_ROWS rows, so only a strip needs to live in internal RAM.
+// The two full history frames feedback effects read from are allocated from PSRAM. Source rows a strip needs are
+// copied into an internal window that slides down the frame, so every history row is read from PSRAM about once per frame.
+// Each finished strip is written to the history and blitted to the screen right away.
+// Differences to EffectPipeline:
+// - Crossfades are not supported
+// - Every strip starts black instead of holding the frame before the previous one
+// - Effects only see what earlier effects of the chain changed in the source rows of the current strip.
+//   ToSource and DestinationToSource effects change the rows in the window. If the source rows of a strip do not fit
+//   into the window, they write the history frame being read instead. That frame is overwritten by the next frame,
+//   so the change is never shown, but later strips of the same frame read the changed rows
+// STRIP_ROWS = Number of rows rendered at once. Must divide HEIGHT
+// WINDOW_ROWS = Number of source rows cached in internal RAM. Strips needing more rows read the PSRAM history directly
+template <unsigned WIDTH, unsigned HEIGHT, unsigned STRIP_ROWS = 8, unsigned WINDOW_ROWS = 2 * STRIP_ROWS>
+class TiledEffectPipeline
+{
+    static_assert(HEIGHT % STRIP_ROWS == 0, "STRIP_ROWS must divide HEIGHT");
+    static_assert(WINDOW_ROWS >= STRIP_ROWS, "Window must at least hold a strip");
+
+    static constexpr unsigned FRAME_SIZE = WIDTH * HEIGHT * sizeof(RGBf);
+
+public:
+    TiledEffectPipeline(const EffectChain *chain = nullptr)
+        : m_chain(chain)
+    {
+    }
+
+    /// @brief Allocate history frames. Call once before rendering
+    /// @return Returns false if there is not enough memory
+    auto begin() -> bool
+    {
+        for (auto &frame : m_history)
+        {
+#ifdef ARDUINO
+            frame = static_cast<RGBf *>(heap_caps_malloc(FRAME_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+            if (frame == nullptr)
+            {
+                Log::warning("No PSRAM for history frame. Using internal RAM\n");
+                frame = static_cast<RGBf *>(heap_caps_malloc(FRAME_SIZE, MALLOC_CAP_8BIT));
+            }
+#else
+            frame = static_cast<RGBf *>(std::malloc(FRAME_SIZE));
+#endif
+            if (frame == nullptr)
+            {
+                Log::error("Failed to allocate history frame!\n");
+                return false;
+            }
+            memset(frame, 0, FRAME_SIZE);
+        }
+        return true;
+    }
+
+    /// @brief Switch to a new effect chain at the start of the next frame. Can be called from any task
+    /// @p chain New effect chain. Must stay valid while in use
+    /// @p fadeFrames Ignored. Crossfades are not supported
+    auto setChain(const EffectChain *chain, [[maybe_unused]] unsigned fadeFrames = 0) -> void
+    {
+        m_pendingChain.store(chain, std::memory_order_release);
+    }
+
+    /// @brief Currently active effect chain
+    auto chain() const -> const EffectChain *
+    {
+        return m_chain;
+    }
+
+    /// @brief Render frame strip by strip and blit strips to screen back buffer
+    /// @p dt Time since last frame in seconds
+    auto render(float dt, const AnalysisFrame &frame, Screen &screen) -> void
+    {
+        if (m_history[0] == nullptr || m_history[1] == nullptr)
+        {
+            return;
+        }
+        if (auto pending = m_pendingChain.exchange(nullptr, std::memory_order_acquire); pending != nullptr)
+        {
+            m_chain = pending;
+        }
+        // output of previous frame is source for this frame
+        m_read ^= 1;
+        m_windowFirstRow = 0;
+        m_windowEndRow = 0;
+        if (m_chain == nullptr)
+        {
+            return;
+        }
+        for (unsigned i = 0; i < m_chain->count; i++)
+        {
+            m_chain->effects[i]->prepare(dt, frame);
+        }
+        for (int firstRow = 0; firstRow < static_cast<int>(HEIGHT); firstRow += STRIP_ROWS)
+        {
+            const int endRow = firstRow + STRIP_ROWS;
+            renderStrip(firstRow, endRow, frame);
+            memcpy(m_history[m_read ^ 1] + firstRow * WIDTH, m_tile, sizeof(m_tile));
+            screen.blitRows(m_tile, firstRow, endRow);
+        }
+    }
+
+private:
+    static auto usesSource(Effect::Type type) -> bool
+    {
+        return type != Effect::Type::ToDestination;
+    }
+
+    auto renderStrip(int firstRow, int endRow, const AnalysisFrame &frame) -> void
+    {
+        // find source rows all effects of the strip need. Source writers need the strip rows themselves
+        int srcFirstRow = firstRow;
+        int srcEndRow = endRow;
+        for (unsigned i = 0; i < m_chain->count; i++)
+        {
+            auto effect = m_chain->effects[i];
+            if (usesSource(effect->type()))
+            {
+                auto [first, end] = effect->sourceRows(firstRow, endRow, HEIGHT);
+                srcFirstRow = first < srcFirstRow ? first : srcFirstRow;
+                srcEndRow = end > srcEndRow ? end : srcEndRow;
+            }
+        }
+        srcFirstRow = srcFirstRow < 0 ? 0 : srcFirstRow;
+        srcEndRow = srcEndRow > static_cast<int>(HEIGHT) ? HEIGHT : srcEndRow;
+        // read source rows through window or directly from history if they do not fit
+        RGBf *src = m_history[m_read];
+        if (srcEndRow - srcFirstRow <= static_cast<int>(WINDOW_ROWS))
+        {
+            slideWindow(srcFirstRow, srcEndRow);
+            src = m_window;
+            srcFirstRow = m_windowFirstRow;
+            srcEndRow = m_windowEndRow;
+        }
+        else
+        {
+            srcFirstRow = 0;
+            srcEndRow = HEIGHT;
+            m_windowFirstRow = 0;
+            m_windowEndRow = 0;
+        }
+        memset(m_tile, 0, sizeof(m_tile));
+        RGBf *srcStripRows = src + (firstRow - srcFirstRow) * WIDTH;
+        for (unsigned i = 0; i < m_chain->count; i++)
+        {
+            auto effect = m_chain->effects[i];
+            Strip strip = {m_tile, nullptr, WIDTH, HEIGHT, firstRow, endRow, firstRow, endRow};
+            switch (effect->type())
+            {
+            case Effect::Type::ToDestination:
+                break;
+            case Effect::Type::ToSource:
+                strip.dest = srcStripRows;
+                break;
+            case Effect::Type::DestinationToSource:
+                strip.dest = srcStripRows;
+                strip.src = m_tile;
+                break;
+            default:
+                strip.src = src;
+                strip.srcFirstRow = srcFirstRow;
+                strip.srcEndRow = srcEndRow;
+            }
+            effect->render(strip, frame);
+        }
+    }
+
+    // Move window to source rows [firstRow, endRow). Only rows not in the window yet are read from history
+    auto slideWindow(int firstRow, int endRow) -> void
+    {
+        if (firstRow >= m_windowFirstRow && endRow <= m_windowEndRow)
+        {
+            return;
+        }
+        // keep rows both windows have in common
+        const int keepFirst = firstRow > m_windowFirstRow ? firstRow : m_windowFirstRow;
+        const int keepEnd = endRow < m_windowEndRow ? endRow : m_windowEndRow;
+        if (keepFirst < keepEnd)
+        {
+            memmove(m_window + (keepFirst - firstRow) * WIDTH, m_window + (keepFirst - m_windowFirstRow) * WIDTH, (keepEnd - keepFirst) * WIDTH * sizeof(RGBf));
+            readRows(firstRow, firstRow, keepFirst);
+            readRows(firstRow, keepEnd, endRow);
+        }
+        else
+        {
+            readRows(firstRow, firstRow, endRow);
+        }
+        m_windowFirstRow = firstRow;
+        m_windowEndRow = endRow;
+    }
+
+    // Copy history rows [firstRow, endRow) to window starting at windowFirstRow
+    auto readRows(int windowFirstRow, int firstRow, int endRow) -> void
+    {
+        if (firstRow < endRow)
+        {
+            memcpy(m_window + (firstRow - windowFirstRow) * WIDTH, m_history[m_read] + firstRow * WIDTH, (endRow - firstRow) * WIDTH * sizeof(RGBf));
+        }
+    }
+
+    RGBf m_tile[WIDTH * STRIP_ROWS];
+    RGBf m_window[WIDTH * WINDOW_ROWS];
+    int m_windowFirstRow = 0;
+    int m_windowEndRow = 0;
+    RGBf *m_history[2] = {nullptr, nullptr};
+    unsigned m_read = 0;
+    const EffectChain *m_chain = nullptr;
+    std::atomic<const EffectChain *> m_pendingChain{nullptr};
+};
@@ -0,0 +1,152 @@
+#include "host_test.h"
+
+#include "analysis_broadcast.h"
+
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+
+// Checks the analysis packet codec and sends frames from an AnalysisSender to an AnalysisReceiver over the loopback interface:
+// - Encoded frames decode to the same values within the 8-bit quantization, truncated packets are rejected
+// - The receiver counts lost and late packets and starts over when the sender restarts
+
+static constexpr uint16_t TEST_PORT = 42142;
+static constexpr float QUANTIZATION_ERROR = 0.5F / 255.0F + 1e-6F;
+
+std::unique_ptr<AnalysisFrame> makeFrame(uint32_t sequence, uint32_t timeUs, bool isStereo, bool hasChroma)
+{
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    frame->sequence = sequence;
+    frame->timeUs = timeUs;
+    frame->lastBeatTimeUs = timeUs - 123456;
+    frame->isBeat = true;
+    frame->nrOfBands = 32;
+    frame->nrOfChannels = isStereo ? 2 : 1;
+    frame->nrOfOctaves = hasChroma ? 4 : 0;
+    for (unsigned band = 0; band < frame->nrOfBands; band++)
+    {
+        frame->levels[band] = static_cast<float>(band) / frame->nrOfBands;
+        frame->peaks[band] = 1.0F - static_cast<float>(band) / frame->nrOfBands;
+        frame->leftLevels[band] = isStereo ? 0.3F : frame->levels[band];
+        frame->rightLevels[band] = isStereo ? 0.7F : frame->levels[band];
+    }
+    for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+    {
+        frame->chroma[i] = hasChroma ? static_cast<float>(i) / 11.0F : 0.0F;
+    }
+    frame->soundLevels.lafDb = 71.234F;
+    frame->soundLevels.lapeakDb = 98.765F;
+    return frame;
+}
+
+void checkCodec(bool isStereo, bool hasChroma)
+{
+    const auto frame = makeFrame(0x12345678, 0x9abcdef0, isStereo, hasChroma);
+    uint8_t packet[AnalysisPacket::MAX_SIZE];
+    const auto size = AnalysisPacket::encode(*frame, packet);
+    CHECK(size == AnalysisPacket::HEADER_SIZE + (isStereo ? 4 : 2) * frame->nrOfBands + (hasChroma ? AnalysisFrame::NR_OF_PITCH_CLASSES : 0));
+    CHECK(AnalysisPacket::sequence(packet) == frame->sequence);
+    auto decoded = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    CHECK(AnalysisPacket::decode(packet, size, *decoded));
+    CHECK(decoded->sequence == frame->sequence);
+    CHECK(decoded->timeUs == frame->timeUs);
+    CHECK(decoded->lastBeatTimeUs == frame->lastBeatTimeUs);
+    CHECK(decoded->isBeat);
+    CHECK(decoded->nrOfBands == frame->nrOfBands);
+    CHECK(decoded->nrOfChannels == frame->nrOfChannels);
+    float maxError = 0.0F;
+    for (unsigned band = 0; band < frame->nrOfBands; band++)
+    {
+        for (float error : {decoded->levels[band] - frame->levels[band], decoded->peaks[band] - frame->peaks[band],
+                            decoded->leftLevels[band] - frame->leftLevels[band], decoded->rightLevels[band] - frame->rightLevels[band]})
+        {
+            maxError = std::fabs(error) > maxError ? std::fabs(error) : maxError;
+        }
+    }
+    for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+    {
+        maxError = std::fabs(decoded->chroma[i] - frame->chroma[i]) > maxError ? std::fabs(decoded->chroma[i] - frame->chroma[i]) : maxError;
+    }
+    CHECK(maxError <= QUANTIZATION_ERROR);
+    CHECK(std::fabs(decoded->soundLevels.lafDb - frame->soundLevels.lafDb) <= 0.005F);
+    CHECK(std::fabs(decoded->soundLevels.lapeakDb - frame->soundLevels.lapeakDb) <= 0.005F);
+    // truncated packets and other versions are rejected
+    CHECK(!AnalysisPacket::decode(packet, AnalysisPacket::HEADER_SIZE - 1, *decoded));
+    CHECK(!AnalysisPacket::decode(packet, AnalysisPacket::HEADER_SIZE + 2 * frame->nrOfBands - 1, *decoded));
+    packet[2]++;
+    CHECK(!AnalysisPacket::decode(packet, size, *decoded));
+}
+
+// Send frame and receive it. Returns the number of frames received
+unsigned sendAndReceive(AnalysisSender &sender, AnalysisReceiver &receiver, uint32_t sequence, uint32_t remoteUs, uint32_t localUs, AnalysisFrame &received)
+{
+    CHECK(sender.send(*makeFrame(sequence, remoteUs, false, true)));
+    unsigned count = 0;
+    if (receiver.wait(1000))
+    {
+        while (receiver.receive(received, localUs))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void checkLoopback()
+{
+    auto sender = AnalysisSender();
+    auto receiver = AnalysisReceiver();
+    CHECK(sender.begin("127.0.0.1", TEST_PORT));
+    CHECK(receiver.begin(nullptr, TEST_PORT));
+    auto received = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    // the sender clock is 5s behind, packets take 1ms
+    constexpr uint32_t OffsetUs = 5000000;
+    constexpr uint32_t FrameUs = 21333;
+    uint32_t remoteUs = 1000000;
+    for (uint32_t sequence = 1; sequence <= 10; sequence++, remoteUs += FrameUs)
+    {
+        CHECK(sendAndReceive(sender, receiver, sequence, remoteUs, remoteUs + OffsetUs + 1000, *received) == 1);
+        CHECK(received->sequence == sequence);
+    }
+    CHECK(receiver.clockOffsetUs() == OffsetUs + 1000);
+    CHECK(received->timeUs == remoteUs - FrameUs + OffsetUs + 1000);
+    // 11 and 12 are lost, 12 arrives after 13
+    CHECK(sendAndReceive(sender, receiver, 13, remoteUs + 2 * FrameUs, remoteUs + 2 * FrameUs + OffsetUs + 1000, *received) == 1);
+    CHECK(sendAndReceive(sender, receiver, 12, remoteUs + FrameUs, remoteUs + 2 * FrameUs + OffsetUs + 1500, *received) == 0);
+    CHECK(received->sequence == 13);
+    CHECK(receiver.lostPackets() == 2);
+    CHECK(receiver.latePackets() == 1);
+    CHECK(receiver.resyncs() == 0);
+    // the sender restarts, which takes longer than the resync timeout. Sequences and the sender clock start over
+    uint32_t localUs = remoteUs + 2 * FrameUs + OffsetUs + 1000 + 3000000;
+    CHECK(sendAndReceive(sender, receiver, 0, 0, localUs, *received) == 1);
+    CHECK(received->sequence == 0);
+    CHECK(receiver.resyncs() == 1);
+    CHECK(receiver.lostPackets() == 2);
+    CHECK(received->timeUs == localUs);
+    CHECK(sendAndReceive(sender, receiver, 1, FrameUs, localUs + FrameUs, *received) == 1);
+    CHECK(received->timeUs == localUs + FrameUs);
+    // a large backward jump without a pause is a restart too, a small one is a late packet
+    localUs += 2 * FrameUs;
+    CHECK(sendAndReceive(sender, receiver, 1000, 2 * FrameUs, localUs, *received) == 1);
+    CHECK(sendAndReceive(sender, receiver, 990, 3 * FrameUs, localUs + FrameUs, *received) == 0);
+    CHECK(sendAndReceive(sender, receiver, 5, 0, localUs + 2 * FrameUs, *received) == 1);
+    CHECK(received->sequence == 5);
+    CHECK(receiver.resyncs() == 2);
+    CHECK(receiver.latePackets() == 2);
+    CHECK(receiver.lostPackets() == 2 + 998);
+    CHECK(receiver.invalidPackets() == 0);
+    std::printf("Loopback: lost %u, late %u, resyncs %u\n", static_cast<unsigned>(receiver.lostPackets()), static_cast<unsigned>(receiver.latePackets()),
+                static_cast<unsigned>(receiver.resyncs()));
+}
+
+int main()
+{
+    checkCodec(false, false);
+    checkCodec(false, true);
+    checkCodec(true, false);
+    checkCodec(true, true);
+    checkLoopback();
+    return HostTest::result();
+}
@@ -0,0 +1,25 @@
+#include "host_test.h"
+
+#include "analysis_check.h"
+
+#include <cmath>
+
+// Runs the golden vectors of the analysis approximation check with the settings of the sketch, with and without decimation
+
+// Microphone calibration of the sketch: INMP441, -26dBFS at 94dB, 24 bits
+static constexpr unsigned SAMPLE_COUNT = 1024;
+static constexpr unsigned SAMPLE_RATE_HZ = 48000;
+static constexpr unsigned NR_OF_BANDS = 32;
+static constexpr unsigned MAX_HZ = 4000;
+static constexpr unsigned AUDIO_NOISE_DB = 33;
+static constexpr unsigned AUDIO_MAX_DB = 120;
+static const float MicRefAmplitude = std::pow(10.0F, -26.0F / 20.0F) * ((1 << 23) - 1);
+static constexpr float OffsetDb = 3.0103F + 94.0F;
+
+int main()
+{
+    CHECK(AnalysisCheck<SAMPLE_COUNT, NR_OF_BANDS, MAX_HZ, SAMPLE_RATE_HZ, AUDIO_NOISE_DB, AUDIO_MAX_DB>::runAll(OffsetDb, 1.0F / MicRefAmplitude));
+    // decimation by 4
+    CHECK(AnalysisCheck<SAMPLE_COUNT / 4, NR_OF_BANDS, MAX_HZ, SAMPLE_RATE_HZ / 4, AUDIO_NOISE_DB, AUDIO_MAX_DB>::runAll(OffsetDb, 4.0F / MicRefAmplitude));
+    return HostTest::result();
+}
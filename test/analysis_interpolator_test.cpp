@@ -0,0 +1,94 @@
+#include "host_test.h"
+
+#include "analysis_interpolator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+// Interpolates and extrapolates between two analysis frames and checks that:
+// - Values between the frames are linear in time and lag one analysis interval
+// - Late frames are extrapolated for up to 1.5 intervals, then values are held
+// - Extrapolated levels, peaks, channel levels and chroma never leave [0,1]
+
+static constexpr uint32_t INTERVAL_US = 20000;
+static constexpr unsigned NR_OF_BANDS = 4;
+static constexpr unsigned NR_OF_OCTAVES = 2;
+static constexpr float TOLERANCE = 1e-5F;
+
+// Frame with every interpolated value set to value
+std::unique_ptr<AnalysisFrame> makeFrame(uint32_t sequence, float value)
+{
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    frame->sequence = sequence;
+    frame->timeUs = sequence * INTERVAL_US;
+    frame->nrOfBands = NR_OF_BANDS;
+    frame->nrOfOctaves = NR_OF_OCTAVES;
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        frame->levels[band] = value;
+        frame->peaks[band] = value;
+        frame->leftLevels[band] = value;
+        frame->rightLevels[band] = value;
+    }
+    for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+    {
+        frame->chroma[i] = value;
+        for (unsigned octave = 0; octave < NR_OF_OCTAVES; octave++)
+        {
+            frame->octaveChroma[octave][i] = value;
+        }
+    }
+    return frame;
+}
+
+// Check that every interpolated value of frame is expected
+bool checkValues(const char *name, const AnalysisFrame &frame, float expected)
+{
+    float minimum = 1.0F;
+    float maximum = 0.0F;
+    auto add = [&minimum, &maximum](float value)
+    {
+        minimum = value < minimum ? value : minimum;
+        maximum = value > maximum ? value : maximum;
+    };
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        add(frame.levels[band]);
+        add(frame.peaks[band]);
+        add(frame.leftLevels[band]);
+        add(frame.rightLevels[band]);
+    }
+    for (unsigned i = 0; i < AnalysisFrame::NR_OF_PITCH_CLASSES; i++)
+    {
+        add(frame.chroma[i]);
+        for (unsigned octave = 0; octave < NR_OF_OCTAVES; octave++)
+        {
+            add(frame.octaveChroma[octave][i]);
+        }
+    }
+    std::printf("%s: values in [%.3f, %.3f], expected %.3f\n", name, minimum, maximum, expected);
+    return CHECK(std::fabs(minimum - expected) < TOLERANCE && std::fabs(maximum - expected) < TOLERANCE);
+}
+
+int main()
+{
+    auto interpolator = std::unique_ptr<AnalysisInterpolator>(new AnalysisInterpolator());
+    // rising from 0.2 to 0.8. Extrapolation would reach 1.1 after 1.5 intervals
+    interpolator->push(*makeFrame(1, 0.2F));
+    interpolator->push(*makeFrame(2, 0.8F));
+    checkValues("Rising, at latest frame", interpolator->interpolate(2 * INTERVAL_US), 0.2F);
+    checkValues("Rising, half an interval later", interpolator->interpolate(2 * INTERVAL_US + INTERVAL_US / 2), 0.5F);
+    checkValues("Rising, one interval late", interpolator->interpolate(3 * INTERVAL_US), 0.8F);
+    checkValues("Rising, 1.25 intervals late", interpolator->interpolate(3 * INTERVAL_US + INTERVAL_US / 4), 0.95F);
+    checkValues("Rising, 1.5 intervals late", interpolator->interpolate(3 * INTERVAL_US + INTERVAL_US / 2), 1.0F);
+    checkValues("Rising, held", interpolator->interpolate(10 * INTERVAL_US), 1.0F);
+    // falling from 0.8 to 0.1. Extrapolation would reach -0.25
+    interpolator->push(*makeFrame(3, 0.1F));
+    checkValues("Falling, half an interval later", interpolator->interpolate(3 * INTERVAL_US + INTERVAL_US / 2), 0.45F);
+    checkValues("Falling, 1.5 intervals late", interpolator->interpolate(4 * INTERVAL_US + INTERVAL_US / 2), 0.0F);
+    checkValues("Falling, held", interpolator->interpolate(10 * INTERVAL_US), 0.0F);
+    // frames arriving early hold the previous frame
+    checkValues("Falling, before latest frame", interpolator->interpolate(2 * INTERVAL_US), 0.8F);
+    return HostTest::result();
+}
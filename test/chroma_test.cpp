@@ -0,0 +1,86 @@
+#include "host_test.h"
+
+#include "chroma.h"
+#include "fft.h"
+#include "normalization.h"
+
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+// Feeds sine tones through the analysis path of the sketch (FFT, Normalization, Chroma) and checks that:
+// - Notes down to G#4 (~415Hz) are resolved, where FFT bins are up to 2 semitones wide
+// - A tone up to 0.4 semitones out of tune lights its nearest note, its neighbours only get leakage far below it
+
+static constexpr unsigned SAMPLE_COUNT = 1024;
+static constexpr unsigned SAMPLE_RATE_HZ = 48000;
+static constexpr unsigned MAX_HZ = 4000;
+static constexpr unsigned AUDIO_NOISE_DB = 33;
+static constexpr unsigned AUDIO_MAX_DB = 120;
+static constexpr unsigned NR_OF_UPDATES = 30;
+static constexpr float MAX_NEIGHBOUR_LEVEL = 0.1F; // Level of the neighbouring notes relative to the note of the tone
+// Microphone calibration of the sketch: INMP441, -26dBFS at 94dB, 24 bits
+static const float MicRefAmplitude = std::pow(10.0F, -26.0F / 20.0F) * ((1 << 23) - 1);
+static const float AmplitudeOneDb = 3.0103F + 94.0F + 20.0F * std::log10(1.0F / MicRefAmplitude);
+
+using ChromaAnalysis = Chroma<SAMPLE_COUNT, MAX_HZ, SAMPLE_RATE_HZ>;
+static const char *NoteNames[12] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
+
+// Play a sine tone of MIDI note, detuned by cents, and check the note levels
+void checkNote(int midiNote, int cents = 0)
+{
+    constexpr double Pi = 3.14159265358979323846;
+    const double hz = 440.0 * std::pow(2.0, (midiNote + cents / 100.0 - 69) / 12.0);
+    std::vector<float> samples(SAMPLE_COUNT);
+    auto fft = std::unique_ptr<FFT<SAMPLE_COUNT, SAMPLE_RATE_HZ, FFTBackendReference>>(
+        new FFT<SAMPLE_COUNT, SAMPLE_RATE_HZ, FFTBackendReference>(reinterpret_cast<float(*)[SAMPLE_COUNT]>(samples.data())));
+    auto normalization = Normalization<SAMPLE_COUNT, AUDIO_NOISE_DB, AUDIO_MAX_DB, MAX_HZ, SAMPLE_RATE_HZ>(AmplitudeOneDb);
+    auto chroma = std::unique_ptr<ChromaAnalysis>(new ChromaAnalysis());
+    std::pair<const float *, const float *> levels;
+    for (unsigned update = 0; update < NR_OF_UPDATES; update++)
+    {
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            samples[i] = static_cast<float>(1e5 * std::sin(2.0 * Pi * hz * (update * SAMPLE_COUNT + i) / SAMPLE_RATE_HZ));
+        }
+        levels = chroma->update(normalization.apply(fft->calculate()));
+    }
+    const auto notes = levels.second;
+    const int index = midiNote - 12 * (ChromaAnalysis::FIRST_OCTAVE + 1);
+    if (!CHECK(index >= 1 && index + 1 < static_cast<int>(12 * ChromaAnalysis::NR_OF_OCTAVES)))
+    {
+        return;
+    }
+    int loudest = 0;
+    for (int note = 0; note < static_cast<int>(12 * ChromaAnalysis::NR_OF_OCTAVES); note++)
+    {
+        loudest = notes[note] > notes[loudest] ? note : loudest;
+    }
+    std::printf("%s%d %+d cents (%.1fHz): level %.2f, neighbours %.2f %.2f, loudest %s%d\n", NoteNames[midiNote % 12], midiNote / 12 - 1, cents, hz, notes[index],
+                notes[index - 1], notes[index + 1], NoteNames[loudest % 12], ChromaAnalysis::FIRST_OCTAVE + loudest / 12);
+    CHECK(loudest == index);
+    CHECK(notes[index] > 0.5F);
+    CHECK(notes[index - 1] < MAX_NEIGHBOUR_LEVEL * notes[index]);
+    CHECK(notes[index + 1] < MAX_NEIGHBOUR_LEVEL * notes[index]);
+    CHECK(levels.first[midiNote % 12] == notes[index]);
+}
+
+int main()
+{
+    std::printf("Chroma: %u octaves from C%d\n", ChromaAnalysis::NR_OF_OCTAVES, ChromaAnalysis::FIRST_OCTAVE);
+    CHECK(ChromaAnalysis::FIRST_OCTAVE == 4);
+    // G#4 to A#7 in steps of 5 semitones, so every bin width and pitch class is covered
+    for (int note = 68; note <= 106; note += 5)
+    {
+        for (int cents : {-40, 0, 40})
+        {
+            checkNote(note, cents);
+        }
+    }
+    // neighbours in the widest bins
+    checkNote(69);
+    checkNote(70);
+    return HostTest::result();
+}
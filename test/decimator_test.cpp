@@ -0,0 +1,105 @@
+#include "host_test.h"
+
+#include "decimator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Checks passband droop and alias rejection of Decimator with sine tones, and that block-wise in-place
+// filtering gives the same result as filtering a long stream at once
+
+static constexpr unsigned SAMPLE_RATE_HZ = 48000;
+static constexpr unsigned NR_OF_BLOCKS = 8;   // Blocks fed per tone
+static constexpr unsigned SETTLE_BLOCKS = 2;  // Blocks ignored until the filter history is filled
+
+// Gain of a sine tone of amplitude 1 through the decimator in dB, from the RMS of the output.
+// The output does not contain a whole number of periods, so this is accurate to ~0.05dB
+template <unsigned SAMPLE_COUNT, unsigned FACTOR>
+double toneGainDb(double hz)
+{
+    constexpr double Pi = 3.14159265358979323846;
+    auto decimator = std::unique_ptr<Decimator<SAMPLE_COUNT, FACTOR>>(new Decimator<SAMPLE_COUNT, FACTOR>());
+    std::vector<float> block(SAMPLE_COUNT);
+    double sumSquares = 0.0;
+    for (unsigned b = 0; b < NR_OF_BLOCKS; b++)
+    {
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            block[i] = static_cast<float>(std::sin(2.0 * Pi * hz * (b * SAMPLE_COUNT + i) / SAMPLE_RATE_HZ));
+        }
+        decimator->apply(block.data());
+        for (unsigned i = 0; b >= SETTLE_BLOCKS && i < SAMPLE_COUNT / FACTOR; i++)
+        {
+            sumSquares += static_cast<double>(block[i]) * block[i];
+        }
+    }
+    const double amplitude = std::sqrt(2.0 * sumSquares / ((NR_OF_BLOCKS - SETTLE_BLOCKS) * (SAMPLE_COUNT / FACTOR)));
+    return 20.0 * std::log10(amplitude + 1e-12);
+}
+
+// Check gain of tones in [fromHz, toHz] in steps of 50Hz
+template <unsigned SAMPLE_COUNT, unsigned FACTOR>
+void checkBand(const char *name, double fromHz, double toHz, double minDb, double maxDb)
+{
+    double worstMin = 1000.0;
+    double worstMax = -1000.0;
+    for (double hz = fromHz; hz <= toHz; hz += 50.0)
+    {
+        const double gainDb = toneGainDb<SAMPLE_COUNT, FACTOR>(hz);
+        worstMin = gainDb < worstMin ? gainDb : worstMin;
+        worstMax = gainDb > worstMax ? gainDb : worstMax;
+    }
+    std::printf("Factor %u, %s %.0f-%.0fHz: gain %.2f to %.2f dB\n", FACTOR, name, fromHz, toHz, worstMin, worstMax);
+    CHECK(worstMin >= minDb);
+    CHECK(worstMax <= maxDb);
+}
+
+// Decimate noise in blocks of SAMPLE_COUNT and in one long block and compare the results
+template <unsigned FACTOR>
+void checkBlockContinuity()
+{
+    constexpr unsigned BLOCK = 96 * FACTOR;
+    constexpr unsigned LONG_BLOCK = 8 * BLOCK;
+    std::vector<float> input(LONG_BLOCK);
+    uint32_t random = 12345;
+    for (auto &v : input)
+    {
+        random = random * 1664525 + 1013904223;
+        v = static_cast<float>(random) / 4294967296.0F - 0.5F;
+    }
+    auto blockwise = std::unique_ptr<Decimator<BLOCK, FACTOR>>(new Decimator<BLOCK, FACTOR>());
+    auto longBlock = std::unique_ptr<Decimator<LONG_BLOCK, FACTOR>>(new Decimator<LONG_BLOCK, FACTOR>());
+    std::vector<float> expected(input);
+    longBlock->apply(expected.data());
+    float maxError = 0.0F;
+    for (unsigned b = 0; b < LONG_BLOCK / BLOCK; b++)
+    {
+        std::vector<float> block(input.begin() + b * BLOCK, input.begin() + (b + 1) * BLOCK);
+        blockwise->apply(block.data());
+        for (unsigned i = 0; i < BLOCK / FACTOR; i++)
+        {
+            const float error = std::fabs(block[i] - expected[b * BLOCK / FACTOR + i]);
+            maxError = error > maxError ? error : maxError;
+        }
+    }
+    std::printf("Factor %u, blocks of %u vs. %u samples: max. difference %g\n", FACTOR, BLOCK, LONG_BLOCK, maxError);
+    CHECK(maxError < 1e-6F);
+}
+
+int main()
+{
+    // 48kHz -> 12kHz, like the sketch. Passband up to MAX_ANALYSIS_FREQUENCY_HZ = 4kHz.
+    // Tones above 8.5kHz alias into 0-3.5kHz, tones above 9kHz into 0-3kHz
+    checkBand<1024, 4>("passband", 50.0, 4000.0, -0.4, 0.1);
+    checkBand<1024, 4>("stopband", 8500.0, 24000.0, -1000.0, -70.0);
+    checkBand<1024, 4>("stopband", 9000.0, 24000.0, -1000.0, -105.0);
+    // 48kHz -> 8kHz. Tones above 6kHz alias into 0-2kHz
+    checkBand<1536, 6>("passband", 50.0, 2500.0, -0.2, 0.1);
+    checkBand<1536, 6>("stopband", 6000.0, 24000.0, -1000.0, -70.0);
+    checkBlockContinuity<4>();
+    checkBlockContinuity<6>();
+    return HostTest::result();
+}
@@ -0,0 +1,124 @@
+#include "host_test.h"
+#include "fake_screen.h"
+#include "zeroed_pipeline.h"
+
+#include "effectpipeline.h"
+#include "effects_draw.h"
+#include "effects_spectrum.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+// Checks that pure writer chains rendered straight into the screen back buffer give the same bytes as rendering
+// to the float frame buffer and blitting it. Chains are switched between the direct and the float path, with and
+// without crossfade, so the float history rendered when leaving the direct path is checked too
+
+static constexpr unsigned WIDTH = 32;
+static constexpr unsigned HEIGHT = 32;
+static constexpr unsigned NR_OF_BANDS = 16;
+static constexpr unsigned FADE_FRAMES = 10;
+static constexpr float DT = 1.0F / 60.0F;
+
+using Pipeline = EffectPipeline<WIDTH, HEIGHT, true>;
+using Screen_ = FakeScreen<WIDTH, HEIGHT>;
+
+// Effects of every chain checked. Each pipeline gets its own instances, so effect state is not shared
+struct Effects_
+{
+    Effects::FillColor<WIDTH, HEIGHT> fillBlack;
+    Effects::FillColor<WIDTH, HEIGHT> fillBlue{{0.1F, 0.2F, 0.7F}};
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> spectrum{Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS>::Mode::BandsCentered, Palettes::rainbow(), 40.0F};
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> rays{Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS>::Mode::RaysCentered};
+};
+
+// Chain switches. The bands chain renders to the screen, the rays chain blends additively and needs the float path
+struct Switch
+{
+    unsigned frame;
+    bool bands;
+    unsigned fadeFrames;
+};
+
+static constexpr Switch SWITCHES[] = {{30, false, 0}, {60, true, 0}, {90, false, FADE_FRAMES}, {120, true, FADE_FRAMES}};
+static constexpr unsigned NR_OF_FRAMES = 150;
+static constexpr unsigned DIRECT_FRAMES = 30 + 30 + 30 - FADE_FRAMES; // Bands frames without crossfade
+
+// Analysis frame number i. Levels and peaks move over time
+void makeFrame(AnalysisFrame &frame, unsigned i)
+{
+    frame.sequence = i;
+    frame.nrOfBands = NR_OF_BANDS;
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        frame.levels[band] = 0.5F + 0.5F * std::sin(0.1F * i + 0.7F * band);
+        frame.peaks[band] = 0.5F + 0.5F * std::sin(0.1F * i + 0.7F * band + 0.3F);
+    }
+}
+
+// Every 8-bit level stored as a float color and converted back must be unchanged, so palettes do not lose levels
+void checkStorePixel()
+{
+    unsigned changed = 0;
+    for (unsigned level = 0; level < 256; level++)
+    {
+        const float value = level / 255.0F;
+        RGBf color;
+        storePixel(color, RGBf(value, value, value));
+        RGB8 pixel;
+        storePixel(pixel, color);
+        changed += pixel.r != level || pixel.g != level || pixel.b != level ? 1 : 0;
+    }
+    std::printf("8-bit levels changed by storePixel(): %u\n", changed);
+    CHECK(changed == 0);
+}
+
+// Render the switch sequence to the screen and to the float buffer plus blit and compare every frame
+void checkSwitches()
+{
+    auto a = std::unique_ptr<Effects_>(new Effects_());
+    auto b = std::unique_ptr<Effects_>(new Effects_());
+    const EffectChain directBands{"Bands", {&a->fillBlue, &a->spectrum}, 2};
+    const EffectChain directRays{"Rays", {&a->fillBlack, &a->rays}, 2};
+    const EffectChain floatBands{"Bands", {&b->fillBlue, &b->spectrum}, 2};
+    const EffectChain floatRays{"Rays", {&b->fillBlack, &b->rays}, 2};
+    ZeroedPipeline<Pipeline> direct(&directBands);
+    ZeroedPipeline<Pipeline> reference(&floatBands);
+    auto directScreen = std::unique_ptr<Screen_>(new Screen_());
+    auto referenceScreen = std::unique_ptr<Screen_>(new Screen_());
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    unsigned differentFrames = 0;
+    for (unsigned i = 0; i < NR_OF_FRAMES; i++)
+    {
+        for (const auto &change : SWITCHES)
+        {
+            if (change.frame == i)
+            {
+                direct->setChain(change.bands ? &directBands : &directRays, change.fadeFrames);
+                reference->setChain(change.bands ? &floatBands : &floatRays, change.fadeFrames);
+            }
+        }
+        makeFrame(*frame, i);
+        direct->render(DT, *frame, *directScreen);
+        reference->render(DT, *frame);
+        referenceScreen->blit(reference->output());
+        const bool differs = memcmp(directScreen->backBuffer(), referenceScreen->backBuffer(), sizeof(RGB8) * WIDTH * HEIGHT) != 0;
+        if (differs && differentFrames == 0)
+        {
+            std::printf("First difference in frame %u\n", i);
+        }
+        differentFrames += differs ? 1 : 0;
+    }
+    const unsigned directFrames = NR_OF_FRAMES - directScreen->blits;
+    std::printf("%u of %u frames differ, %u frames rendered to the screen\n", differentFrames, NR_OF_FRAMES, directFrames);
+    CHECK(differentFrames == 0);
+    CHECK(directFrames == DIRECT_FRAMES);
+}
+
+int main()
+{
+    checkStorePixel();
+    checkSwitches();
+    return HostTest::result();
+}
@@ -0,0 +1,99 @@
+#include "host_test.h"
+#include "zeroed_pipeline.h"
+
+#include "effectpipeline.h"
+#include "effects_draw.h"
+#include "effects_feedback.h"
+#include "effects_particles.h"
+#include "effects_spectrum.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+// Renders the same effect chains with and without a RowWorker and checks that splitting row-parallel effects
+// between two threads gives bit-identical frames. The host RowWorker runs jobs in a std::thread with the same
+// start() / wait() protocol as the FreeRTOS task, so the barriers between effect runs are exercised too
+
+static constexpr unsigned WIDTH = 32;
+static constexpr unsigned HEIGHT = 32;
+static constexpr unsigned NR_OF_BANDS = 16;
+static constexpr unsigned NR_OF_FRAMES = 120;
+static constexpr float DT = 1.0F / 60.0F;
+
+using Pipeline = EffectPipeline<WIDTH, HEIGHT>;
+
+// Effects of every chain checked. Each pipeline gets its own instances, so effect state is not shared
+struct Effects_
+{
+    Effects::FillColor<WIDTH, HEIGHT> fillBlack;
+    Effects::FillColor<WIDTH, HEIGHT, Effect::Type::ToSource> fillSource{{0.1F, 0.0F, 0.2F}};
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> spectrum;
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> rays{Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS>::Mode::RaysCentered};
+    Effects::MoveFromCenter<WIDTH, HEIGHT> moveFromCenter;
+    Effects::RotoBlit<WIDTH, HEIGHT> rotoBlit;
+    Effects::ChangeBrightness<WIDTH, HEIGHT> changeBrightness;
+    Effects::Particles<WIDTH, HEIGHT, NR_OF_BANDS, 512> particles;
+};
+
+// Analysis frame number i. Levels move over time and there is a beat every 30 frames
+void makeFrame(AnalysisFrame &frame, unsigned i)
+{
+    frame.sequence = i;
+    frame.nrOfBands = NR_OF_BANDS;
+    frame.isBeat = i % 30 == 0;
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        frame.levels[band] = 0.5F + 0.5F * std::sin(0.1F * i + 0.7F * band);
+        frame.peaks[band] = frame.levels[band];
+    }
+}
+
+// Render chain with both pipelines for a while and compare every frame
+bool checkChain(const char *name, EffectChain &single, EffectChain &split)
+{
+    ZeroedPipeline<Pipeline> singlePipeline(&single);
+    ZeroedPipeline<Pipeline> splitPipeline(&split);
+    CHECK(splitPipeline->beginWorker());
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    unsigned differentFrames = 0;
+    for (unsigned i = 0; i < NR_OF_FRAMES; i++)
+    {
+        makeFrame(*frame, i);
+        singlePipeline->render(DT, *frame);
+        splitPipeline->render(DT, *frame);
+        differentFrames += memcmp(singlePipeline->output(), splitPipeline->output(), sizeof(RGBf) * WIDTH * HEIGHT) != 0 ? 1 : 0;
+    }
+    std::printf("%s: %u of %u frames differ\n", name, differentFrames, NR_OF_FRAMES);
+    return CHECK(differentFrames == 0);
+}
+
+int main()
+{
+    auto a = std::unique_ptr<Effects_>(new Effects_());
+    auto b = std::unique_ptr<Effects_>(new Effects_());
+    {
+        EffectChain single{"Spectrum", {&a->fillBlack, &a->spectrum}, 2};
+        EffectChain split{"Spectrum", {&b->fillBlack, &b->spectrum}, 2};
+        checkChain(single.name, single, split);
+    }
+    {
+        // reads rows across the split, so the pipeline must put a barrier between the effects
+        EffectChain single{"Rays from center", {&a->moveFromCenter, &a->changeBrightness, &a->rays}, 3};
+        EffectChain split{"Rays from center", {&b->moveFromCenter, &b->changeBrightness, &b->rays}, 3};
+        checkChain(single.name, single, split);
+    }
+    {
+        EffectChain single{"Rotating sparks", {&a->rotoBlit, &a->spectrum, &a->particles}, 3};
+        EffectChain split{"Rotating sparks", {&b->rotoBlit, &b->spectrum, &b->particles}, 3};
+        checkChain(single.name, single, split);
+    }
+    {
+        // fills the source the next effect reads across the split, so both halves must be filled first
+        EffectChain single{"Rotated fill", {&a->fillSource, &a->rotoBlit, &a->rays}, 3};
+        EffectChain split{"Rotated fill", {&b->fillSource, &b->rotoBlit, &b->rays}, 3};
+        checkChain(single.name, single, split);
+    }
+    return HostTest::result();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "screen.h"
+
+// Screen with an 8-bit back buffer in memory for host tests. Blits convert pixels like SMLayerScreen
+template <int WIDTH, int HEIGHT>
+class FakeScreen : public Screen
+{
+public:
+    virtual void blit(const RGBf *src) override
+    {
+        blitRows(src, 0, HEIGHT);
+    }
+
+    virtual void blitRows(const RGBf *src, int firstRow, int endRow) override
+    {
+        auto dest = backBuffer() + firstRow * WIDTH;
+        for (int i = 0; i < (endRow - firstRow) * WIDTH; i++)
+        {
+            storePixel(dest[i], src[i]);
+        }
+        blits++;
+    }
+
+    virtual RGB8 *backBuffer() override
+    {
+        return m_backBuffer;
+    }
+
+    virtual void swap() override
+    {
+    }
+
+    unsigned blits = 0; // Number of blitRows() calls
+
+private:
+    RGB8 m_backBuffer[WIDTH * HEIGHT] = {};
+};
@@ -0,0 +1,99 @@
+#include "host_test.h"
+
+#include "effects_feedback.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+// Renders MoveFromCenter in strips over the whole distance range and checks that it only reads rows inside the frame
+// and inside the source rows it reports, so the pipelines can split frames and copy the right rows for each strip
+
+static constexpr unsigned WIDTH = 8;
+static constexpr unsigned HEIGHT = 32;
+static constexpr int OUTSIDE = -1000; // Marks padding around the source frame
+
+// Render strips of strip rows each. Every source row holds its row number, padding holds OUTSIDE.
+// Pixels read from outside the reported source rows show up as wrong row numbers in the destination
+void checkStrips(Effects::MoveFromCenter<WIDTH, HEIGHT> &effect, float distance, int stripRows)
+{
+    const auto frame = AnalysisFrame();
+    std::vector<RGBf> source(3 * HEIGHT * WIDTH);
+    std::vector<RGBf> dest(HEIGHT * WIDTH);
+    for (int y = -static_cast<int>(HEIGHT); y < static_cast<int>(2 * HEIGHT); y++)
+    {
+        const float value = y >= 0 && y < static_cast<int>(HEIGHT) ? static_cast<float>(y) : static_cast<float>(OUTSIDE);
+        for (unsigned x = 0; x < WIDTH; x++)
+        {
+            source[(y + HEIGHT) * WIDTH + x] = RGBf(value, value, value);
+        }
+    }
+    for (int firstRow = 0; firstRow < static_cast<int>(HEIGHT); firstRow += stripRows)
+    {
+        const int endRow = firstRow + stripRows;
+        const auto rows = effect.sourceRows(firstRow, endRow, HEIGHT);
+        if (!CHECK(rows.first >= 0 && rows.first < rows.second && rows.second <= static_cast<int>(HEIGHT)))
+        {
+            std::printf("Distance %.3f, rows [%d, %d): source rows [%d, %d)\n", distance, firstRow, endRow, rows.first, rows.second);
+            continue;
+        }
+        // only rows the effect asked for are valid, mark the rest like the padding
+        std::vector<RGBf> visible(source);
+        for (int y = 0; y < static_cast<int>(HEIGHT); y++)
+        {
+            if (y < rows.first || y >= rows.second)
+            {
+                for (unsigned x = 0; x < WIDTH; x++)
+                {
+                    visible[(y + HEIGHT) * WIDTH + x] = RGBf(OUTSIDE, OUTSIDE, OUTSIDE);
+                }
+            }
+        }
+        Strip strip;
+        strip.dest = dest.data() + firstRow * WIDTH;
+        strip.src = visible.data() + (rows.first + HEIGHT) * WIDTH;
+        strip.width = WIDTH;
+        strip.height = HEIGHT;
+        strip.firstRow = firstRow;
+        strip.endRow = endRow;
+        strip.srcFirstRow = rows.first;
+        strip.srcEndRow = rows.second;
+        effect.render(strip, frame);
+        for (int y = firstRow; y < endRow; y++)
+        {
+            const float row = strip.destRow(y)[0].r;
+            if (!CHECK(row >= rows.first && row < rows.second))
+            {
+                std::printf("Distance %.3f, row %d: read row %.0f outside of source rows [%d, %d)\n", distance, y, row, rows.first, rows.second);
+            }
+        }
+    }
+}
+
+int main()
+{
+    auto effect = Effects::MoveFromCenter<WIDTH, HEIGHT>();
+    auto &registry = ParameterRegistry::instance();
+    const auto frame = AnalysisFrame();
+    for (float distance = 0.0F; distance <= 4.0F; distance += 0.125F)
+    {
+        registry.set("MoveFromCenter.distance", distance);
+        effect.prepare(0.02F, frame);
+        for (int stripRows : {1, 4, 8, 16, 32})
+        {
+            checkStrips(effect, distance, stripRows);
+        }
+    }
+    // NaN must not reach the effect, it would turn into an arbitrary row
+    registry.set("MoveFromCenter.distance", 1.5F);
+    registry.set("MoveFromCenter.distance", std::numeric_limits<float>::quiet_NaN());
+    effect.prepare(0.02F, frame);
+    CHECK(registry.first() != nullptr);
+    for (auto parameter = registry.first(); parameter != nullptr; parameter = parameter->next())
+    {
+        CHECK(parameter->get() == 1.5F);
+    }
+    checkStrips(effect, 1.5F, 8);
+    return HostTest::result();
+}
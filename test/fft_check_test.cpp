@@ -0,0 +1,53 @@
+#include "host_test.h"
+
+#include "fft_check.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Runs the shared FFT accuracy check on the backends available on the host and checks that the
+// stereo transform of the reference backend matches two mono transforms
+
+template <unsigned SAMPLE_COUNT>
+void checkStereo()
+{
+    constexpr double Pi = 3.14159265358979323846;
+    std::vector<float> left(SAMPLE_COUNT);
+    std::vector<float> right(SAMPLE_COUNT);
+    for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+    {
+        left[i] = static_cast<float>(100000.0 * std::sin(2.0 * Pi * 37.25 * i / SAMPLE_COUNT));
+        right[i] = static_cast<float>(30000.0 * std::sin(2.0 * Pi * 101.5 * i / SAMPLE_COUNT) + 5000.0 * std::cos(2.0 * Pi * 7.0 * i / SAMPLE_COUNT));
+    }
+    std::vector<float> leftMono(left);
+    std::vector<float> rightMono(right);
+    auto stereo = std::unique_ptr<FFTBackendReference<SAMPLE_COUNT>>(new FFTBackendReference<SAMPLE_COUNT>(left.data()));
+    auto monoLeft = std::unique_ptr<FFTBackendReference<SAMPLE_COUNT>>(new FFTBackendReference<SAMPLE_COUNT>(leftMono.data()));
+    auto monoRight = std::unique_ptr<FFTBackendReference<SAMPLE_COUNT>>(new FFTBackendReference<SAMPLE_COUNT>(rightMono.data()));
+    stereo->calculateStereo(right.data());
+    monoLeft->calculate();
+    monoRight->calculate();
+    float peak = 0.0F;
+    float maxError = 0.0F;
+    for (unsigned i = 0; i < SAMPLE_COUNT / 2; i++)
+    {
+        peak = leftMono[i] > peak ? leftMono[i] : peak;
+        const float error = std::fabs(left[i] - leftMono[i]) > std::fabs(right[i] - rightMono[i]) ? std::fabs(left[i] - leftMono[i]) : std::fabs(right[i] - rightMono[i]);
+        maxError = error > maxError ? error : maxError;
+    }
+    const float errorDb = 20.0F * std::log10(maxError / peak + 1e-12F);
+    std::printf("Reference stereo vs. mono, %u samples: max. difference %.1f dB\n", SAMPLE_COUNT, errorDb);
+    CHECK(errorDb < -100.0F);
+}
+
+int main()
+{
+    // 256 samples with decimation, 1024 without
+    CHECK(FFTCheck<256, 12000>::runAll());
+    CHECK(FFTCheck<512>::runAll());
+    CHECK(FFTCheck<1024>::runAll());
+    checkStereo<256>();
+    checkStereo<1024>();
+    return HostTest::result();
+}
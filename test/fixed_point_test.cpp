@@ -0,0 +1,210 @@
+#include "host_test.h"
+
+#include "fft.h"
+#include "fixed_point.h"
+#include "normalization.h"
+#include "sos_filter_q31.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Checks the integer analysis path (SOSFilterQ31, FFTBackendQ15, log2Q16, Normalization<..., int32_t>) on fixed input vectors:
+// - Every stage is compared against the floating-point path within the tolerances stated in the headers
+// - The integer results are hashed and compared against golden hashes. The path only uses integer operations,
+//   so the device must produce the same bits. Update the hashes only for intended changes of the integer path
+
+static constexpr unsigned SAMPLE_COUNT = 1024;
+static constexpr unsigned SAMPLE_RATE_HZ = 48000;
+static constexpr unsigned NR_OF_FRAMES = 240;
+static constexpr unsigned AUDIO_NOISE_DB = 33;
+static constexpr unsigned AUDIO_MAX_DB = 120;
+static constexpr unsigned MAX_HZ = 4000;
+// Microphone calibration of the sketch: INMP441, -26dBFS at 94dB, 24 bits
+static const float MicRefAmplitude = std::pow(10.0F, -26.0F / 20.0F) * ((1 << 23) - 1);
+static const float AmplitudeOneDb = 3.0103F + 94.0F + 20.0F * std::log10(1.0F / MicRefAmplitude);
+
+static constexpr uint64_t GoldenFilterHash = 0xa532ac1c7417643eULL;
+static constexpr uint64_t GoldenFFTHash = 0x743fe405cba4ec34ULL;
+static constexpr uint64_t GoldenMagnitudeHash = 0xc35b2de37b96e6f3ULL;
+
+// A-weighting filter of esp32-i2s-slm/filters.h with the members of SOS_IIR_Filter that SOSFilterQ31 reads
+struct FloatFilter
+{
+    struct Coefficients
+    {
+        float b1;
+        float b2;
+        float a1;
+        float a2;
+    };
+
+    int num_sos = 3;
+    float gain = 0.169994948147430F;
+    Coefficients sos[3] = {
+        {-2.00026996133106F, +1.00027056142719F, -1.060868438509278F, -0.163987445885926F},
+        {+4.35912384203144F, +3.09120265783884F, +1.208419926363593F, -0.273166998428332F},
+        {-0.70930303489759F, -0.29071868393580F, +1.982242159753048F, -0.982298594928989F}};
+};
+
+// Double precision version of SOS_IIR_Filter as reference. Direct form II, a1 and a2 are stored negated
+class ReferenceFilter
+{
+public:
+    explicit ReferenceFilter(const FloatFilter &filter) : m_filter(filter) {}
+
+    void apply(const int32_t *input, double *output, unsigned count)
+    {
+        for (unsigned i = 0; i < count; i++)
+        {
+            double x = input[i];
+            for (int s = 0; s < m_filter.num_sos; s++)
+            {
+                const auto &c = m_filter.sos[s];
+                const double w0 = x + c.a1 * m_state[s][0] + c.a2 * m_state[s][1];
+                x = w0 + c.b1 * m_state[s][0] + c.b2 * m_state[s][1];
+                m_state[s][1] = m_state[s][0];
+                m_state[s][0] = w0;
+            }
+            output[i] = x * m_filter.gain;
+        }
+    }
+
+private:
+    FloatFilter m_filter;
+    double m_state[3][2] = {};
+};
+
+// FNV-1a hash over the bytes of values
+template <typename T>
+void hash(uint64_t &h, const T *values, unsigned count)
+{
+    const auto bytes = reinterpret_cast<const uint8_t *>(values);
+    for (unsigned i = 0; i < count * sizeof(T); i++)
+    {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+}
+
+// Two tones and noise. The amplitude sweeps from ~40dB to ~120dB every 80 frames
+void generate(unsigned frame, int32_t *samples, uint32_t &random)
+{
+    constexpr double Pi = 3.14159265358979323846;
+    const double amplitude = 100.0 * std::pow(10.0, 4.0 * (frame % 80) / 80.0);
+    for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+    {
+        const double t = static_cast<double>(frame * SAMPLE_COUNT + i) / SAMPLE_RATE_HZ;
+        random = random * 1664525 + 1013904223;
+        const double noise = static_cast<double>(random) / 4294967296.0 - 0.5;
+        samples[i] = static_cast<int32_t>(std::lround(amplitude * (std::sin(2.0 * Pi * 440.0 * t) + 0.3 * std::sin(2.0 * Pi * 1870.0 * t) + 0.1 * noise)));
+    }
+}
+
+void checkLog2()
+{
+    int32_t maxError = 0;
+    uint32_t random = 12345;
+    for (uint32_t i = 1; i < (1U << 22); i++)
+    {
+        random = random * 1664525 + 1013904223;
+        for (uint32_t x : {i, random | 1U})
+        {
+            const auto expected = static_cast<int32_t>(std::lround(std::log2(static_cast<double>(x)) * 65536.0));
+            const auto error = std::abs(log2Q16(x) - expected);
+            maxError = error > maxError ? error : maxError;
+        }
+    }
+    std::printf("log2Q16: max. error %d LSBs\n", maxError);
+    CHECK(maxError <= 4);
+    CHECK(log2Q16(0) == Log2Q16OfZero);
+}
+
+int main()
+{
+    checkLog2();
+
+    using FloatNormalization = Normalization<SAMPLE_COUNT, AUDIO_NOISE_DB, AUDIO_MAX_DB, MAX_HZ, SAMPLE_RATE_HZ>;
+    using IntNormalization = Normalization<SAMPLE_COUNT, AUDIO_NOISE_DB, AUDIO_MAX_DB, MAX_HZ, SAMPLE_RATE_HZ, int32_t>;
+    const FloatFilter filter;
+    auto referenceFilter = ReferenceFilter(filter);
+    auto filterQ31 = SOSFilterQ31(filter);
+    std::vector<int32_t> input(SAMPLE_COUNT);
+    std::vector<double> filtered(SAMPLE_COUNT);
+    std::vector<float> floatSamples(SAMPLE_COUNT);
+    std::vector<int32_t> intSamples(SAMPLE_COUNT);
+    std::vector<float> amplitudes(SAMPLE_COUNT / 2);
+    auto floatFFT = std::unique_ptr<FFTBackendReference<SAMPLE_COUNT, SAMPLE_RATE_HZ>>(new FFTBackendReference<SAMPLE_COUNT, SAMPLE_RATE_HZ>(floatSamples.data()));
+    auto intFFT = std::unique_ptr<FFTBackendQ15<SAMPLE_COUNT, SAMPLE_RATE_HZ>>(new FFTBackendQ15<SAMPLE_COUNT, SAMPLE_RATE_HZ>(intSamples.data()));
+    auto floatNormalization = FloatNormalization(AmplitudeOneDb);
+    auto intNormalization = IntNormalization(AmplitudeOneDb);
+    uint64_t filterHash = 0xcbf29ce484222325ULL;
+    uint64_t fftHash = 0xcbf29ce484222325ULL;
+    uint64_t magnitudeHash = 0xcbf29ce484222325ULL;
+    double maxFilterError = 0.0;   // In LSBs
+    double maxLoudLog2Error = 0.0; // In dB, bins within 30dB of the loudest bin
+    double maxMidLog2Error = 0.0;  // In dB, bins 30dB to 60dB below the loudest bin
+    double maxLoudError = 0.0;     // Magnitude error of bins within 50dB of the loudest bin
+    double maxQuietError = 0.0;    // Magnitude error of quieter bins
+    uint32_t random = 1;
+    for (unsigned frame = 0; frame < NR_OF_FRAMES; frame++)
+    {
+        generate(frame, input.data(), random);
+        // A-weighting
+        referenceFilter.apply(input.data(), filtered.data(), SAMPLE_COUNT);
+        filterQ31.applyFilters(input.data(), intSamples.data(), SAMPLE_COUNT);
+        filterQ31.applyGain(intSamples.data(), intSamples.data(), SAMPLE_COUNT);
+        hash(filterHash, intSamples.data(), SAMPLE_COUNT);
+        // the first frame of a sweep contains the tail of the loudest frame, which the 16-bit FFT can not resolve below it
+        const bool restart = frame % 80 == 0;
+        for (unsigned i = 0; i < SAMPLE_COUNT; i++)
+        {
+            const double error = std::fabs(intSamples[i] - filtered[i]);
+            maxFilterError = error > maxFilterError ? error : maxFilterError;
+            // feed both FFTs the same integer samples, so they can be compared on their own
+            floatSamples[i] = static_cast<float>(intSamples[i]);
+        }
+        // FFT
+        floatFFT->calculate();
+        intFFT->calculate();
+        hash(fftHash, intSamples.data(), SAMPLE_COUNT / 2);
+        float peak = 0.0F;
+        for (unsigned i = 1; i < SAMPLE_COUNT / 2; i++)
+        {
+            peak = floatSamples[i] > peak ? floatSamples[i] : peak;
+        }
+        for (unsigned i = 1; i < SAMPLE_COUNT / 2; i++)
+        {
+            amplitudes[i] = floatSamples[i];
+            const double errorDb = 20.0 * std::log10(2.0) * std::fabs(intSamples[i] / 65536.0 - std::log2(floatSamples[i]));
+            auto &maxError = floatSamples[i] > peak * 0.0316F ? maxLoudLog2Error : maxMidLog2Error;
+            maxError = !restart && floatSamples[i] > peak * 0.001F && errorDb > maxError ? errorDb : maxError;
+        }
+        // dB conversion and AGC
+        const float *floatMagnitudes = floatNormalization.apply(floatSamples.data());
+        const float *intMagnitudes = intNormalization.apply(intSamples.data());
+        hash(magnitudeHash, intMagnitudes, SAMPLE_COUNT / 2);
+        for (unsigned i = 1; i < MAX_HZ * SAMPLE_COUNT / SAMPLE_RATE_HZ; i++)
+        {
+            const double error = std::fabs(floatMagnitudes[i] - intMagnitudes[i]);
+            auto &maxError = amplitudes[i] > peak * 0.00316F ? maxLoudError : maxQuietError;
+            maxError = !restart && error > maxError ? error : maxError;
+        }
+    }
+    std::printf("SOSFilterQ31: max. error %.2f LSBs\n", maxFilterError);
+    std::printf("FFTBackendQ15: max. magnitude error %.3f dB within 30dB of the loudest bin, %.3f dB 30dB to 60dB below\n", maxLoudLog2Error, maxMidLog2Error);
+    std::printf("Normalization: max. magnitude error %.4f within 50dB of the loudest bin, %.4f below\n", maxLoudError, maxQuietError);
+    std::printf("Hashes: filter 0x%016llx, FFT 0x%016llx, magnitudes 0x%016llx\n", static_cast<unsigned long long>(filterHash),
+                static_cast<unsigned long long>(fftHash), static_cast<unsigned long long>(magnitudeHash));
+    CHECK(maxFilterError < 5.0);
+    CHECK(maxLoudLog2Error < 0.1);
+    CHECK(maxMidLog2Error < 4.0);
+    CHECK(maxLoudError < 0.02);
+    CHECK(maxQuietError < 0.5);
+    CHECK(filterHash == GoldenFilterHash);
+    CHECK(fftHash == GoldenFFTHash);
+    CHECK(magnitudeHash == GoldenMagnitudeHash);
+    return HostTest::result();
+}
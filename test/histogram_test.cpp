@@ -0,0 +1,39 @@
+#include "host_test.h"
+
+#include "histogram.h"
+
+#include <cstdio>
+
+// Checks the percentiles of Histogram against known distributions:
+// - Percentiles are the upper bound of the bucket holding the value of that rank
+// - Values beyond the last bucket are counted in the last bucket
+
+int main()
+{
+    auto empty = Histogram<64, 50>();
+    CHECK(empty.percentile(0.5F) == 0);
+    // 100 values 0..99 x 10us. p50 is the 50th value 490us, p99 the 99th value 980us
+    auto ramp = Histogram<64, 50>();
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        ramp.add(i * 10);
+    }
+    std::printf("Ramp: p50 %u, p99 %u, p100 %u\n", static_cast<unsigned>(ramp.percentile(0.5F)), static_cast<unsigned>(ramp.percentile(0.99F)),
+                static_cast<unsigned>(ramp.percentile(1.0F)));
+    CHECK(ramp.count() == 100);
+    CHECK(ramp.percentile(0.0F) == 50);
+    CHECK(ramp.percentile(0.5F) == 500);
+    CHECK(ramp.percentile(0.99F) == 1000);
+    CHECK(ramp.percentile(1.0F) == 1000);
+    // 60 frames with one outlier, like one second of frame timing at 60 Hz: p99 is the outlier, p50 is not
+    auto frames = Histogram<64, 50>();
+    for (uint32_t i = 0; i < 59; i++)
+    {
+        frames.add(i % 2 == 0 ? 333 : 667);
+    }
+    frames.add(10000);
+    CHECK(frames.percentile(0.5F) == 350);
+    CHECK(frames.percentile(0.9F) == 700);
+    CHECK(frames.percentile(0.99F) == 64 * 50);
+    return HostTest::result();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal check helpers for host tests. Failed checks are printed and counted, main() returns HostTest::result()
+namespace HostTest
+{
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    /// @brief Count and print a failed check
+    inline bool check(bool condition, const char *expression, const char *file, int line)
+    {
+        if (!condition)
+        {
+            std::printf("%s:%d: check failed: %s\n", file, line, expression);
+            failures()++;
+        }
+        return condition;
+    }
+
+    /// @brief Print summary
+    /// @return Returns the exit code of the test, 0 if all checks passed
+    inline int result()
+    {
+        if (failures() > 0)
+        {
+            std::printf("%d check(s) FAILED\n", failures());
+            return 1;
+        }
+        std::printf("All checks passed\n");
+        return 0;
+    }
+}
+
+#define CHECK(...) HostTest::check((__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
@@ -0,0 +1,209 @@
+#include "host_test.h"
+
+#include "cycle_counter.h"
+#include "logging.h"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks the deferred logging ring and logger:
+// - Records come out in the order they were logged and are formatted like Serial_printf
+// - Records that do not fit into a full ring are dropped, counted and reported once by drain()
+// - Concurrent producers never lose or reorder their own records, everything not dropped arrives complete.
+//   Every failed push is counted
+
+static constexpr unsigned NR_OF_PRODUCERS = 4;
+static constexpr uint32_t RECORDS_PER_PRODUCER = 20000;
+
+// Collects printed text like Arduino's Print
+struct StringPrint
+{
+    std::string text;
+
+    void print(const char *s) { text += s; }
+    void print(char c) { text += c; }
+    void print(double value, int places)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.*f", places, value);
+        text += buffer;
+    }
+    void print(int value, int base) { print(static_cast<long>(value), base); }
+    void print(long value, int base)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", value);
+        text += buffer;
+    }
+};
+
+void checkOrder()
+{
+    auto &logger = Log::Logger::instance();
+    Log::info("first %d\n", 1);
+    Log::error("second %.1f %s\n", 2.5F, "text");
+    Log::warning("third %l\n", 3L);
+    Log::debug("removed at compile time\n");
+    StringPrint out;
+    CHECK(logger.drain(out) == 3);
+    CHECK(out.text == "first 1\nError: second 2.5 text\nWarning: third 3\n");
+    CHECK(logger.drain(out) == 0);
+}
+
+void checkFull()
+{
+    // a ring of its own: pushes beyond the capacity fail until the consumer frees records
+    auto ring = std::unique_ptr<Log::Ring<8>>(new Log::Ring<8>());
+    for (Log::Word i = 0; i < 10; i++)
+    {
+        CHECK(ring->push(Log::Level::Info, "%d", &i, 1) == (i < 8));
+    }
+    CHECK(ring->dropped() == 2);
+    for (Log::Word i = 0; i < 8; i++)
+    {
+        const auto record = ring->peek();
+        if (!CHECK(record != nullptr))
+        {
+            return;
+        }
+        CHECK(record->arguments[0] == i);
+        ring->release();
+        // the freed slot is usable right away
+        const Log::Word value = 100 + i;
+        CHECK(ring->push(Log::Level::Info, "%d", &value, 1));
+    }
+    CHECK(ring->peek() != nullptr && ring->peek()->arguments[0] == 100);
+    CHECK(ring->dropped() == 2);
+    // the logger reports drops once
+    auto &logger = Log::Logger::instance();
+    for (int i = 0; i < 70; i++)
+    {
+        Log::info("record %d\n", i);
+    }
+    StringPrint out;
+    CHECK(logger.drain(out) == 64);
+    CHECK(out.text.find("record 63\nLog records dropped: 6\n") != std::string::npos);
+    CHECK(out.text.find("record 64") == std::string::npos);
+    out.text.clear();
+    Log::info("after %d\n", 1);
+    CHECK(logger.drain(out) == 1);
+    CHECK(out.text == "after 1\n");
+}
+
+void checkConcurrentProducers()
+{
+    auto ring = std::unique_ptr<Log::Ring<64>>(new Log::Ring<64>());
+    std::atomic<bool> start{false};
+    std::atomic<unsigned> producersDone{0};
+    uint32_t dropped[NR_OF_PRODUCERS] = {0};  // Records given up
+    uint32_t failures[NR_OF_PRODUCERS] = {0}; // Failed pushes, including retries
+    std::vector<std::thread> producers;
+    for (unsigned producer = 0; producer < NR_OF_PRODUCERS; producer++)
+    {
+        producers.emplace_back([&, producer]()
+                               {
+            while (!start.load())
+            {
+                std::this_thread::yield();
+            }
+            // every fourth record may be dropped, the others are retried until they fit
+            for (uint32_t i = 0; i < RECORDS_PER_PRODUCER; i++)
+            {
+                const Log::Word words[3] = {producer, i, producer ^ i};
+                while (!ring->push(Log::Level::Info, "%d %d %d", words, 3))
+                {
+                    failures[producer]++;
+                    if (i % 4 == 3)
+                    {
+                        dropped[producer]++;
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            producersDone++; });
+    }
+    // consume on this thread while the producers run
+    uint32_t next[NR_OF_PRODUCERS] = {0};
+    uint32_t received[NR_OF_PRODUCERS] = {0};
+    bool inOrder = true;
+    bool complete = true;
+    start = true;
+    while (true)
+    {
+        const bool done = producersDone.load() == NR_OF_PRODUCERS;
+        for (auto record = ring->peek(); record != nullptr; record = ring->peek())
+        {
+            const auto producer = record->arguments[0];
+            const auto i = static_cast<uint32_t>(record->arguments[1]);
+            complete = complete && record->count == 3 && producer < NR_OF_PRODUCERS && record->arguments[2] == (producer ^ i);
+            if (producer < NR_OF_PRODUCERS)
+            {
+                // records that must not be dropped arrive without gaps
+                inOrder = inOrder && (i == next[producer] || (i == next[producer] + 1 && next[producer] % 4 == 3));
+                next[producer] = i + 1;
+                received[producer]++;
+            }
+            ring->release();
+        }
+        if (done)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    for (auto &producer : producers)
+    {
+        producer.join();
+    }
+    uint32_t totalReceived = 0;
+    uint32_t totalDropped = 0;
+    uint32_t totalFailures = 0;
+    for (unsigned producer = 0; producer < NR_OF_PRODUCERS; producer++)
+    {
+        CHECK(received[producer] + dropped[producer] == RECORDS_PER_PRODUCER);
+        totalReceived += received[producer];
+        totalDropped += dropped[producer];
+        totalFailures += failures[producer];
+    }
+    std::printf("Concurrent: %u producers, %u records received, %u dropped, %u failed pushes\n", NR_OF_PRODUCERS, static_cast<unsigned>(totalReceived),
+                static_cast<unsigned>(totalDropped), static_cast<unsigned>(totalFailures));
+    CHECK(inOrder);
+    CHECK(complete);
+    CHECK(ring->dropped() == totalFailures);
+}
+
+// Time to log a record into a ring with room, without contention
+void measurePush()
+{
+    constexpr unsigned NrOfRecords = 64;
+    auto ring = std::unique_ptr<Log::Ring<NrOfRecords>>(new Log::Ring<NrOfRecords>());
+    const Log::Word words[2] = {1, 2};
+    uint32_t cycles = 0;
+    for (unsigned run = 0; run < 1000; run++)
+    {
+        const auto start = CycleCounter::now();
+        for (unsigned i = 0; i < NrOfRecords; i++)
+        {
+            ring->push(Log::Level::Info, "%d %d", words, 2);
+        }
+        cycles += CycleCounter::now() - start;
+        while (ring->peek() != nullptr)
+        {
+            ring->release();
+        }
+    }
+    std::printf("Push: %.1f %s / record\n", static_cast<double>(cycles) / (1000 * NrOfRecords), CycleCounter::Unit);
+}
+
+int main()
+{
+    checkOrder();
+    checkFull();
+    checkConcurrentProducers();
+    measurePush();
+    return HostTest::result();
+}
@@ -0,0 +1,15 @@
+#include "host_test.h"
+
+#include "particles_check.h"
+
+// Runs the particle benchmark and checks that a pool of PARTICLE_POOL_SIZE (2048) particles drops none with all bands at 30%
+// and beats at 120 BPM, while 512 particles, the previous pool size, can not keep up with that
+
+int main()
+{
+    ParticlesCheck<32, 32, 32, 60>::runAll();
+    CHECK(ParticlesCheck<32, 32, 32, 60>::run<2048>(0.3F) == 0);
+    CHECK(ParticlesCheck<64, 64, 32, 60>::run<2048>(0.3F) == 0);
+    CHECK(ParticlesCheck<32, 32, 32, 60>::run<512>(0.3F) > 0);
+    return HostTest::result();
+}
@@ -0,0 +1,171 @@
+#include "host_test.h"
+
+#include "pixel_stream.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Sends DDP frames from a PixelStreamSender to a PixelStreamReceiver over the loopback interface and checks that:
+// - Frames of several packets arrive complete and unchanged
+// - Packets with other data types, queries and packets for other devices are dropped without touching the frame
+// - A 128x64 stream at 60 fps arrives without lost packets while another thread receives it, like the pixel stream task
+
+static constexpr uint16_t TEST_PORT = 42148;
+static constexpr uint16_t PACED_TEST_PORT = 42149;
+static constexpr int WIDTH = 64;
+static constexpr int HEIGHT = 32;
+static constexpr unsigned NR_OF_PIXELS = WIDTH * HEIGHT;
+
+using Receiver = PixelStreamReceiver<WIDTH, HEIGHT>;
+
+// Send a hand-made DDP packet with pixel data of the given value
+void sendRaw(uint8_t flags, uint8_t type, uint8_t id, uint32_t offset, unsigned length, uint8_t value)
+{
+    std::vector<uint8_t> packet(Ddp::HEADER_SIZE + length, value);
+    packet[0] = Ddp::VERSION_1 | flags;
+    packet[1] = 0;
+    packet[2] = type;
+    packet[3] = id;
+    packet[4] = offset >> 24;
+    packet[5] = offset >> 16;
+    packet[6] = offset >> 8;
+    packet[7] = offset;
+    packet[8] = length >> 8;
+    packet[9] = length;
+    const int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in destination = {};
+    destination.sin_family = AF_INET;
+    destination.sin_port = htons(TEST_PORT);
+    destination.sin_addr.s_addr = inet_addr("127.0.0.1");
+    CHECK(sendto(s, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr *>(&destination), sizeof(destination)) == static_cast<ssize_t>(packet.size()));
+    close(s);
+}
+
+// Receive until a frame is pushed or no packets arrive for a while
+bool receiveFrame(Receiver &receiver, RGB8 *frame)
+{
+    while (receiver.wait(200))
+    {
+        if (receiver.receive(frame))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pixel i of frame number frame
+RGB8 testPixel(unsigned i, unsigned frame)
+{
+    return {static_cast<uint8_t>(i), static_cast<uint8_t>(i >> 8), static_cast<uint8_t>(frame)};
+}
+
+// Send a 128x64 stream at 60 fps, 18 packets per frame, and receive it in another thread.
+// Every frame must arrive complete. Frames may be received late, but must not mix pixels of different frames
+void checkPacedStream()
+{
+    constexpr int Width = 128;
+    constexpr int Height = 64;
+    constexpr unsigned NrOfPixels = Width * Height;
+    constexpr unsigned NrOfFrames = 120;
+    constexpr auto FrameInterval = std::chrono::microseconds(1000000 / 60);
+    using PacedReceiver = PixelStreamReceiver<Width, Height>;
+    auto receiver = std::unique_ptr<PacedReceiver>(new PacedReceiver());
+    auto sender = PixelStreamSender();
+    CHECK(receiver->begin(PACED_TEST_PORT));
+    CHECK(sender.begin("127.0.0.1", PACED_TEST_PORT));
+    std::atomic<bool> sending(true);
+    unsigned mixedFrames = 0;
+    // receive like the pixel stream task, until the sender is done and no packets are left
+    auto receive = [&receiver, &sending, &mixedFrames]()
+    {
+        std::vector<RGB8> frame(NrOfPixels);
+        while (receiver->wait(100) || sending)
+        {
+            if (receiver->receive(frame.data()))
+            {
+                const unsigned number = frame[0].b;
+                for (unsigned i = 0; i < NrOfPixels; i++)
+                {
+                    const auto expected = testPixel(i, number);
+                    if (frame[i].r != expected.r || frame[i].g != expected.g || frame[i].b != expected.b)
+                    {
+                        mixedFrames++;
+                        break;
+                    }
+                }
+            }
+        }
+    };
+    std::thread receiverThread(receive);
+    std::vector<RGB8> sent(NrOfPixels);
+    auto next = std::chrono::steady_clock::now();
+    for (unsigned frame = 0; frame < NrOfFrames; frame++)
+    {
+        for (unsigned i = 0; i < NrOfPixels; i++)
+        {
+            sent[i] = testPixel(i, frame);
+        }
+        CHECK(sender.send(sent.data(), NrOfPixels));
+        next += FrameInterval;
+        std::this_thread::sleep_until(next);
+    }
+    sending = false;
+    receiverThread.join();
+    std::printf("128x64 at 60 fps: frames %u, incomplete %u, lost %u, mixed %u\n", static_cast<unsigned>(receiver->frames()),
+                static_cast<unsigned>(receiver->incompleteFrames()), static_cast<unsigned>(receiver->lostPackets()), mixedFrames);
+    CHECK(receiver->frames() == NrOfFrames);
+    CHECK(receiver->incompleteFrames() == 0);
+    CHECK(receiver->lostPackets() == 0);
+    CHECK(receiver->invalidPackets() == 0);
+    CHECK(mixedFrames == 0);
+}
+
+int main()
+{
+    auto receiver = Receiver();
+    auto sender = PixelStreamSender();
+    CHECK(receiver.begin(TEST_PORT));
+    CHECK(sender.begin("127.0.0.1", TEST_PORT));
+    std::vector<RGB8> sent(NR_OF_PIXELS);
+    std::vector<RGB8> received(NR_OF_PIXELS);
+    for (unsigned frame = 0; frame < 3; frame++)
+    {
+        for (unsigned i = 0; i < NR_OF_PIXELS; i++)
+        {
+            sent[i] = testPixel(i, frame);
+        }
+        CHECK(sender.send(sent.data(), NR_OF_PIXELS));
+        CHECK(receiveFrame(receiver, received.data()));
+        CHECK(memcmp(sent.data(), received.data(), sizeof(RGB8) * NR_OF_PIXELS) == 0);
+    }
+    CHECK(receiver.frames() == 3);
+    CHECK(receiver.incompleteFrames() == 0);
+    CHECK(receiver.lostPackets() == 0);
+    CHECK(receiver.invalidPackets() == 0);
+    // other data types, e.g. 16-bit RGB or grayscale, queries and packets for other devices must not be written into the frame
+    constexpr uint8_t TypeRGB16 = 0x0D;
+    constexpr uint8_t TypeGray8 = 0x13;
+    sendRaw(Ddp::FLAG_PUSH, TypeRGB16, Ddp::ID_DISPLAY, 0, 96, 0xAA);
+    sendRaw(Ddp::FLAG_PUSH, TypeGray8, Ddp::ID_DISPLAY, 0, 96, 0xAA);
+    sendRaw(Ddp::FLAG_PUSH, 0, Ddp::ID_ALL, 0, 96, 0xAA);
+    sendRaw(Ddp::FLAG_PUSH | Ddp::FLAG_QUERY, Ddp::TYPE_RGB8, Ddp::ID_DISPLAY, 0, 96, 0xAA);
+    sendRaw(Ddp::FLAG_PUSH, Ddp::TYPE_RGB8, 2, 0, 96, 0xAA);
+    CHECK(!receiveFrame(receiver, received.data()));
+    CHECK(memcmp(sent.data(), received.data(), sizeof(RGB8) * NR_OF_PIXELS) == 0);
+    CHECK(receiver.invalidPackets() == 5);
+    CHECK(receiver.frames() == 3);
+    // 8-bit RGB packets for all devices are accepted
+    sendRaw(Ddp::FLAG_PUSH, Ddp::TYPE_RGB8, Ddp::ID_ALL, 3, 6, 0x55);
+    CHECK(receiveFrame(receiver, received.data()));
+    CHECK(received[1].r == 0x55 && received[2].b == 0x55 && received[3].r == sent[3].r);
+    std::printf("Frames %u, incomplete %u, lost %u, invalid %u\n", static_cast<unsigned>(receiver.frames()), static_cast<unsigned>(receiver.incompleteFrames()),
+                static_cast<unsigned>(receiver.lostPackets()), static_cast<unsigned>(receiver.invalidPackets()));
+    checkPacedStream();
+    return HostTest::result();
+}
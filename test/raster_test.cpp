@@ -0,0 +1,201 @@
+#include "host_test.h"
+
+#include "raster.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Draws triangles and lines into small frame buffers and checks coverage sums, the top-left fill rule of triangles
+// without anti-aliasing, Xiaolin Wu lines and that drawing in strips of rows gives the same pixels as drawing at once
+
+static constexpr int WIDTH = 32;
+static constexpr int HEIGHT = 32;
+static constexpr int STRIP_ROWS = 8;
+static const RGBf White(1.0F, 1.0F, 1.0F);
+static const RGBf Half(0.5F, 0.5F, 0.5F);
+
+struct Triangle
+{
+    float x0, y0, x1, y1, x2, y2;
+};
+
+// Canvas of the whole frame
+auto canvasFor(std::vector<RGBf> &pixels) -> Raster::Canvas
+{
+    return {pixels.data(), WIDTH, 0, HEIGHT};
+}
+
+auto sum(const std::vector<RGBf> &pixels) -> float
+{
+    float result = 0.0F;
+    for (const auto &pixel : pixels)
+    {
+        result += pixel.r;
+    }
+    return result;
+}
+
+// Triangles sharing edges must add up to the area of their union when anti-aliased
+void checkCoverage()
+{
+    std::vector<RGBf> pixels(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    const auto canvas = canvasFor(pixels);
+    Raster::fillTriangle(canvas, 4.0F, 4.0F, 20.0F, 4.0F, 20.0F, 20.0F, White);
+    Raster::fillTriangle(canvas, 4.0F, 4.0F, 20.0F, 20.0F, 4.0F, 20.0F, White);
+    std::printf("Square of two triangles: coverage %.2f, area 256.00\n", sum(pixels));
+    CHECK(sum(pixels) == 256.0F);
+    // area of an arbitrary triangle is approximated by the distance to the closest edge
+    const Triangle t = {3.2F, 4.7F, 25.9F, 10.3F, 9.4F, 21.8F};
+    const float area = 0.5F * std::fabs((t.x1 - t.x0) * (t.y2 - t.y0) - (t.y1 - t.y0) * (t.x2 - t.x0));
+    std::vector<RGBf> single(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    Raster::fillTriangle(canvasFor(single), t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, White);
+    std::printf("Triangle: coverage %.2f, area %.2f\n", sum(single), area);
+    CHECK(std::fabs(sum(single) - area) < 0.01F * area);
+}
+
+// Without anti-aliasing every pixel center inside the union of triangles sharing edges must be drawn exactly once
+void checkFillRule(const char *name, const std::vector<Triangle> &triangles, int expectedPixels)
+{
+    std::vector<RGBf> pixels(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    const auto canvas = canvasFor(pixels);
+    for (const auto &t : triangles)
+    {
+        Raster::fillTriangle<false>(canvas, t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, Half);
+    }
+    int drawn = 0;
+    int drawnTwice = 0;
+    for (const auto &pixel : pixels)
+    {
+        drawn += pixel.r > 0.0F ? 1 : 0;
+        drawnTwice += pixel.r > 0.5F ? 1 : 0;
+    }
+    std::printf("%s: %d pixels drawn, %d twice\n", name, drawn, drawnTwice);
+    CHECK(drawn == expectedPixels);
+    CHECK(drawnTwice == 0);
+}
+
+// Wu lines spread exactly one pixel of coverage over every column of a shallow line and every row of a steep line
+void checkLines()
+{
+    std::vector<RGBf> shallow(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    Raster::drawLine(canvasFor(shallow), 2.3F, 5.7F, 28.6F, 14.2F, White);
+    bool exact = true;
+    for (int x = 2; x <= 28; x++)
+    {
+        float column = 0.0F;
+        for (int y = 0; y < HEIGHT; y++)
+        {
+            column += shallow[y * WIDTH + x].r;
+        }
+        exact = exact && column == 1.0F;
+    }
+    CHECK(exact);
+    CHECK(sum(shallow) == 27.0F);
+    std::vector<RGBf> steep(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    Raster::drawLine(canvasFor(steep), 20.8F, 29.1F, 11.4F, 3.6F, White);
+    exact = true;
+    for (int y = 3; y <= 29; y++)
+    {
+        float row = 0.0F;
+        for (int x = 0; x < WIDTH; x++)
+        {
+            row += steep[y * WIDTH + x].r;
+        }
+        exact = exact && row == 1.0F;
+    }
+    CHECK(exact);
+    CHECK(sum(steep) == 27.0F);
+}
+
+// Drawing strip by strip must give the same pixels as drawing the whole frame and must not write outside the canvas.
+// Primitives reach outside the frame on all sides
+void checkStrips()
+{
+    const Triangle triangles[] = {{-6.3F, 3.1F, 40.2F, 9.9F, 15.5F, 37.4F}, {16.0F, 16.0F, 30.7F, 20.2F, 24.1F, 31.3F}};
+    std::vector<RGBf> whole(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    auto draw = [&triangles](const Raster::Canvas &canvas)
+    {
+        for (const auto &t : triangles)
+        {
+            Raster::fillTriangle(canvas, t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, Half);
+            Raster::fillTriangle<false, Raster::Blend::Replace>(canvas, t.x2, t.y2, t.x1, t.y1, t.x0, t.y0, Half);
+            Raster::drawLine(canvas, t.x0, t.y0, t.x1, t.y1, White);
+            Raster::drawLine<false>(canvas, t.x1, t.y1, t.x2, t.y2, White);
+        }
+    };
+    draw(canvasFor(whole));
+    // one guard row above and below every strip
+    constexpr float Guard = -1.0F;
+    bool same = true;
+    bool guarded = true;
+    for (int firstRow = 0; firstRow < HEIGHT; firstRow += STRIP_ROWS)
+    {
+        std::vector<RGBf> strip((STRIP_ROWS + 2) * WIDTH, RGBf(0.0F, 0.0F, 0.0F));
+        for (int x = 0; x < WIDTH; x++)
+        {
+            strip[x] = RGBf(Guard, Guard, Guard);
+            strip[(STRIP_ROWS + 1) * WIDTH + x] = RGBf(Guard, Guard, Guard);
+        }
+        draw({strip.data() + WIDTH, WIDTH, firstRow, firstRow + STRIP_ROWS});
+        for (int x = 0; x < WIDTH; x++)
+        {
+            guarded = guarded && strip[x].r == Guard && strip[(STRIP_ROWS + 1) * WIDTH + x].r == Guard;
+        }
+        for (int i = 0; i < STRIP_ROWS * WIDTH; i++)
+        {
+            const auto &a = whole[firstRow * WIDTH + i];
+            const auto &b = strip[WIDTH + i];
+            same = same && a.r == b.r && a.g == b.g && a.b == b.b;
+        }
+    }
+    CHECK(same);
+    CHECK(guarded);
+}
+
+int main()
+{
+    checkCoverage();
+    // square with corners on pixel centers, so the outer edges and the diagonals run through centers
+    checkFillRule("Square split at diagonal", {{2.5F, 2.5F, 18.5F, 2.5F, 18.5F, 18.5F}, {2.5F, 2.5F, 18.5F, 18.5F, 2.5F, 18.5F}}, 16 * 16);
+    checkFillRule("Square split at both diagonals",
+                  {{10.5F, 10.5F, 2.5F, 2.5F, 18.5F, 2.5F},
+                   {10.5F, 10.5F, 18.5F, 2.5F, 18.5F, 18.5F},
+                   {10.5F, 10.5F, 18.5F, 18.5F, 2.5F, 18.5F},
+                   {10.5F, 10.5F, 2.5F, 18.5F, 2.5F, 2.5F}},
+                  16 * 16);
+    // vertical and horizontal shared edges through centers, vertices in both orders
+    checkFillRule("Square split in quarters",
+                  {{2.5F, 2.5F, 10.5F, 2.5F, 10.5F, 10.5F},
+                   {10.5F, 10.5F, 2.5F, 10.5F, 2.5F, 2.5F},
+                   {10.5F, 2.5F, 18.5F, 2.5F, 18.5F, 10.5F},
+                   {18.5F, 10.5F, 10.5F, 10.5F, 10.5F, 2.5F},
+                   {2.5F, 10.5F, 10.5F, 18.5F, 10.5F, 10.5F},
+                   {2.5F, 10.5F, 2.5F, 18.5F, 10.5F, 18.5F},
+                   {10.5F, 10.5F, 18.5F, 10.5F, 18.5F, 18.5F},
+                   {10.5F, 10.5F, 18.5F, 18.5F, 10.5F, 18.5F}},
+                  16 * 16);
+    // fan of rays like DrawSpectrum draws them, with edges at arbitrary angles through a common center
+    std::vector<Triangle> fan;
+    constexpr int Rays = 16;
+    for (int i = 0; i < Rays; i++)
+    {
+        const float a0 = 2.0F * static_cast<float>(M_PI) * i / Rays;
+        const float a1 = 2.0F * static_cast<float>(M_PI) * (i + 1) / Rays;
+        fan.push_back({16.0F, 16.0F, 16.0F + 12.0F * std::cos(a0), 16.0F + 12.0F * std::sin(a0), 16.0F + 12.0F * std::cos(a1), 16.0F + 12.0F * std::sin(a1)});
+    }
+    std::vector<RGBf> reference(WIDTH * HEIGHT, RGBf(0.0F, 0.0F, 0.0F));
+    for (const auto &t : fan)
+    {
+        Raster::fillTriangle<false, Raster::Blend::Replace>(canvasFor(reference), t.x0, t.y0, t.x1, t.y1, t.x2, t.y2, Half);
+    }
+    int fanPixels = 0;
+    for (const auto &pixel : reference)
+    {
+        fanPixels += pixel.r > 0.0F ? 1 : 0;
+    }
+    checkFillRule("Fan of rays", fan, fanPixels);
+    checkLines();
+    checkStrips();
+    return HostTest::result();
+}
@@ -0,0 +1,105 @@
+#include "host_test.h"
+
+#include "sound_level_meter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Feeds a calibrated 1 kHz tone switched on and off to a SoundLevelMeter and checks its readings against the
+// analytic values of an ideal meter:
+// - LAF and LAS of the steady tone are the calibration level, LApeak is 3.01 dB above
+// - After switching the tone on, LAF and LAS are 1.99 dB below the tone after one time constant (125ms / 1s)
+// - After switching it off, LAF and LAS fall by 34.7 dB/s and 4.3 dB/s
+// - LAeq of a window is the energy average of its samples, windows restart after the configured length
+// Blocks hold whole periods of the tone, so per-block time weighting is exact up to float rounding
+
+static constexpr unsigned SAMPLE_RATE_HZ = 48000;
+static constexpr unsigned BLOCK_SIZE = 240; // 5ms
+static constexpr float TONE_HZ = 1000.0F;
+static constexpr float REFERENCE_AMPLITUDE = 1000.0F; // RMS amplitude of a 94 dB signal
+static constexpr float REFERENCE_DB = 94.0F;
+static constexpr float SILENCE_DB = REFERENCE_DB - 60.0F; // Level of amplitude 1, the lowest level reported
+static constexpr int WINDOW_S = 2;
+static constexpr float TOLERANCE_DB = 0.05F;
+
+using Meter = SoundLevelMeter<1, SAMPLE_RATE_HZ>;
+
+// Feeds blocks of tone or silence and keeps track of time
+class Signal
+{
+public:
+    Signal(Meter &meter)
+        : m_meter(meter), m_samples(BLOCK_SIZE)
+    {
+    }
+
+    // Feed signal until time t in seconds. Time advances in whole blocks
+    void feedUntil(float t, bool tone)
+    {
+        while (m_sample + BLOCK_SIZE <= static_cast<uint64_t>(std::lround(t * SAMPLE_RATE_HZ)))
+        {
+            for (unsigned i = 0; i < BLOCK_SIZE; i++)
+            {
+                const double phase = 2.0 * M_PI * TONE_HZ * static_cast<double>(m_sample + i) / SAMPLE_RATE_HZ;
+                m_samples[i] = tone ? static_cast<float>(std::sqrt(2.0) * REFERENCE_AMPLITUDE * std::sin(phase)) : 0.0F;
+            }
+            m_meter.applyGain(1.0F, m_samples.data(), BLOCK_SIZE);
+            m_meter.update();
+            m_sample += BLOCK_SIZE;
+        }
+    }
+
+private:
+    Meter &m_meter;
+    std::vector<float> m_samples;
+    uint64_t m_sample = 0;
+};
+
+bool checkLevel(const char *name, float level, float expected)
+{
+    std::printf("%s: %.2f dB, expected %.2f dB\n", name, level, expected);
+    return CHECK(std::fabs(level - expected) < TOLERANCE_DB);
+}
+
+int main()
+{
+    auto meter = Meter(REFERENCE_AMPLITUDE, REFERENCE_DB);
+    ParameterRegistry::instance().set("SoundLevelMeter.laeqWindowS", WINDOW_S);
+    auto signal = Signal(meter);
+    const float onsetDb = REFERENCE_DB + 10.0F * std::log10(1.0F - std::exp(-1.0F)); // Level after one time constant
+    // silence from 0s to 1s, tone from 1s to 9s, silence from 9s
+    signal.feedUntil(1.0F, false);
+    checkLevel("LAF of silence", meter.levels().lafDb, SILENCE_DB);
+    signal.feedUntil(1.125F, true);
+    checkLevel("LAF 125ms after tone on", meter.levels().lafDb, onsetDb);
+    signal.feedUntil(2.0F, true);
+    checkLevel("LAS 1s after tone on", meter.levels().lasDb, onsetDb);
+    // first window [0s, 2s) is half silence, half tone
+    signal.feedUntil(2.005F, true);
+    checkLevel("LAeq of first window", meter.levels().lastLaeqDb, REFERENCE_DB - 10.0F * std::log10(2.0F));
+    // second window [2s, 4s) is tone only
+    signal.feedUntil(4.005F, true);
+    checkLevel("LAeq of second window", meter.levels().lastLaeqDb, REFERENCE_DB);
+    // LAS is within 0.01 dB of the tone 8 time constants after switching it on
+    signal.feedUntil(9.0F, true);
+    const auto tone = meter.levels();
+    checkLevel("LAF of tone", tone.lafDb, REFERENCE_DB);
+    checkLevel("LAS of tone", tone.lasDb, REFERENCE_DB);
+    checkLevel("LAeq of tone", tone.laeqDb, REFERENCE_DB);
+    checkLevel("LAFmax of tone", tone.lafMaxDb, REFERENCE_DB);
+    checkLevel("LApeak of tone", tone.lapeakDb, REFERENCE_DB + 10.0F * std::log10(2.0F));
+    // decay rates are 10 * log10(e) / time constant
+    signal.feedUntil(9.1F, false);
+    const float laf = meter.levels().lafDb;
+    signal.feedUntil(9.3F, false);
+    checkLevel("LAF decay in 0.2s", laf - meter.levels().lafDb, 0.2F * 10.0F * std::log10(std::exp(1.0F)) / 0.125F);
+    signal.feedUntil(9.5F, false);
+    const float las = meter.levels().lasDb;
+    signal.feedUntil(10.5F, false);
+    checkLevel("LAS decay in 1s", las - meter.levels().lasDb, 10.0F * std::log10(std::exp(1.0F)));
+    // window [10s, 12s) is silence only
+    signal.feedUntil(12.005F, false);
+    checkLevel("LAeq of silent window", meter.levels().lastLaeqDb, SILENCE_DB);
+    return HostTest::result();
+}
@@ -0,0 +1,94 @@
+#include "host_test.h"
+
+#include "effects_spectrum.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// Renders the spectrogram at several frame rates while analysis frames arrive at ~47 Hz and checks that
+// the history holds exactly one row per analysis frame, newest first, regardless of the frame rate.
+// Sequence numbers start at 0 like those of the analysis task
+
+static constexpr unsigned WIDTH = 8;
+static constexpr unsigned HEIGHT = 16;
+static constexpr unsigned NR_OF_BANDS = 8;
+static constexpr double ANALYSIS_RATE_HZ = 48000.0 / 1024.0;
+
+using Spectrogram = Effects::Spectrogram<WIDTH, HEIGHT, NR_OF_BANDS>;
+
+// Level of all bands of analysis frame sequence. Alternates between silence and maximum level with a period of 3 frames,
+// so repeated and skipped rows show up
+float levelOf(uint32_t sequence)
+{
+    return sequence % 3 == 0 ? 1.0F : 0.0F;
+}
+
+// Render rows with the spectrogram filling the whole frame
+void renderAll(Spectrogram &effect, const AnalysisFrame &frame, std::vector<RGBf> &pixels)
+{
+    Strip strip;
+    strip.dest = pixels.data();
+    strip.width = WIDTH;
+    strip.height = HEIGHT;
+    strip.firstRow = 0;
+    strip.endRow = HEIGHT;
+    effect.render(strip, frame);
+}
+
+// The first analysis frame has sequence 0, which must add a row once, even though it is the initial sequence
+void checkFirstFrame()
+{
+    auto effect = Spectrogram();
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    frame->nrOfBands = NR_OF_BANDS;
+    frame->sequence = 0;
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        frame->levels[band] = levelOf(frame->sequence);
+    }
+    std::vector<RGBf> pixels(WIDTH * HEIGHT);
+    effect.prepare(1.0F / 60.0F, *frame);
+    effect.prepare(1.0F / 60.0F, *frame);
+    renderAll(effect, *frame, pixels);
+    std::printf("First frame: newest row %.1f, row before %.1f\n", pixels[0].r, pixels[WIDTH].r);
+    CHECK(pixels[0].r == 1.0F);
+    CHECK(pixels[WIDTH].r == 0.0F);
+}
+
+void checkFrameRate(double renderRateHz)
+{
+    auto effect = Spectrogram();
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    frame->nrOfBands = NR_OF_BANDS;
+    const unsigned nrOfRenderFrames = static_cast<unsigned>(2.0 * renderRateHz);
+    for (unsigned i = 0; i < nrOfRenderFrames; i++)
+    {
+        frame->sequence = static_cast<uint32_t>(i / renderRateHz * ANALYSIS_RATE_HZ);
+        for (unsigned band = 0; band < NR_OF_BANDS; band++)
+        {
+            frame->levels[band] = levelOf(frame->sequence);
+        }
+        effect.prepare(static_cast<float>(1.0 / renderRateHz), *frame);
+    }
+    std::vector<RGBf> pixels(WIDTH * HEIGHT);
+    renderAll(effect, *frame, pixels);
+    // row y shows the frame y frames before the last one
+    unsigned wrongRows = 0;
+    for (unsigned y = 0; y < HEIGHT; y++)
+    {
+        const float expected = levelOf(frame->sequence - y);
+        wrongRows += pixels[y * WIDTH].r != expected || pixels[y * WIDTH + WIDTH - 1].r != expected ? 1 : 0;
+    }
+    std::printf("Render rate %.0f Hz: %u of %u rows wrong\n", renderRateHz, wrongRows, HEIGHT);
+    CHECK(wrongRows == 0);
+}
+
+int main()
+{
+    checkFirstFrame();
+    checkFrameRate(50.0);
+    checkFrameRate(60.0);
+    checkFrameRate(120.0);
+    return HostTest::result();
+}
@@ -0,0 +1,118 @@
+#include "host_test.h"
+#include "fake_screen.h"
+#include "zeroed_pipeline.h"
+
+#include "effectpipeline.h"
+#include "tiledeffectpipeline.h"
+#include "effects_draw.h"
+#include "effects_feedback.h"
+#include "effects_spectrum.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+// Renders feedback chains with TiledEffectPipeline and EffectPipeline and checks that the screen output is bit-identical.
+// MoveFromCenter at a short distance reads its source rows through the window, at a long distance and RotoBlit read
+// the history directly, because their source rows do not fit into the window.
+// Chains start with an effect that writes every pixel, because tiles start black instead of holding frame n-2
+
+static constexpr unsigned WIDTH = 32;
+static constexpr unsigned HEIGHT = 32;
+static constexpr unsigned NR_OF_BANDS = 16;
+static constexpr unsigned STRIP_ROWS = 8;
+static constexpr unsigned WINDOW_ROWS = 16;
+static constexpr unsigned NR_OF_FRAMES = 120;
+static constexpr float DT = 1.0F / 60.0F;
+
+using Pipeline = EffectPipeline<WIDTH, HEIGHT>;
+using TiledPipeline = TiledEffectPipeline<WIDTH, HEIGHT, STRIP_ROWS, WINDOW_ROWS>;
+using Screen_ = FakeScreen<WIDTH, HEIGHT>;
+
+// Effects of every chain checked. Each pipeline gets its own instances, so effect state is not shared
+struct Effects_
+{
+    Effects::FillColor<WIDTH, HEIGHT> fillBlack;
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> spectrum;
+    Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS> rays{Effects::DrawSpectrum<WIDTH, HEIGHT, NR_OF_BANDS>::Mode::RaysCentered};
+    Effects::MoveFromCenter<WIDTH, HEIGHT> moveFromCenter;
+    Effects::RotoBlit<WIDTH, HEIGHT> rotoBlit;
+    Effects::ChangeBrightness<WIDTH, HEIGHT> changeBrightness;
+};
+
+// Analysis frame number i. Levels move over time and there is a beat every 30 frames
+void makeFrame(AnalysisFrame &frame, unsigned i)
+{
+    frame.sequence = i;
+    frame.nrOfBands = NR_OF_BANDS;
+    frame.isBeat = i % 30 == 0;
+    for (unsigned band = 0; band < NR_OF_BANDS; band++)
+    {
+        frame.levels[band] = 0.5F + 0.5F * std::sin(0.1F * i + 0.7F * band);
+        frame.peaks[band] = frame.levels[band];
+    }
+}
+
+// Render chain with both pipelines for a while and compare every frame on the screen
+void checkChain(const char *name, EffectChain &full, EffectChain &tiled, bool expectWindowOverflow)
+{
+    ZeroedPipeline<Pipeline> fullPipeline(&full);
+    auto tiledPipeline = std::unique_ptr<TiledPipeline>(new TiledPipeline(&tiled));
+    auto fullScreen = std::unique_ptr<Screen_>(new Screen_());
+    auto tiledScreen = std::unique_ptr<Screen_>(new Screen_());
+    if (!CHECK(tiledPipeline->begin()))
+    {
+        return;
+    }
+    auto frame = std::unique_ptr<AnalysisFrame>(new AnalysisFrame());
+    unsigned differentFrames = 0;
+    for (unsigned i = 0; i < NR_OF_FRAMES; i++)
+    {
+        makeFrame(*frame, i);
+        fullPipeline->render(DT, *frame, *fullScreen);
+        tiledPipeline->render(DT, *frame, *tiledScreen);
+        differentFrames += memcmp(fullScreen->backBuffer(), tiledScreen->backBuffer(), sizeof(RGB8) * WIDTH * HEIGHT) != 0 ? 1 : 0;
+    }
+    // find out which path the chain took. Parameters are applied in prepare(), so this is only known after rendering
+    bool overflows = false;
+    for (int firstRow = 0; firstRow < static_cast<int>(HEIGHT); firstRow += STRIP_ROWS)
+    {
+        for (unsigned i = 0; i < tiled.count; i++)
+        {
+            const auto rows = tiled.effects[i]->sourceRows(firstRow, firstRow + STRIP_ROWS, HEIGHT);
+            overflows = overflows || rows.second - rows.first > static_cast<int>(WINDOW_ROWS);
+        }
+    }
+    std::printf("%s: %s, %u of %u frames differ\n", name, overflows ? "history" : "window", differentFrames, NR_OF_FRAMES);
+    CHECK(overflows == expectWindowOverflow);
+    CHECK(tiledScreen->blits == NR_OF_FRAMES * HEIGHT / STRIP_ROWS);
+    CHECK(differentFrames == 0);
+}
+
+int main()
+{
+    auto a = std::unique_ptr<Effects_>(new Effects_());
+    auto b = std::unique_ptr<Effects_>(new Effects_());
+    auto &registry = ParameterRegistry::instance();
+    {
+        EffectChain full{"Spectrum", {&a->fillBlack, &a->spectrum}, 2};
+        EffectChain tiled{"Spectrum", {&b->fillBlack, &b->spectrum}, 2};
+        checkChain(full.name, full, tiled, false);
+    }
+    for (float distance : {0.5F, 1.5F, 3.0F})
+    {
+        registry.set("MoveFromCenter.distance", distance);
+        char name[64];
+        std::snprintf(name, sizeof(name), "Rays from center, distance %.1f", distance);
+        EffectChain full{name, {&a->moveFromCenter, &a->changeBrightness, &a->rays}, 3};
+        EffectChain tiled{name, {&b->moveFromCenter, &b->changeBrightness, &b->rays}, 3};
+        checkChain(name, full, tiled, distance > 1.0F);
+    }
+    {
+        EffectChain full{"Rotating rays", {&a->fillBlack, &a->rotoBlit, &a->rays}, 3};
+        EffectChain tiled{"Rotating rays", {&b->fillBlack, &b->rotoBlit, &b->rays}, 3};
+        checkChain(full.name, full, tiled, true);
+    }
+    return HostTest::result();
+}
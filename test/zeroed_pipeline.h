@@ -0,0 +1,37 @@
+#pragma once
+
+#include "effect.h"
+
+#include <cstdlib>
+#include <new>
+
+// Pipeline in zeroed memory. Pipelines are globals on the device, so their buffers start black.
+// The buffers of a pipeline created with new are not initialized and would be read by feedback effects in the first frames
+// PIPELINE = Pipeline type, e.g. EffectPipeline<32, 32>
+template <typename PIPELINE>
+class ZeroedPipeline
+{
+public:
+    explicit ZeroedPipeline(const EffectChain *chain)
+        : m_storage(std::calloc(1, sizeof(PIPELINE))), m_pipeline(new (m_storage) PIPELINE(chain))
+    {
+    }
+
+    ZeroedPipeline(const ZeroedPipeline &) = delete;
+    ZeroedPipeline &operator=(const ZeroedPipeline &) = delete;
+
+    ~ZeroedPipeline()
+    {
+        m_pipeline->~PIPELINE();
+        std::free(m_storage);
+    }
+
+    auto operator->() -> PIPELINE *
+    {
+        return m_pipeline;
+    }
+
+private:
+    void *m_storage = nullptr;
+    PIPELINE *m_pipeline = nullptr;
+};